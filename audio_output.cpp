@@ -0,0 +1,373 @@
+#include "audio_output.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+bool parse_device_reuse(const std::string& name, DeviceReuse* policy) {
+    if (name == "auto") {
+        *policy = DeviceReuse::Auto;
+        return true;
+    }
+    if (name == "reopen") {
+        *policy = DeviceReuse::Reopen;
+        return true;
+    }
+    if (name == "convert") {
+        *policy = DeviceReuse::Convert;
+        return true;
+    }
+    return false;
+}
+
+const char* device_reuse_name(DeviceReuse policy) {
+    switch (policy) {
+    case DeviceReuse::Reopen:
+        return "reopen";
+    case DeviceReuse::Convert:
+        return "convert";
+    default:
+        return "auto";
+    }
+}
+
+namespace {
+
+struct SampleFormatName {
+    ma_format format;
+    const char* name;
+};
+
+const SampleFormatName SAMPLE_FORMATS[] = {
+    {ma_format_u8, "u8"},
+    {ma_format_s16, "s16"},
+    {ma_format_s24, "s24"},
+    {ma_format_s32, "s32"},
+    {ma_format_f32, "f32"},
+};
+
+const char* sample_format_name(ma_format format) {
+    for (const auto& item : SAMPLE_FORMATS) {
+        if (item.format == format) {
+            return item.name;
+        }
+    }
+    return "native";
+}
+
+// 采样率：48000、48k、44.1k
+bool parse_sample_rate(const std::string& text, ma_uint32* rate) {
+    char* end = nullptr;
+    double value = strtod(text.c_str(), &end);
+    if (end == text.c_str()) {
+        return false;
+    }
+    if (*end == 'k' || *end == 'K') {
+        value *= 1000;
+        ++end;
+    }
+    if (*end != '\0' || value < ma_standard_sample_rate_min || value > ma_standard_sample_rate_max) {
+        return false;
+    }
+    *rate = (ma_uint32)(value + 0.5);
+    return true;
+}
+
+// 声道数：mono、stereo、2ch
+bool parse_channels(const std::string& text, ma_uint32* channels) {
+    if (text == "mono") {
+        *channels = 1;
+        return true;
+    }
+    if (text == "stereo") {
+        *channels = 2;
+        return true;
+    }
+    if (text.size() > 2 && text.compare(text.size() - 2, 2, "ch") == 0) {
+        int count = atoi(text.c_str());
+        if (count > 0 && count <= MA_MAX_CHANNELS) {
+            *channels = (ma_uint32)count;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+bool parse_output_format(const std::string& text, AudioOutputFormat* format) {
+    AudioOutputFormat result;
+    size_t begin = 0;
+    while (begin <= text.size()) {
+        size_t end = text.find('/', begin);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        std::string part = text.substr(begin, end - begin);
+        begin = end + 1;
+
+        bool matched = false;
+        for (const auto& item : SAMPLE_FORMATS) {
+            if (part == item.name) {
+                result.format = item.format;
+                matched = true;
+            }
+        }
+        if (!matched && !parse_channels(part, &result.channels)) {
+            // 单独的小整数按声道数处理（"s16/44100/2"），其余按采样率
+            int value = atoi(part.c_str());
+            if (value > 0 && value <= MA_MAX_CHANNELS && part.find_first_not_of("0123456789") == std::string::npos) {
+                result.channels = (ma_uint32)value;
+            } else if (!parse_sample_rate(part, &result.sample_rate)) {
+                return false;
+            }
+        }
+    }
+    *format = result;
+    return true;
+}
+
+std::string describe_output_format(const AudioOutputFormat& format) {
+    std::string text;
+    if (format.format != ma_format_unknown) {
+        text = std::string(sample_format_name(format.format)) + " ";
+    }
+    char buf[32];
+    if (format.sample_rate > 0) {
+        snprintf(buf, sizeof(buf), "%g kHz", format.sample_rate / 1000.0);
+        text += buf;
+    } else {
+        text += "native rate";
+    }
+    if (format.channels == 1) {
+        text += " mono";
+    } else if (format.channels == 2) {
+        text += " stereo";
+    } else if (format.channels > 0) {
+        snprintf(buf, sizeof(buf), " %uch", format.channels);
+        text += buf;
+    } else {
+        text += " native channels";
+    }
+    return text;
+}
+
+bool parse_resampler_quality(const std::string& name, ResamplerQuality* quality) {
+    if (name == "low") {
+        *quality = ResamplerQuality::Low;
+        return true;
+    }
+    if (name == "medium") {
+        *quality = ResamplerQuality::Medium;
+        return true;
+    }
+    if (name == "high") {
+        *quality = ResamplerQuality::High;
+        return true;
+    }
+    return false;
+}
+
+const char* resampler_quality_name(ResamplerQuality quality) {
+    switch (quality) {
+    case ResamplerQuality::Low:
+        return "low";
+    case ResamplerQuality::High:
+        return "high";
+    default:
+        return "medium";
+    }
+}
+
+ma_uint32 resampler_lpf_order(ResamplerQuality quality) {
+    switch (quality) {
+    case ResamplerQuality::Low:
+        return 0;
+    case ResamplerQuality::High:
+        return MA_MAX_FILTER_ORDER;
+    default:
+        return 4;
+    }
+}
+
+std::string format_device_stats(const AudioOutputStats& stats, DeviceReuse policy) {
+    char text[256];
+    snprintf(text, sizeof(text),
+             "Device: opened %u time(s) (last %.1f ms, total %.1f ms), reused %u, reopened for format change %u, "
+             "converted %u, policy %s",
+             stats.opens, stats.last_open_ms, stats.total_open_ms, stats.reuses, stats.reopens, stats.conversions,
+             device_reuse_name(policy));
+    return text;
+}
+
+AudioOutput::AudioOutput()
+    : context_initialized_(false),
+      context_attempted_(false),
+      policy_(DeviceReuse::Auto),
+      device_initialized_(false) {
+}
+
+AudioOutput::~AudioOutput() {
+    close();
+}
+
+void AudioOutput::setReusePolicy(DeviceReuse policy) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    policy_ = policy;
+}
+
+void AudioOutput::initContext() {
+    std::lock_guard<std::mutex> lock(context_mutex_);
+    if (context_attempted_) {
+        return;
+    }
+    context_attempted_ = true;
+    context_initialized_ = ma_context_init(nullptr, 0, nullptr, &context_) == MA_SUCCESS;
+}
+
+AudioOutputFormat AudioOutput::chooseFormat(const AudioOutputFormat& wanted) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!device_initialized_ || format_ == wanted) {
+        return wanted;
+    }
+
+    bool convert = policy_ == DeviceReuse::Convert ||
+                   (policy_ == DeviceReuse::Auto && stats_.last_open_ms > DEVICE_REOPEN_BUDGET_MS);
+    return convert ? format_ : wanted;
+}
+
+ma_result AudioOutput::attach(const AudioOutputFormat& format, const AudioOutputFormat& source,
+                              const AudioOutputClient& client) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (client_.user_data != nullptr && client_.user_data != client.user_data) {
+        return MA_BUSY;
+    }
+
+    if (device_initialized_ && format_ == format) {
+        ma_device_stop(&device_);  // 上一个引擎 detach 时已停止，这里只是保险
+        stats_.reuses++;
+        if (format != source) {
+            stats_.conversions++;
+        }
+        client_ = client;
+        return MA_SUCCESS;
+    }
+
+    bool reopen = device_initialized_;
+    closeDevice();
+
+    // 上下文只在打开设备时需要，取得后不再变化
+    lock.unlock();
+    ma_context* context = nullptr;
+    {
+        std::lock_guard<std::mutex> context_lock(context_mutex_);
+        if (context_initialized_) {
+            context = &context_;
+        }
+    }
+    lock.lock();
+
+    ma_device_config config = ma_device_config_init(ma_device_type_playback);
+    config.playback.format   = format.format;
+    config.playback.channels = format.channels;
+    config.sampleRate        = format.sample_rate;
+    config.dataCallback      = &AudioOutput::dataCallback;
+    config.notificationCallback = &AudioOutput::notificationCallback;
+    config.pUserData         = this;
+
+    auto begin = std::chrono::steady_clock::now();
+    ma_result result = ma_device_init(context, &config, &device_);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    if (result != MA_SUCCESS) {
+        return result;
+    }
+    device_initialized_ = true;
+    format_ = format;
+    client_ = client;
+
+    stats_.opens++;
+    stats_.last_open_ms = ms;
+    stats_.total_open_ms += ms;
+    if (reopen) {
+        stats_.reopens++;
+    }
+    return MA_SUCCESS;
+}
+
+void AudioOutput::detach(void* user_data) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (client_.user_data != user_data) {
+        return;
+    }
+    // 先停止设备（停止后不再有回调和通知），再断开目标
+    if (device_initialized_) {
+        ma_device_stop(&device_);
+    }
+    client_ = AudioOutputClient();
+}
+
+void AudioOutput::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closeDevice();
+        client_ = AudioOutputClient();
+    }
+
+    std::lock_guard<std::mutex> lock(context_mutex_);
+    if (context_initialized_) {
+        ma_context_uninit(&context_);
+        context_initialized_ = false;
+    }
+    context_attempted_ = false;
+}
+
+void AudioOutput::closeDevice() {
+    if (device_initialized_) {
+        ma_device_uninit(&device_);
+        device_initialized_ = false;
+        format_ = AudioOutputFormat();
+    }
+}
+
+ma_result AudioOutput::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!device_initialized_ || client_.render == nullptr) {
+        return MA_INVALID_OPERATION;
+    }
+    return ma_device_start(&device_);
+}
+
+bool AudioOutput::started() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return device_initialized_ && ma_device_is_started(&device_);
+}
+
+bool AudioOutput::attachedTo(const void* user_data) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return user_data != nullptr && client_.user_data == user_data;
+}
+
+AudioOutputStats AudioOutput::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void AudioOutput::dataCallback(ma_device* device, void* output, const void* input, ma_uint32 frame_count) {
+    (void)input;
+    AudioOutput* self = (AudioOutput*)device->pUserData;
+    const AudioOutputClient& client = self->client_;
+    if (client.render == nullptr) {
+        memset(output, 0, (size_t)frame_count * ma_get_bytes_per_frame(device->playback.format, device->playback.channels));
+        return;
+    }
+    client.render(client.user_data, output, frame_count);
+}
+
+void AudioOutput::notificationCallback(const ma_device_notification* notification) {
+    AudioOutput* self = (AudioOutput*)notification->pDevice->pUserData;
+    const AudioOutputClient& client = self->client_;
+    if (notification->type == ma_device_notification_type_stopped && client.stopped != nullptr) {
+        client.stopped(client.user_data);
+    }
+}
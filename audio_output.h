@@ -0,0 +1,138 @@
+#ifndef AUDIO_OUTPUT_H
+#define AUDIO_OUTPUT_H
+
+#include "third-party/miniaudio.h"
+
+#include <mutex>
+#include <string>
+
+// 上一次打开设备耗时超过该值（毫秒）时，自动策略不再为格式变化重新打开设备，改为在进程内转换
+constexpr double DEVICE_REOPEN_BUDGET_MS = 30.0;
+
+// 新的播放队列格式与已打开的设备不同时的处理方式
+enum class DeviceReuse {
+    Auto,     // 打开设备开销小时按新格式重新打开，否则转换到设备格式
+    Reopen,   // 总是按新格式重新打开
+    Convert,  // 总是转换到设备格式（解码器内转换），设备只打开一次
+};
+
+// 解析 --device-reuse 参数（auto / reopen / convert），无法识别时返回 false
+bool parse_device_reuse(const std::string& name, DeviceReuse* policy);
+const char* device_reuse_name(DeviceReuse policy);
+
+// 设备的 PCM 格式
+struct AudioOutputFormat {
+    ma_format format = ma_format_unknown;
+    ma_uint32 channels = 0;
+    ma_uint32 sample_rate = 0;
+
+    bool operator==(const AudioOutputFormat& other) const {
+        return format == other.format && channels == other.channels && sample_rate == other.sample_rate;
+    }
+    bool operator!=(const AudioOutputFormat& other) const { return !(*this == other); }
+};
+
+// 解析固定输出格式，如 "f32/48k/stereo"、"s16/44100/2"、"48000"：
+// 各部分用 '/' 分隔、顺序不限，没有指定的部分跟随曲目的原始格式。无法识别时返回 false
+bool parse_output_format(const std::string& text, AudioOutputFormat* format);
+
+// "f32 48 kHz stereo" 形式的说明：未指定采样格式时省略，未指定采样率和声道数时显示为 "native"
+std::string describe_output_format(const AudioOutputFormat& format);
+
+// 采样率转换质量：miniaudio 内置的线性重采样器加上不同阶数的低通滤波器
+enum class ResamplerQuality {
+    Low,     // 不滤波，开销最小，可能有混叠
+    Medium,  // 4 阶低通（miniaudio 默认）
+    High,    // 8 阶低通（MA_MAX_FILTER_ORDER）
+};
+
+bool parse_resampler_quality(const std::string& name, ResamplerQuality* quality);
+const char* resampler_quality_name(ResamplerQuality quality);
+ma_uint32 resampler_lpf_order(ResamplerQuality quality);
+
+// 设备使用统计：一次播放会话内应当只打开一次
+struct AudioOutputStats {
+    ma_uint32 opens = 0;         // ma_device_init 次数
+    ma_uint32 reuses = 0;        // 直接沿用已打开设备的次数
+    ma_uint32 reopens = 0;       // 因格式变化重新打开的次数（包含在 opens 中）
+    ma_uint32 conversions = 0;   // 格式不同但转换到设备格式、没有重新打开的次数
+    double last_open_ms = 0.0;   // 最近一次打开设备的耗时
+    double total_open_ms = 0.0;  // 打开设备的总耗时
+};
+
+// 统计信息的一行文字说明（本地播放结束时和守护进程 stats 命令输出）
+std::string format_device_stats(const AudioOutputStats& stats, DeviceReuse policy);
+
+// 设备回调转发的目标（播放引擎）。render 在实时线程上调用，
+// stopped 在设备停止时（拔出、驱动错误或 detach）调用
+struct AudioOutputClient {
+    void* user_data = nullptr;
+    ma_uint32 (*render)(void* user_data, void* output, ma_uint32 frame_count) = nullptr;
+    void (*stopped)(void* user_data) = nullptr;
+};
+
+// 长期持有的播放设备：由播放会话（本地播放进程或守护进程）拥有，跨越多个播放引擎。
+// 新引擎的格式与设备相同时直接沿用设备，只切换回调目标；格式不同时按策略重新打开
+// 或让引擎把解码输出转换到设备格式。切换目标只在设备停止时进行，回调中不需要同步。
+// 除回调外的方法由控制线程调用（引擎的设备线程与控制线程不会同时调用）
+class AudioOutput {
+public:
+    AudioOutput();
+    ~AudioOutput();
+
+    AudioOutput(const AudioOutput&) = delete;
+    AudioOutput& operator=(const AudioOutput&) = delete;
+
+    void setReusePolicy(DeviceReuse policy);
+
+    // 初始化后端上下文（可提前在后台线程调用，重复调用无开销）。
+    // 失败时打开设备退回 miniaudio 的默认方式
+    void initContext();
+
+    // 给定引擎希望的格式，返回引擎实际应使用的格式：
+    // 设备已按其他格式打开且策略为转换时返回设备格式，否则返回 wanted
+    AudioOutputFormat chooseFormat(const AudioOutputFormat& wanted) const;
+
+    // 按 format 打开设备（已按相同格式打开时沿用）并把回调转给 client。
+    // source 为曲目的原始格式，只用于统计格式转换次数
+    ma_result attach(const AudioOutputFormat& format, const AudioOutputFormat& source, const AudioOutputClient& client);
+
+    // 停止设备并断开 client（设备保持打开，供下一个引擎使用）
+    void detach(void* user_data);
+
+    // 关闭设备和后端上下文
+    void close();
+
+    ma_result start();
+    bool started() const;
+    bool attachedTo(const void* user_data) const;
+
+    AudioOutputStats stats() const;
+
+private:
+    static void dataCallback(ma_device* device, void* output, const void* input, ma_uint32 frame_count);
+    static void notificationCallback(const ma_device_notification* notification);
+
+    void closeDevice();
+
+    // 后端上下文单独加锁：提前初始化上下文时不阻塞选择格式
+    std::mutex context_mutex_;
+    ma_context context_;
+    bool context_initialized_;
+    bool context_attempted_;
+
+    // 以下状态受 mutex_ 保护
+    mutable std::mutex mutex_;
+    DeviceReuse policy_;
+
+    ma_device device_;
+    bool device_initialized_;
+    AudioOutputFormat format_;
+
+    // 回调目标：只在设备停止时修改，ma_device_start 之后回调线程才会读取
+    AudioOutputClient client_;
+
+    AudioOutputStats stats_;
+};
+
+#endif // AUDIO_OUTPUT_H
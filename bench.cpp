@@ -0,0 +1,739 @@
+#include "bench.h"
+#include "dsp_kernels.h"
+#include "eq.h"
+#include "library_index.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+// 播放基准测试生成的测试数据：60 秒 44.1kHz 立体声 s16 扫频
+const ma_uint32 SYNTH_SAMPLE_RATE = 44100;
+const ma_uint32 SYNTH_SECONDS = 60;
+const double TWO_PI = 6.283185307179586;
+
+// 解码基准测试的参数组合
+const ma_uint32 DECODE_CHUNK_FRAMES[] = {64, 256, 1024, 4096};
+const ma_uint32 DECODE_SCALING_CHUNK = 1024;  // 多核扩展测试使用的块大小
+
+// 统计 miniaudio 的内存分配（解码器、环形缓冲）
+struct AllocationCounter {
+    std::atomic<ma_uint64> count{0};
+    std::atomic<ma_uint64> bytes{0};
+    std::atomic<ma_uint64> render_count{0};  // 发生在输出路径上的分配，应始终为 0
+};
+
+thread_local bool t_in_render = false;
+
+void* counting_malloc(size_t size, void* user_data) {
+    AllocationCounter* counter = (AllocationCounter*)user_data;
+    counter->count.fetch_add(1, std::memory_order_relaxed);
+    counter->bytes.fetch_add(size, std::memory_order_relaxed);
+    if (t_in_render) {
+        counter->render_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    return malloc(size);
+}
+
+void* counting_realloc(void* p, size_t size, void* user_data) {
+    AllocationCounter* counter = (AllocationCounter*)user_data;
+    counter->count.fetch_add(1, std::memory_order_relaxed);
+    counter->bytes.fetch_add(size, std::memory_order_relaxed);
+    if (t_in_render) {
+        counter->render_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    return realloc(p, size);
+}
+
+void counting_free(void* p, void*) {
+    free(p);
+}
+
+std::string temp_directory() {
+#ifdef _WIN32
+    const char* dir = std::getenv("TEMP");
+    return dir != nullptr ? dir : ".";
+#else
+    const char* dir = std::getenv("TMPDIR");
+    return dir != nullptr && dir[0] != '\0' ? dir : "/tmp";
+#endif
+}
+
+// 写一段立体声对数扫频 WAV（两个声道反相），返回是否成功
+bool write_synth_wav(const std::string& path, ma_format format, ma_uint32 sample_rate, ma_uint32 seconds) {
+    ma_encoder_config config = ma_encoder_config_init(ma_encoding_format_wav, format, 2, sample_rate);
+    ma_encoder encoder;
+    if (ma_encoder_init_file(path.c_str(), &config, &encoder) != MA_SUCCESS) {
+        return false;
+    }
+
+    // 先生成 f32，再由 miniaudio 转换为目标采样格式
+    const ma_uint32 chunk = 4096;
+    std::vector<float> samples((size_t)chunk * 2);
+    std::vector<ma_uint8> converted((size_t)chunk * ma_get_bytes_per_frame(format, 2));
+    ma_uint64 total = (ma_uint64)sample_rate * seconds;
+    double phase = 0.0;
+    bool ok = true;
+    for (ma_uint64 frame = 0; frame < total && ok; frame += chunk) {
+        ma_uint32 n = (ma_uint32)std::min<ma_uint64>(chunk, total - frame);
+        for (ma_uint32 i = 0; i < n; ++i) {
+            double t = (double)(frame + i) / total;
+            double freq = 40.0 * std::pow(400.0, t);  // 40Hz → 16kHz
+            phase += TWO_PI * freq / sample_rate;
+            float value = (float)(std::sin(phase) * 0.5);
+            samples[(size_t)i * 2] = value;
+            samples[(size_t)i * 2 + 1] = -value;
+        }
+        ma_convert_pcm_frames_format(converted.data(), format, samples.data(), ma_format_f32, n, 2, ma_dither_mode_none);
+        ma_uint64 written = 0;
+        ok = ma_encoder_write_pcm_frames(&encoder, converted.data(), n, &written) == MA_SUCCESS && written == n;
+    }
+    ma_encoder_uninit(&encoder);
+    return ok;
+}
+
+ma_uint64 file_size(const std::string& path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    return in.is_open() ? (ma_uint64)in.tellg() : 0;
+}
+
+double percentile(const std::vector<ma_uint32>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+} // namespace
+
+int run_playback_benchmark(const std::vector<std::string>& files, const PlaybackEngineConfig& config,
+                           ma_uint32 period_frames) {
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<std::string> tracks = files;
+    std::string synth_path;
+    if (tracks.empty()) {
+        synth_path = temp_directory() + "/caudio_bench_" + std::to_string((long)getpid()) + ".wav";
+        std::cout << "No files given, generating " << SYNTH_SECONDS << " s test signal: " << synth_path << "\n";
+        if (!write_synth_wav(synth_path, ma_format_s16, SYNTH_SAMPLE_RATE, SYNTH_SECONDS)) {
+            std::cerr << "Error: Failed to write test signal: " << synth_path << "\n";
+            return 1;
+        }
+        tracks.push_back(synth_path);
+    }
+
+    ma_uint64 input_bytes = 0;
+    for (const auto& track : tracks) {
+        input_bytes += file_size(track);
+    }
+
+    AllocationCounter allocations;
+    ma_allocation_callbacks callbacks;
+    callbacks.pUserData = &allocations;
+    callbacks.onMalloc = counting_malloc;
+    callbacks.onRealloc = counting_realloc;
+    callbacks.onFree = counting_free;
+
+    PlaybackEngineConfig engine_config = config;
+    engine_config.allocation_callbacks = &callbacks;
+
+    int exit_code = 0;
+    {
+        PlaybackEngine engine;
+        auto open_start = Clock::now();
+        ma_result result = engine.open(tracks, engine_config);
+        auto open_end = Clock::now();
+        if (result != MA_SUCCESS) {
+            const char* error_desc = ma_result_description(result);
+            std::cerr << "Error: Failed to open " << tracks.front() << ": " << (error_desc ? error_desc : "Unknown error")
+                      << "\n";
+            exit_code = 1;
+        } else {
+            ma_uint64 open_count = allocations.count.load();
+            ma_uint64 open_bytes = allocations.bytes.load();
+
+            // 输出缓冲和耗时记录在计时开始前分配好，测量循环中不再分配
+            ma_uint64 expected_frames = 0;
+            for (size_t i = 0; i < engine.trackCount(); ++i) {
+                expected_frames += engine.track(i).length_frames;
+            }
+            std::vector<ma_uint8> output((size_t)period_frames * ma_get_bytes_per_frame(engine.format(), engine.channels()));
+            std::vector<ma_uint32> durations;
+            durations.reserve((size_t)(expected_frames / period_frames) + 1024);
+
+            auto run_start = Clock::now();
+            engine.startHeadless();
+            while (engine.waitForData(period_frames)) {
+                t_in_render = true;
+                auto begin = Clock::now();
+                engine.render(output.data(), period_frames);
+                auto end = Clock::now();
+                t_in_render = false;
+                durations.push_back((ma_uint32)std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+            }
+            auto run_end = Clock::now();
+            engine.stop();
+
+            PlaybackBufferStats stats = engine.stats();
+            ma_uint64 frames = engine.position().delivered_frames;
+            double open_ms = std::chrono::duration<double, std::milli>(open_end - open_start).count();
+            double wall = std::chrono::duration<double>(run_end - run_start).count();
+            double audio_seconds = frames / (double)engine.sampleRate();
+
+            std::sort(durations.begin(), durations.end());
+
+            printf("Benchmark: %zu file(s), %.1f MB, %s %u ch %u Hz, period %u frames, %s I/O, lookahead %u ms, %s\n",
+                   tracks.size(), input_bytes / 1e6, ma_get_format_name(engine.format()), engine.channels(),
+                   engine.sampleRate(), period_frames, io_mode_name(engine.ioMode()),
+                   engine.lookaheadMs(), engine.crossfadeMs() > 0 ? "crossfade" : "gapless");
+            printf("  Open:          %.3f ms (first track)\n", open_ms);
+            printf("  Wall time:     %.3f s for %.1f s of audio (%.1fx realtime)\n", wall, audio_seconds,
+                   wall > 0 ? audio_seconds / wall : 0.0);
+            printf("  Decode:        %.1f MB/s input, %.2f M frames/s\n", wall > 0 ? input_bytes / 1e6 / wall : 0.0,
+                   wall > 0 ? frames / 1e6 / wall : 0.0);
+            printf("  Callback:      p50 %.2f us, p99 %.2f us, max %.2f us (%zu calls)\n",
+                   percentile(durations, 0.50) / 1000.0, percentile(durations, 0.99) / 1000.0,
+                   durations.empty() ? 0.0 : durations.back() / 1000.0, durations.size());
+            printf("  Underruns:     %llu (%llu frames)\n", (unsigned long long)stats.underruns,
+                   (unsigned long long)stats.underrun_frames);
+            if (engine.processingGraphActive()) {
+                printf("  %s\n", format_processing_stats(engine.processingStats()).c_str());
+            }
+            printf("  Allocations:   %llu during open (%.1f KB), %llu during playback (%.1f KB), %llu in callback\n",
+                   (unsigned long long)open_count, open_bytes / 1024.0,
+                   (unsigned long long)(allocations.count.load() - open_count),
+                   (allocations.bytes.load() - open_bytes) / 1024.0, (unsigned long long)allocations.render_count.load());
+
+            if (allocations.render_count.load() > 0) {
+                exit_code = 1;
+            }
+        }
+    }
+
+    if (!synth_path.empty()) {
+        std::remove(synth_path.c_str());
+    }
+    return exit_code;
+}
+
+namespace {
+
+// 解码输出格式：format 为 unknown、sample_rate 为 0 表示保持原始格式
+struct DecodeOutput {
+    const char* name;
+    ma_format format;
+    ma_uint32 sample_rate;
+};
+
+const DecodeOutput DECODE_OUTPUTS[] = {
+    {"native", ma_format_unknown, 0},
+    {"s16", ma_format_s16, 0},
+    {"f32", ma_format_f32, 0},
+    {"f32@48k", ma_format_f32, 48000},  // 包含重采样
+};
+
+// 生成的 WAV 语料：不同采样格式和采样率
+struct SynthSpec {
+    const char* name;
+    ma_format format;
+    ma_uint32 sample_rate;
+};
+
+const SynthSpec DECODE_CORPUS[] = {
+    {"wav_s16_44100", ma_format_s16, 44100},
+    {"wav_s16_48000", ma_format_s16, 48000},
+    {"wav_s24_48000", ma_format_s24, 48000},
+    {"wav_s24_96000", ma_format_s24, 96000},
+    {"wav_f32_48000", ma_format_f32, 48000},
+};
+
+struct DecodeInput {
+    std::string name;
+    std::string path;
+    AudioFormat format;
+    ma_uint64 bytes;
+    bool generated;
+};
+
+struct DecodeResult {
+    size_t input;
+    const DecodeOutput* output;
+    ma_uint32 chunk_frames;
+    size_t threads;
+    ma_uint64 frames;        // 所有线程解码的总帧数
+    ma_uint32 sample_rate;   // 输出采样率
+    double wall_seconds;
+
+    double audioSeconds() const { return sample_rate > 0 ? frames / (double)sample_rate : 0.0; }
+    double realtimeFactor() const { return wall_seconds > 0 ? audioSeconds() / wall_seconds : 0.0; }
+};
+
+// 完整解码一次，只计读取循环的时间（不含打开文件）
+bool decode_once(const std::string& path, const DecodeOutput& output, ma_uint32 chunk_frames, ma_uint64* frames,
+                 ma_uint32* sample_rate, double* seconds) {
+    ma_decoder_config config = ma_decoder_config_init(output.format, 0, output.sample_rate);
+    ma_decoder decoder;
+    if (ma_decoder_init_file(path.c_str(), &config, &decoder) != MA_SUCCESS) {
+        return false;
+    }
+
+    std::vector<ma_uint8> buffer((size_t)chunk_frames *
+                                 ma_get_bytes_per_frame(decoder.outputFormat, decoder.outputChannels));
+    ma_uint64 total = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (;;) {
+        ma_uint64 read = 0;
+        ma_result result = ma_decoder_read_pcm_frames(&decoder, buffer.data(), chunk_frames, &read);
+        total += read;
+        if (result != MA_SUCCESS || read < chunk_frames) {
+            break;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    *frames = total;
+    *sample_rate = decoder.outputSampleRate;
+    *seconds = std::chrono::duration<double>(end - begin).count();
+    ma_decoder_uninit(&decoder);
+    return true;
+}
+
+// threads 个线程同时各自完整解码同一个文件，重复 repeat 次取最快的一次
+bool measure_decode(const DecodeInput& input, const DecodeOutput& output, ma_uint32 chunk_frames, size_t threads,
+                    ma_uint32 repeat, DecodeResult* result) {
+    bool have_result = false;
+    for (ma_uint32 r = 0; r < std::max<ma_uint32>(repeat, 1); ++r) {
+        std::vector<ma_uint64> frames(threads, 0);
+        std::vector<double> seconds(threads, 0.0);
+        std::vector<char> ok(threads, 0);
+        ma_uint32 sample_rate = 0;
+
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                ma_uint32 rate = 0;
+                ok[t] = decode_once(input.path, output, chunk_frames, &frames[t], &rate, &seconds[t]);
+            });
+        }
+        ok[0] = decode_once(input.path, output, chunk_frames, &frames[0], &sample_rate, &seconds[0]);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        if (std::find(ok.begin(), ok.end(), 0) != ok.end()) {
+            return false;
+        }
+
+        // 并发时以最慢的线程作为整体耗时
+        DecodeResult run;
+        run.output = &output;
+        run.chunk_frames = chunk_frames;
+        run.threads = threads;
+        run.frames = 0;
+        for (ma_uint64 f : frames) {
+            run.frames += f;
+        }
+        run.sample_rate = sample_rate;
+        run.wall_seconds = *std::max_element(seconds.begin(), seconds.end());
+        if (!have_result || run.wall_seconds < result->wall_seconds) {
+            *result = run;
+            have_result = true;
+        }
+    }
+    return have_result;
+}
+
+std::string json_string(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char)c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)c);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+bool write_decode_json(const std::string& path, const std::vector<DecodeInput>& inputs,
+                       const std::vector<DecodeResult>& results, const DecodeBenchmarkOptions& options) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        return false;
+    }
+
+    char buf[512];
+    out << "{\n";
+    out << "  \"benchmark\": \"decode\",\n";
+    out << "  \"hardware_threads\": " << hardware_threads() << ",\n";
+    out << "  \"seconds\": " << options.seconds << ",\n";
+    out << "  \"repeat\": " << options.repeat << ",\n";
+    out << "  \"inputs\": [\n";
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        out << "    {\"name\": " << json_string(inputs[i].name) << ", \"format\": "
+            << json_string(audio_format_name(inputs[i].format)) << ", \"bytes\": " << inputs[i].bytes
+            << ", \"generated\": " << (inputs[i].generated ? "true" : "false") << "}"
+            << (i + 1 < inputs.size() ? ",\n" : "\n");
+    }
+    out << "  ],\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const DecodeResult& r = results[i];
+        snprintf(buf, sizeof(buf),
+                 "\"output\": \"%s\", \"chunk_frames\": %u, \"threads\": %zu, \"frames\": %llu, \"sample_rate\": %u, "
+                 "\"wall_seconds\": %.6f, \"realtime_factor\": %.2f, \"realtime_factor_per_thread\": %.2f, "
+                 "\"input_mb_per_second\": %.2f",
+                 r.output->name, r.chunk_frames, r.threads, (unsigned long long)r.frames, r.sample_rate,
+                 r.wall_seconds, r.realtimeFactor(), r.realtimeFactor() / r.threads,
+                 r.wall_seconds > 0 ? inputs[r.input].bytes * r.threads / 1e6 / r.wall_seconds : 0.0);
+        out << "    {\"input\": " << json_string(inputs[r.input].name) << ", " << buf << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n";
+    out << "}\n";
+    return out.good();
+}
+
+} // namespace
+
+int run_decode_benchmark(const std::vector<std::string>& files, const DecodeBenchmarkOptions& options) {
+    // 语料：生成的 WAV（miniaudio 的编码器只能写 WAV），以及命令行给出的 FLAC/MP3 等样本
+    std::vector<DecodeInput> inputs;
+    std::string prefix = temp_directory() + "/caudio_decode_" + std::to_string((long)getpid()) + "_";
+    std::cout << "Generating " << options.seconds << " s WAV corpus in " << temp_directory() << "\n";
+    for (const auto& spec : DECODE_CORPUS) {
+        DecodeInput input;
+        input.name = spec.name;
+        input.path = prefix + spec.name + ".wav";
+        input.format = AudioFormat::Wav;
+        input.generated = true;
+        if (!write_synth_wav(input.path, spec.format, spec.sample_rate, options.seconds)) {
+            std::cerr << "Error: Failed to write test signal: " << input.path << "\n";
+            std::remove(input.path.c_str());
+            for (const auto& generated : inputs) {
+                std::remove(generated.path.c_str());
+            }
+            return 1;
+        }
+        input.bytes = file_size(input.path);
+        inputs.push_back(input);
+    }
+    for (const auto& file : files) {
+        DecodeInput input;
+        size_t pos = file.find_last_of("/\\");
+        input.name = pos == std::string::npos ? file : file.substr(pos + 1);
+        input.path = file;
+        input.format = probe_audio_format(file);
+        input.bytes = file_size(file);
+        input.generated = false;
+        inputs.push_back(input);
+    }
+
+    // 核数：1, 2, 4, ... 直到硬件线程数
+    size_t max_threads = options.max_threads > 0 ? options.max_threads : hardware_threads();
+    std::vector<size_t> thread_counts;
+    for (size_t n = 1; n < max_threads; n *= 2) {
+        thread_counts.push_back(n);
+    }
+    thread_counts.push_back(max_threads);
+
+    std::vector<DecodeResult> results;
+    bool failed = false;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        const DecodeInput& input = inputs[i];
+        printf("\n%s (%s, %.1f MB)\n", input.name.c_str(), audio_format_name(input.format), input.bytes / 1e6);
+
+        // 单核：块大小 × 输出格式
+        printf("  %-9s", "chunk");
+        for (ma_uint32 chunk : DECODE_CHUNK_FRAMES) {
+            printf("%10u", chunk);
+        }
+        printf("   (x realtime, 1 thread)\n");
+
+        bool input_failed = false;
+        for (const auto& output : DECODE_OUTPUTS) {
+            printf("  %-9s", output.name);
+            for (ma_uint32 chunk : DECODE_CHUNK_FRAMES) {
+                DecodeResult result;
+                if (!measure_decode(input, output, chunk, 1, options.repeat, &result)) {
+                    input_failed = true;
+                    break;
+                }
+                result.input = i;
+                results.push_back(result);
+                printf("%10.0f", result.realtimeFactor());
+                fflush(stdout);
+            }
+            printf("\n");
+            if (input_failed) {
+                break;
+            }
+        }
+        if (input_failed) {
+            std::cerr << "Error: Failed to decode: " << input.path << "\n";
+            failed = true;
+            continue;
+        }
+
+        // 多核扩展：每个线程各自解码一份，原始输出格式
+        printf("  %-9s", "threads");
+        for (size_t threads : thread_counts) {
+            DecodeResult result;
+            if (!measure_decode(input, DECODE_OUTPUTS[0], DECODE_SCALING_CHUNK, threads, options.repeat, &result)) {
+                break;
+            }
+            result.input = i;
+            results.push_back(result);
+            printf("  %zu: %.0fx (%.0fx/thread)", threads, result.realtimeFactor(), result.realtimeFactor() / threads);
+            fflush(stdout);
+        }
+        printf("\n");
+    }
+
+    if (!options.json_path.empty()) {
+        if (write_decode_json(options.json_path, inputs, results, options)) {
+            std::cout << "\nResults written to " << options.json_path << "\n";
+        } else {
+            std::cerr << "Error: Failed to write " << options.json_path << "\n";
+            failed = true;
+        }
+    }
+
+    for (const auto& input : inputs) {
+        if (input.generated) {
+            std::remove(input.path.c_str());
+        }
+    }
+    return failed ? 1 : 0;
+}
+
+namespace {
+
+// 每次测量至少运行的时长，取多次测量中最快的一次
+const double DSP_MEASURE_SECONDS = 0.05;
+const int DSP_MEASURE_REPEAT = 3;
+
+enum class DspKernelKind { GainF32, RampF32, RampS16, MixF32 };
+
+struct DspCase {
+    const char* name;
+    DspKernelKind kind;
+    ma_uint32 channels;
+};
+
+const DspCase DSP_CASES[] = {
+    {"gain f32 2ch", DspKernelKind::GainF32, 2},
+    {"ramp f32 1ch", DspKernelKind::RampF32, 1},
+    {"ramp f32 2ch", DspKernelKind::RampF32, 2},
+    {"ramp f32 6ch", DspKernelKind::RampF32, 6},  // 不能整除向量宽度，走标量路径
+    {"ramp s16 2ch", DspKernelKind::RampS16, 2},
+    {"mix f32 2ch", DspKernelKind::MixF32, 2},
+};
+
+// 测试信号：幅度 0.5 的正弦，s16 版本与之对应
+void fill_dsp_input(std::vector<float>* f32, std::vector<ma_int16>* s16, size_t samples) {
+    f32->resize(samples);
+    s16->resize(samples);
+    for (size_t i = 0; i < samples; ++i) {
+        float v = 0.5f * (float)std::sin(TWO_PI * 997.0 * (double)i / SYNTH_SAMPLE_RATE);
+        (*f32)[i] = v;
+        (*s16)[i] = (ma_int16)std::lrint(v * 32767.0);
+    }
+}
+
+// 执行一次内核；odd 交替升降增益，反复处理同一块数据时幅度保持稳定
+void run_dsp_kernel(const DspKernels& kernels, const DspCase& test, float* f32, const float* other, ma_int16* s16,
+                    ma_uint32 frames, bool odd) {
+    float from = odd ? 1.25f : 0.8f;
+    float to = odd ? 0.8f : 1.25f;
+    switch (test.kind) {
+    case DspKernelKind::GainF32:
+        kernels.gain_ramp_f32(f32, frames, test.channels, from, from);
+        break;
+    case DspKernelKind::RampF32:
+        kernels.gain_ramp_f32(f32, frames, test.channels, from, to);
+        break;
+    case DspKernelKind::RampS16:
+        kernels.gain_ramp_s16(s16, frames, test.channels, from, to);
+        break;
+    case DspKernelKind::MixF32:
+        kernels.mix_f32(f32, other, (size_t)frames * test.channels, odd ? -0.5f : 0.5f);
+        break;
+    }
+}
+
+// 与标量实现比对一次处理的结果：f32 允许舍入误差，s16 允许 1 LSB
+bool check_dsp_kernel(const DspKernels& kernels, const DspCase& test, ma_uint32 frames, double* max_error) {
+    const DspKernels& scalar = *dsp_kernels_for(DspIsa::Scalar);
+    size_t samples = (size_t)frames * test.channels;
+    std::vector<float> expected_f32, actual_f32, other;
+    std::vector<ma_int16> expected_s16, actual_s16;
+    fill_dsp_input(&expected_f32, &expected_s16, samples);
+    other.assign(expected_f32.rbegin(), expected_f32.rend());
+    actual_f32 = expected_f32;
+    actual_s16 = expected_s16;
+
+    run_dsp_kernel(scalar, test, expected_f32.data(), other.data(), expected_s16.data(), frames, false);
+    run_dsp_kernel(kernels, test, actual_f32.data(), other.data(), actual_s16.data(), frames, false);
+
+    double error = 0.0;
+    for (size_t i = 0; i < samples; ++i) {
+        double diff = test.kind == DspKernelKind::RampS16 ? std::abs(expected_s16[i] - actual_s16[i])
+                                                          : std::fabs(expected_f32[i] - actual_f32[i]);
+        error = std::max(error, diff);
+    }
+    *max_error = error;
+    return test.kind == DspKernelKind::RampS16 ? error <= 1.0 : error <= 1e-5;
+}
+
+// 每个样本的平均耗时（纳秒）
+double measure_dsp_kernel(const DspKernels& kernels, const DspCase& test, ma_uint32 frames) {
+    size_t samples = (size_t)frames * test.channels;
+    std::vector<float> f32, other;
+    std::vector<ma_int16> s16;
+    fill_dsp_input(&f32, &s16, samples);
+    other = f32;
+
+    double best = 0.0;
+    for (int repeat = 0; repeat < DSP_MEASURE_REPEAT; ++repeat) {
+        ma_uint64 calls = 0;
+        auto begin = std::chrono::steady_clock::now();
+        double elapsed = 0.0;
+        do {
+            for (int i = 0; i < 64; ++i, ++calls) {
+                run_dsp_kernel(kernels, test, f32.data(), other.data(), s16.data(), frames, (calls & 1) != 0);
+            }
+            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        } while (elapsed < DSP_MEASURE_SECONDS);
+
+        double ns = elapsed * 1e9 / ((double)calls * samples);
+        if (repeat == 0 || ns < best) {
+            best = ns;
+        }
+    }
+
+    // 防止编译器认为结果无用而省略计算
+    volatile float sink = f32[samples / 2] + s16[samples / 2];
+    (void)sink;
+    return best;
+}
+
+// 满 EQ_MAX_BANDS 个频段的均衡器处理一个立体声 48 kHz 周期的耗时（微秒，含每次拷贝输入）
+double measure_equalizer(ma_uint32 frames) {
+    EqSettings settings;
+    settings.preamp_db = -6.0;
+    for (ma_uint32 i = 0; i < EQ_MAX_BANDS; ++i) {
+        EqBand band;
+        band.frequency = 31.25 * (1 << i);
+        band.gain_db = (i % 2 == 0) ? 3.0 : -3.0;
+        band.q = 1.41;
+        settings.bands.push_back(band);
+    }
+    Equalizer eq;
+    eq.configure(48000, 2, settings, true);
+
+    size_t samples = (size_t)frames * 2;
+    std::vector<float> input, buffer(samples);
+    std::vector<ma_int16> s16;
+    fill_dsp_input(&input, &s16, samples);
+
+    double best = 0.0;
+    for (int repeat = 0; repeat < DSP_MEASURE_REPEAT; ++repeat) {
+        ma_uint64 calls = 0;
+        auto begin = std::chrono::steady_clock::now();
+        double elapsed = 0.0;
+        do {
+            for (int i = 0; i < 64; ++i, ++calls) {
+                std::copy(input.begin(), input.end(), buffer.begin());
+                eq.process(buffer.data(), frames);
+            }
+            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        } while (elapsed < DSP_MEASURE_SECONDS);
+
+        double us = elapsed * 1e6 / (double)calls;
+        if (repeat == 0 || us < best) {
+            best = us;
+        }
+    }
+
+    volatile float sink = buffer[samples / 2];
+    (void)sink;
+    return best;
+}
+
+} // namespace
+
+int run_dsp_benchmark(ma_uint32 period_frames) {
+    std::vector<const DspKernels*> kernels;
+    for (DspIsa isa : {DspIsa::Scalar, DspIsa::Sse2, DspIsa::Avx2, DspIsa::Neon}) {
+        if (const DspKernels* k = dsp_kernels_for(isa)) {
+            kernels.push_back(k);
+        }
+    }
+
+    printf("DSP kernels: %u-frame blocks, runtime dispatch selects %s\n", period_frames,
+           dsp_isa_name(dsp_kernels().isa));
+    printf("  %-14s", "kernel");
+    for (const DspKernels* k : kernels) {
+        printf("%10s", dsp_isa_name(k->isa));
+    }
+    printf("   (ns/sample)  speedup\n");
+
+    bool failed = false;
+    for (const DspCase& test : DSP_CASES) {
+        printf("  %-14s", test.name);
+        double scalar_ns = 0.0;
+        double best_ns = 0.0;
+        for (const DspKernels* k : kernels) {
+            double error = 0.0;
+            if (!check_dsp_kernel(*k, test, period_frames, &error)) {
+                printf("%10s", "MISMATCH");
+                std::cerr << "\nError: " << dsp_isa_name(k->isa) << " " << test.name
+                          << " differs from scalar by " << error << "\n";
+                failed = true;
+                continue;
+            }
+            double ns = measure_dsp_kernel(*k, test, period_frames);
+            if (k->isa == DspIsa::Scalar) {
+                scalar_ns = ns;
+            }
+            if (best_ns == 0.0 || ns < best_ns) {
+                best_ns = ns;
+            }
+            printf("%10.3f", ns);
+            fflush(stdout);
+        }
+        printf("  %14.1fx\n", best_ns > 0 ? scalar_ns / best_ns : 0.0);
+    }
+
+    // 设备回调中的实际开销：立体声 f32 一个周期做一次增益渐变
+    const DspKernels& active = dsp_kernels();
+    double ns = measure_dsp_kernel(active, DSP_CASES[2], period_frames);
+    printf("\nVolume ramp per %u-frame stereo callback: %.2f us (%s)\n", period_frames,
+           ns * period_frames * 2 / 1000.0, dsp_isa_name(active.isa));
+    printf("Parametric EQ (%u bands) per %u-frame stereo callback: %.2f us\n", EQ_MAX_BANDS, period_frames,
+           measure_equalizer(period_frames));
+    return failed ? 1 : 0;
+}
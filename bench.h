@@ -0,0 +1,34 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "playback_engine.h"
+
+#include <string>
+#include <vector>
+
+// 基准测试默认的回调周期（帧），与常见设备周期相当
+constexpr ma_uint32 DEFAULT_BENCH_PERIOD_FRAMES = 512;
+
+// 无声卡基准测试：用与设备回调完全相同的输出路径驱动播放引擎，
+// 不受实时节奏限制，统计解码吞吐、每次回调耗时分布和内存分配次数。
+// files 为空时生成一段临时 WAV 作为测试数据
+int run_playback_benchmark(const std::vector<std::string>& files, const PlaybackEngineConfig& config,
+                           ma_uint32 period_frames);
+
+// 解码吞吐基准测试的参数
+struct DecodeBenchmarkOptions {
+    ma_uint32 seconds = 30;   // 生成语料的时长
+    ma_uint32 repeat = 3;     // 每个组合重复次数，取最快的一次
+    size_t max_threads = 0;   // 多核扩展测试的最大线程数，0 表示硬件线程数
+    std::string json_path;    // 非空时把结果写成 JSON
+};
+
+// 离线解码吞吐测试：生成不同采样格式和采样率的 WAV 语料（加上 files 中的样本），
+// 按块大小、输出格式和线程数组合直接调用 ma_decoder_read_pcm_frames，报告实时倍数
+int run_decode_benchmark(const std::vector<std::string>& files, const DecodeBenchmarkOptions& options);
+
+// DSP 内核微基准测试：对每个可用指令集（标量、SSE2、AVX2、NEON）的音量、增益渐变和混音内核，
+// 先与标量实现比对结果，再按设备周期大小的块反复处理，报告每个样本的耗时（纳秒）
+int run_dsp_benchmark(ma_uint32 period_frames);
+
+#endif // BENCH_H
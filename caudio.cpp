@@ -1,41 +1,60 @@
 // caudio.cpp
-#define MINIAUDIO_IMPLEMENTATION
 #include "third-party/miniaudio.h"
 #include "directory_manager.h"
+#include "playback_engine.h"
+#include "control_input.h"
+#include "daemon.h"
+#include "bench.h"
+#include "verify.h"
+#include "transcode.h"
 
 #include <iostream>
 #include <string>
 #include <vector>
+#include <map>
+#include <set>
 #include <sstream>
 #include <chrono>
 #include <thread>
 #include <cstdio>
 #include <csignal>
 #include <cstring>
-#include <fstream>
+#include <memory>
+#include <algorithm>
+#include <atomic>
 
-#ifdef _WIN32
-#include <conio.h>  // for _kbhit (optional)
-#else
-#include <unistd.h>
-#include <termios.h>
-#include <sys/ioctl.h>
+#ifndef _WIN32
+#include <climits>
+#include <cmath>
+#include <cstdlib>
 #endif
 
-bool g_stop = false;
-bool g_paused = false;  // 暂停状态
+// 信号处理函数和控制循环共享，使用无锁原子变量
+std::atomic<bool> g_stop(false);
+std::atomic<bool> g_paused(false);  // 暂停状态
+EventPipe* g_events = nullptr;  // 当前播放会话的唤醒管道
 
 void signal_handler(int sig) {
     g_stop = true;
+    if (g_events != nullptr) {
+        g_events->notify(EVENT_INTERRUPT);
+    }
 }
 
-// 播放状态结构
-struct PlaybackState {
-    ma_decoder* decoder;
-    ma_uint64 current_frame;
-    bool paused;
+// 播放参数
+struct PlayOptions {
+    double jump_seconds = 0.0;
+    bool local = false;  // 不转发给守护进程，在本进程内播放
+    bool trace_startup = false;  // 输出启动各阶段耗时（隐含 --local）
+    std::string eq_file;         // --eq 指定的均衡配置文件（播放中按 E 重新读取）
+    std::vector<std::string> files;  // 选项及其取值之外的参数
+    std::vector<std::string> engine_options;  // 给出的引擎参数（守护进程使用它启动时的参数，转发时不生效）
+    PlaybackEngineConfig engine;
 };
 
+// 进程启动时间（静态初始化，尽量接近 main 之前），作为 --trace-startup 的计时起点
+const std::chrono::steady_clock::time_point g_process_start = std::chrono::steady_clock::now();
+
 // 解析时间字符串 "MM:SS" 或 "HH:MM:SS" → 秒数
 double parse_time(const std::string& time_str) {
     std::vector<int> parts;
@@ -72,30 +91,254 @@ std::string format_time(double seconds) {
     }
 }
 
-// 简易非阻塞键盘检测（用于 Enter 暂停/继续）
-bool check_keyboard() {
+// 响度分析结果："-14.2 LUFS, peak -0.3 dBTP"
+std::string format_loudness(double lufs, double peak) {
+    char buf[64];
+    if (std::isfinite(lufs)) {
+        snprintf(buf, sizeof(buf), "%.1f LUFS, peak %.1f dBTP", lufs, amplitude_to_db(peak));
+    } else {
+        snprintf(buf, sizeof(buf), "silent");
+    }
+    return buf;
+}
+
+// 采样率、声道数和平均码率，例如 "  44.1 kHz, stereo, 320 kbps"（未知的字段不显示）
+std::string format_stream_info(const LibraryEntry& entry) {
+    std::string text;
+    auto append = [&](const std::string& part) {
+        text += text.empty() ? "  " : ", ";
+        text += part;
+    };
+    if (entry.sample_rate > 0) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%g kHz", entry.sample_rate / 1000.0);
+        append(buf);
+    }
+    if (entry.channels > 0) {
+        append(entry.channels == 1 ? "mono" : entry.channels == 2 ? "stereo" : std::to_string(entry.channels) + " ch");
+    }
+    if (entry.bitrate_kbps() > 0) {
+        append(std::to_string(entry.bitrate_kbps()) + " kbps");
+    }
+    if (entry.loudness.analyzed) {
+        append(format_loudness(entry.loudness.track_lufs, entry.loudness.track_peak));
+    }
+    return text;
+}
+
+// 标签显示为 "艺术家 - 标题 (专辑)"，缺少的部分省略
+std::string format_tags(const AudioTags& tags) {
+    std::string text = tags.artist;
+    if (!tags.title.empty()) {
+        text += (text.empty() ? "" : " - ") + tags.title;
+    }
+    if (!tags.album.empty()) {
+        text += (text.empty() ? "" : " ") + ("(" + tags.album + ")");
+    }
+    return text;
+}
+
+// 解析 play / directory play 的可选参数
+PlayOptions parse_play_options(int argc, char* argv[], int start) {
+    PlayOptions options;
+    for (int i = start; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 2, "--") == 0 && arg != "--jump" && arg != "--local" && arg != "--trace-startup") {
+            options.engine_options.push_back(arg);
+        }
+        if (arg == "--jump" && i + 1 < argc) {
+            options.jump_seconds = parse_time(argv[++i]);
+        } else if (arg == "--lookahead" && i + 1 < argc) {
+            int ms = std::stoi(argv[++i]);
+            options.engine.lookahead_ms = ms > 0 ? (ma_uint32)ms : DEFAULT_LOOKAHEAD_MS;
+        } else if (arg == "--crossfade" && i + 1 < argc) {
+            int ms = std::stoi(argv[++i]);
+            options.engine.crossfade_ms = ms > 0 ? (ma_uint32)ms : 0;
+        } else if (arg == "--local") {
+            options.local = true;
+        } else if (arg == "--trace-startup") {
+            options.trace_startup = true;
+            options.local = true;
+        } else if (arg == "--output" && i + 1 < argc) {
+            std::string format = argv[++i];
+            if (!parse_output_format(format, &options.engine.output_format)) {
+                std::cerr << "Warning: Invalid output format '" << format << "', using the track's format.\n";
+            }
+        } else if (arg == "--resampler" && i + 1 < argc) {
+            std::string quality = argv[++i];
+            if (!parse_resampler_quality(quality, &options.engine.resampler)) {
+                std::cerr << "Warning: Unknown resampler quality '" << quality << "', using medium.\n";
+            }
+        } else if (arg == "--device-reuse" && i + 1 < argc) {
+            std::string policy = argv[++i];
+            if (!parse_device_reuse(policy, &options.engine.device_reuse)) {
+                std::cerr << "Warning: Unknown device reuse policy '" << policy << "', using auto.\n";
+            }
+        } else if (arg == "--replaygain" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (!parse_replay_gain_mode(mode, &options.engine.replay_gain)) {
+                std::cerr << "Warning: Unknown ReplayGain mode '" << mode << "', playing without gain.\n";
+            }
+        } else if (arg == "--eq" && i + 1 < argc) {
+            std::string file = argv[++i];
+            std::string error;
+            if (load_eq_file(file, &options.engine.eq_settings, &error)) {
+                options.engine.eq = true;
+                options.eq_file = file;
+            } else {
+                std::cerr << "Warning: " << error << ", playing without equalizer.\n";
+            }
+        } else if (arg == "--limiter") {
+            options.engine.limiter = true;
+        } else if (arg == "--io" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (!parse_io_mode(mode, &options.engine.io_mode)) {
+                std::cerr << "Warning: Unknown I/O mode '" << mode << "', using stdio.\n";
+            } else if (options.engine.io_mode == IoMode::Mmap && !MMAP_IO_SUPPORTED) {
+                std::cerr << "Warning: mmap I/O is not supported on this platform, using stdio.\n";
+                options.engine.io_mode = IoMode::Stdio;
+            }
+        } else if (arg.compare(0, 2, "--") != 0) {
+            options.files.push_back(arg);
+        }
+    }
+    return options;
+}
+
+// 转换为绝对路径（发给守护进程的路径不能依赖客户端的工作目录）
+std::string absolute_path(const std::string& path) {
 #ifdef _WIN32
-    return _kbhit() != 0;
+    return path;
 #else
-    termios term;
-    tcgetattr(0, &term);
-    termios term2 = term;
-    term2.c_lflag &= ~ICANON;
-    tcsetattr(0, TCSANOW, &term2);
-    int byteswaiting;
-    ioctl(0, FIONREAD, &byteswaiting);
-    tcsetattr(0, TCSANOW, &term);
-    return byteswaiting > 0;
+    char resolved[PATH_MAX];
+    if (realpath(path.c_str(), resolved) != nullptr) {
+        return resolved;
+    }
+    return path;
 #endif
 }
 
-// 播放音频文件
-int play_audio(const std::string& audio_file, double jump_seconds = 0.0) {
+// 把命令发给守护进程并输出应答；守护进程没有运行时返回 false
+bool forward_to_daemon(const std::vector<std::string>& args, int* exit_code) {
+    DaemonReply reply;
+    if (!daemon_request(args, &reply)) {
+        return false;
+    }
+    if (reply.ok) {
+        std::cout << reply.message << "\n";
+    } else {
+        std::cerr << "Error: " << reply.message << "\n";
+    }
+    *exit_code = reply.ok ? 0 : 1;
+    return true;
+}
+
+// play / dir play 转发给守护进程后，提示本次给出的引擎参数没有生效
+void warn_ignored_engine_options(const PlayOptions& options) {
+    if (options.engine_options.empty()) {
+        return;
+    }
+    std::string names;
+    for (const auto& name : options.engine_options) {
+        names += (names.empty() ? "" : ", ") + name;
+    }
+    std::cerr << "Warning: " << names << " ignored: the running daemon keeps the options it was started with. "
+              << "Restart it with 'caudio daemon <options>' or add --local.\n";
+}
+
+// 提取文件名（去掉路径）
+std::string file_name(const std::string& path) {
+    size_t pos = path.find_last_of("/\\");
+    if (pos != std::string::npos) {
+        return path.substr(pos + 1);
+    }
+    return path;
+}
+
+// 显示曲目信息
+void print_track_header(const PlaybackEngine& engine, size_t index, double from_seconds) {
+    const TrackSlot& track = engine.track(index);
+    double duration_sec = track.length_frames / (double)engine.sampleRate();
+
+    if (engine.trackCount() > 1) {
+        std::cout << "\n[" << (index + 1) << "/" << engine.trackCount() << "] ";
+    }
+    std::cout << "\n========================================\n";
+    std::cout << "Playing: " << file_name(track.path) << "\n";
+    if (from_seconds > 0) {
+        std::cout << "From: " << format_time(from_seconds) << "\n";
+    }
+    std::cout << "Duration: " << format_time(duration_sec) << "\n";
+    std::cout << "Keys: Enter/Space pause, Left/Right seek 5s, Up/Down seek 60s, n/p next/prev, +/- volume, "
+              << (engine.eqAvailable() ? "e/E EQ on-off/reload, " : "") << "q quit\n";
+    std::cout << "========================================\n";
+}
+
+// 从曲库索引中取出队列各曲目的响度分析结果交给引擎，返回找到结果的曲目数。
+// 先查当前选中目录的索引，不在其中的曲目再查所在目录的（非递归）索引；只读取索引，不刷新
+size_t load_replay_gain(PlaybackEngine& engine) {
+    std::map<std::string, LoudnessInfo> loudness;
+    std::set<std::string> loaded;
+    auto add_index = [&loudness, &loaded](const std::string& dir, bool recursive) {
+        if (!loaded.insert(dir).second) {
+            return;
+        }
+        LibraryIndex index(dir, recursive);
+        if (index.load()) {
+            for (const auto& entry : index.entries()) {
+                if (entry.loudness.analyzed) {
+                    loudness[entry.path] = entry.loudness;
+                }
+            }
+        }
+    };
+
+    DirectoryManager manager;
+    if (!manager.getCurrentDirectory().empty()) {
+        add_index(manager.getCurrentDirectory(), manager.isCurrentRecursive());
+    }
+
+    size_t found = 0;
+    for (size_t i = 0; i < engine.trackCount(); ++i) {
+        const std::string& path = engine.track(i).path;
+        auto it = loudness.find(path);
+        if (it == loudness.end()) {
+            std::string absolute = absolute_path(path);
+            it = loudness.find(absolute);
+            size_t slash = absolute.find_last_of("/\\");
+            if (it == loudness.end() && slash != std::string::npos) {
+                add_index(absolute.substr(0, slash), false);
+                it = loudness.find(absolute);
+            }
+        }
+        if (it != loudness.end()) {
+            engine.setTrackLoudness(i, it->second);
+            ++found;
+        }
+    }
+    return found;
+}
+
+// 播放音频文件队列：整个队列共用一个播放设备，曲目之间无缝衔接
+int play_audio(const std::vector<std::string>& audio_files, const PlayOptions& options = PlayOptions()) {
     g_stop = false;
-    
-    // 检查文件是否存在
-    std::ifstream file_check(audio_file);
-    if (!file_check.good()) {
+    double jump_seconds = options.jump_seconds;
+    const std::string& audio_file = audio_files.front();
+
+    std::unique_ptr<StartupTrace> trace;
+    if (options.trace_startup) {
+        trace = std::make_unique<StartupTrace>(g_process_start);
+    }
+
+    // 设备线程先初始化音频后端，与打开第一首曲目并行；格式确定后立即打开设备，
+    // 与跳转、打印曲目信息同时进行
+    PlaybackEngine engine;
+    engine.setStartupTrace(trace.get());
+    engine.prepareDevice();
+
+    // 打开队列：第一首曲目在这里同步打开，后续曲目由解码线程预先打开
+    ma_result result = engine.open(audio_files, options.engine);
+    if (result == MA_DOES_NOT_EXIST || result == MA_ACCESS_DENIED) {
         std::cerr << "Error: File not found or cannot be accessed: " << audio_file << "\n";
         std::cerr << "  Please check:\n";
         std::cerr << "  - File path is correct\n";
@@ -103,93 +346,91 @@ int play_audio(const std::string& audio_file, double jump_seconds = 0.0) {
         std::cerr << "  - You have read permission\n";
         return 1;
     }
-    file_check.close();
-    
-    // 初始化解码器
-    ma_decoder decoder;
-    ma_result result = ma_decoder_init_file(audio_file.c_str(), nullptr, &decoder);
     if (result != MA_SUCCESS) {
         const char* error_desc = ma_result_description(result);
-        std::cerr << "Failed to open audio file: " << audio_file << "\n";
-        std::cerr << "  Error code: " << result << "\n";
-        std::cerr << "  Error description: " << (error_desc ? error_desc : "Unknown error") << "\n";
-        std::cerr << "  Possible reasons:\n";
-        std::cerr << "  - File format not supported (miniaudio supports: WAV, MP3, FLAC, OGG, M4A, AAC)\n";
-        std::cerr << "  - File is corrupted\n";
-        std::cerr << "  - File is not a valid audio file\n";
-        std::cerr << "  - Codec not available (may need additional libraries)\n";
+        if (engine.trackCount() > 0 && engine.track(0).result != MA_SUCCESS) {
+            std::cerr << "Failed to open audio file: " << audio_file << "\n";
+            std::cerr << "  Error code: " << result << "\n";
+            std::cerr << "  Error description: " << (error_desc ? error_desc : "Unknown error") << "\n";
+            std::cerr << "  Possible reasons:\n";
+            std::cerr << "  - File format not supported (miniaudio supports: WAV, MP3, FLAC, OGG, M4A, AAC)\n";
+            std::cerr << "  - File is corrupted\n";
+            std::cerr << "  - File is not a valid audio file\n";
+            std::cerr << "  - Codec not available (may need additional libraries)\n";
+        } else {
+            std::cerr << "Failed to allocate decode buffer.\n";
+            std::cerr << "  Error code: " << result << "\n";
+            std::cerr << "  Error description: " << (error_desc ? error_desc : "Unknown error") << "\n";
+        }
         return 1;
     }
 
     // 计算跳转帧数
-    ma_uint64 total_frames;
-    ma_result length_result = ma_decoder_get_length_in_pcm_frames(&decoder, &total_frames);
-    if (length_result != MA_SUCCESS) {
-        const char* error_desc = ma_result_description(length_result);
-        std::cerr << "Failed to get audio length.\n";
-        std::cerr << "  Error code: " << length_result << "\n";
-        std::cerr << "  Error description: " << (error_desc ? error_desc : "Unknown error") << "\n";
-        ma_decoder_uninit(&decoder);
-        return 1;
-    }
-    double duration_sec = total_frames / (double)decoder.outputSampleRate;
-    ma_uint64 jump_frames = (ma_uint64)(jump_seconds * decoder.outputSampleRate);
+    ma_uint64 total_frames = engine.track(0).length_frames;
+    double duration_sec = total_frames / (double)engine.sampleRate();
+    ma_uint64 jump_frames = (ma_uint64)(jump_seconds * engine.sampleRate());
 
     if (jump_frames >= total_frames) {
         std::cerr << "Jump time exceeds audio duration (" << format_time(duration_sec) << ")\n";
-        ma_decoder_uninit(&decoder);
         return 1;
     }
 
     // 跳转
     if (jump_frames > 0) {
-        ma_decoder_seek_to_pcm_frame(&decoder, jump_frames);
+        engine.seekFirstTrack(jump_frames);
     }
-    
-    // 显示播放信息
-    std::string filename = audio_file;
-    size_t pos = filename.find_last_of("/\\");
-    if (pos != std::string::npos) {
-        filename = filename.substr(pos + 1);
+
+    if (engine.trackCount() > 1) {
+        if (engine.crossfadeMs() > 0) {
+            std::cout << "Crossfade queue: " << engine.trackCount() << " file(s), "
+                      << engine.crossfadeMs() << " ms equal-power crossfade\n";
+        } else {
+            std::cout << "Gapless queue: " << engine.trackCount() << " file(s)\n";
+        }
     }
-    
-    std::cout << "\n========================================\n";
-    std::cout << "Playing: " << filename << "\n";
-    if (jump_seconds > 0) {
-        std::cout << "From: " << format_time(jump_seconds) << "\n";
+    // 设备格式固定时说明转换情况（后续曲目同样在解码线程中转换到该格式）
+    AudioOutputFormat output = {engine.format(), engine.channels(), engine.sampleRate()};
+    if (options.engine.output_format != AudioOutputFormat()) {
+        std::cout << "Output: " << describe_output_format(output);
+        // 采样格式由解码器后端直接按输出格式解码，只有采样率和声道数需要转换
+        AudioOutputFormat source = engine.sourceFormat();
+        if (source.sample_rate != output.sample_rate || source.channels != output.channels) {
+            source.format = ma_format_unknown;
+            std::cout << ", converted from " << describe_output_format(source) << " (resampler "
+                      << resampler_quality_name(options.engine.resampler) << ")";
+        }
+        std::cout << "\n";
     }
-    std::cout << "Duration: " << format_time(duration_sec) << "\n";
-    std::cout << "Press Enter to pause/resume, Ctrl+C to stop.\n";
-    std::cout << "========================================\n";
-
-    // 播放状态
-    PlaybackState playback_state;
-    playback_state.decoder = &decoder;
-    playback_state.current_frame = jump_frames;
-    playback_state.paused = false;
+    if (options.engine.replay_gain != ReplayGainMode::Off) {
+        size_t found = load_replay_gain(engine);
+        std::cout << "ReplayGain: " << replay_gain_mode_name(options.engine.replay_gain) << " gain for " << found
+                  << " of " << engine.trackCount() << " track(s)";
+        if (found > 0) {
+            char gain[32];
+            snprintf(gain, sizeof(gain), "%+.1f dB", amplitude_to_db(engine.track(0).replay_gain.load()));
+            std::cout << ", first track " << gain;
+        }
+        if (found < engine.trackCount()) {
+            std::cout << " (run 'caudio analyze' for the rest)";
+        }
+        std::cout << "\n";
+    }
+    if (engine.eqAvailable()) {
+        std::cout << "Equalizer: " << describe_eq(options.engine.eq_settings) << " from " << options.eq_file << "\n";
+    }
+    print_track_header(engine, 0, jump_seconds);
     g_paused = false;
 
-    // 设置播放设备
-    ma_device_config config = ma_device_config_init(ma_device_type_playback);
-    config.playback.format   = decoder.outputFormat;
-    config.playback.channels = decoder.outputChannels;
-    config.sampleRate        = decoder.outputSampleRate;
-    config.dataCallback      = [](ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount) {
-        PlaybackState* state = (PlaybackState*)pDevice->pUserData;
-        if (state->paused) {
-            // 暂停时填充静音
-            memset(pOutput, 0, frameCount * ma_get_bytes_per_frame(pDevice->playback.format, pDevice->playback.channels));
-        } else {
-            // 正常播放
-            ma_decoder_read_pcm_frames(state->decoder, pOutput, frameCount, nullptr);
-            state->current_frame += frameCount;
-        }
-    };
-    config.pUserData = &playback_state;
+    // 事件管道：音频回调（曲目切换、播放结束、设备停止）和 Ctrl+C 通过它唤醒控制循环
+    EventPipe events;
+    engine.setEventPipe(&events);
+    g_events = &events;
+    signal(SIGINT, signal_handler); // Ctrl+C 也能停
 
-    ma_device device;
-    result = ma_device_init(nullptr, &config, &device);
+    // 打开播放设备并开始解码
+    result = engine.start();
     if (result != MA_SUCCESS) {
+        g_events = nullptr;
         const char* error_desc = ma_result_description(result);
         std::cerr << "Failed to open playback device.\n";
         std::cerr << "  Error code: " << result << "\n";
@@ -198,70 +439,229 @@ int play_audio(const std::string& audio_file, double jump_seconds = 0.0) {
         std::cerr << "  - No audio output device available\n";
         std::cerr << "  - Audio device is in use by another application\n";
         std::cerr << "  - Audio driver issue\n";
-        ma_decoder_uninit(&decoder);
         return 1;
     }
 
-    signal(SIGINT, signal_handler); // Ctrl+C 也能停
+    if (trace != nullptr) {
+        trace->waitFirstSample(std::chrono::seconds(2));
+        trace->print(std::cout);
+        std::cout.flush();
+    }
 
-    ma_device_start(&device);
-
-    // 播放循环：显示进度 + 检测 Enter（暂停/继续）
-    while (!g_stop && ma_device_is_started(&device)) {
-        if (check_keyboard()) {
-            char ch = getchar();
-            if (ch == '\n' || ch == '\r') {
-                // 切换暂停状态
-                playback_state.paused = !playback_state.paused;
-                g_paused = playback_state.paused;
-                
-                if (playback_state.paused) {
-                    std::cout << "\n[PAUSED] ";
-                } else {
-                    std::cout << "\n[PLAYING] ";
-                }
-                fflush(stdout);
+    // 相对跳转：超过曲目末尾时跳到下一首，早于开头时停在开头
+    auto seek_relative = [&engine](const PlaybackPosition& from, double seconds) {
+        double rate = engine.sampleRate();
+        double target = std::max(0.0, from.track_frame / rate + seconds);
+        if (target * rate >= engine.track(from.track).length_frames) {
+            if (from.track + 1 < engine.trackCount()) {
+                engine.seek(from.track + 1, 0);
+            }
+            return;
+        }
+        engine.seek(from.track, (ma_uint64)(target * rate));
+    };
+
+    // 切换暂停状态
+    auto toggle_pause = [&engine]() {
+        engine.setPaused(!engine.paused());
+        g_paused.store(engine.paused());
+        std::cout << (engine.paused() ? "\n[PAUSED] " : "\n[PLAYING] ");
+        fflush(stdout);
+    };
+
+    // 播放循环：阻塞等待按键或事件，只在进度秒数变化时定时唤醒，暂停时不唤醒
+    ControlInput input(events);
+    size_t shown_track = 0;
+    bool running = true;
+    bool refresh_soon = false;  // 刚发出跳转请求，尽快刷新进度显示
+    while (running && !g_stop) {
+        // 曲目切换：显示新曲目信息，打开失败的曲目提示跳过；跳回之前的曲目时重新显示
+        PlaybackPosition position = engine.position();
+        size_t track_index = position.track;
+        if (track_index < shown_track) {
+            shown_track = track_index;
+            print_track_header(engine, shown_track, 0.0);
+        }
+        while (shown_track < track_index) {
+            ++shown_track;
+            const TrackSlot& track = engine.track(shown_track);
+            if (track.result != MA_SUCCESS) {
+                const char* error_desc = ma_result_description((ma_result)track.result.load());
+                std::cout << "\nSkipped: " << file_name(track.path) << " ("
+                          << (error_desc ? error_desc : "Unknown error") << ")\n";
+            } else {
+                print_track_header(engine, shown_track, 0.0);
             }
         }
 
-        // 显示进度（每0.5秒更新一次）
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
-        
         // 显示进度
-        double current_sec = playback_state.current_frame / (double)decoder.outputSampleRate;
-        if (current_sec > duration_sec) break;
+        const TrackSlot& current = engine.track(track_index);
+        ma_uint64 current_frame = position.track_frame;
+        double current_sec = current_frame / (double)engine.sampleRate();
+        double track_sec = current.length_frames / (double)engine.sampleRate();
 
         // 打印进度（清行重写）
-        std::string status = playback_state.paused ? "[PAUSED]" : "[PLAYING]";
-        printf("\r%s [%s / %s]", status.c_str(), format_time(current_sec).c_str(), format_time(duration_sec).c_str());
+        std::string status = engine.paused() ? "[PAUSED]" : "[PLAYING]";
+        printf("\r%s [%s / %s]", status.c_str(), format_time(current_sec).c_str(), format_time(track_sec).c_str());
         fflush(stdout);
+
+        // 下一次进度秒数变化的时间点
+        int timeout_ms = -1;
+        if (!engine.paused()) {
+            ma_uint64 frames_to_next = engine.sampleRate() - current_frame % engine.sampleRate();
+            timeout_ms = (int)(frames_to_next * 1000 / engine.sampleRate()) + 1;
+            timeout_ms = std::max(timeout_ms, 10);
+        }
+        if (refresh_soon) {
+            timeout_ms = 20;
+            refresh_soon = false;
+        }
+
+        ControlWakeup wakeup = input.wait(timeout_ms);
+
+        // 同一次唤醒中的多次跳转按键累加，以本次唤醒时的位置为起点
+        double seek_seconds = 0.0;
+        bool seek_pressed = false;
+        for (size_t i = 0; i < wakeup.key_count; ++i) {
+            const KeyEvent& key = wakeup.keys[i];
+            switch (key.key) {
+            case Key::Left:  seek_seconds -= 5;  seek_pressed = true; break;
+            case Key::Right: seek_seconds += 5;  seek_pressed = true; break;
+            case Key::Down:  seek_seconds -= 60; seek_pressed = true; break;
+            case Key::Up:    seek_seconds += 60; seek_pressed = true; break;
+            case Key::Enter:
+                toggle_pause();
+                break;
+            case Key::Char:
+                if (key.ch == ' ') {
+                    toggle_pause();
+                } else if (key.ch == 'n' && position.track + 1 < engine.trackCount()) {
+                    engine.seek(position.track + 1, 0);
+                    refresh_soon = true;
+                } else if (key.ch == 'p') {
+                    // 播放超过 3 秒时回到曲目开头，否则回到上一首
+                    bool restart = position.track == 0 || position.track_frame > 3 * (ma_uint64)engine.sampleRate();
+                    engine.seek(restart ? position.track : position.track - 1, 0);
+                    refresh_soon = true;
+                } else if (key.ch == '+' || key.ch == '=' || key.ch == '-') {
+                    engine.setVolume(engine.volume() + (key.ch == '-' ? -0.05f : 0.05f));
+                    printf("\n[VOLUME] %d%% ", (int)(engine.volume() * 100 + 0.5f));
+                    fflush(stdout);
+                } else if (key.ch == 'e' && engine.eqAvailable()) {
+                    engine.setEqEnabled(!engine.eqEnabled());
+                    printf("\n[EQ] %s ", engine.eqEnabled() ? "on" : "off");
+                    fflush(stdout);
+                } else if (key.ch == 'E' && engine.eqAvailable()) {
+                    // 重新读取配置文件：编辑后立即试听，新参数在回调中淡变生效
+                    EqSettings settings;
+                    std::string error;
+                    if (load_eq_file(options.eq_file, &settings, &error)) {
+                        engine.setEqSettings(settings);
+                        printf("\n[EQ] reloaded: %s ", describe_eq(settings).c_str());
+                    } else {
+                        printf("\n[EQ] %s ", error.c_str());
+                    }
+                    fflush(stdout);
+                } else if (key.ch == 'q' || key.ch == 'Q') {
+                    g_stop = true;
+                }
+                break;
+            }
+        }
+        if (seek_pressed) {
+            seek_relative(position, seek_seconds);
+            refresh_soon = true;
+        }
+
+        for (size_t i = 0; i < wakeup.event_count; ++i) {
+            switch (wakeup.events[i]) {
+            case EVENT_QUEUE_END:
+                running = false;
+                break;
+            case EVENT_DEVICE_STOPPED:
+                running = engine.deviceStarted();
+                break;
+            case EVENT_INTERRUPT:
+                g_stop = true;
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (engine.finished()) break;
     }
 
-    ma_device_uninit(&device);
-    ma_decoder_uninit(&decoder);
+    g_events = nullptr;
+    engine.stop();
+
+    PlaybackBufferStats stats = engine.stats();
 
     std::cout << "\n\nPlayback stopped.\n";
+    printf("Buffer: %s I/O, lookahead %u ms (%u frames), min fill %u frames, underruns %llu (%llu frames)\n",
+           io_mode_name(engine.ioMode()), engine.lookaheadMs(), stats.capacity_frames, stats.min_fill_frames,
+           (unsigned long long)stats.underruns, (unsigned long long)stats.underrun_frames);
+    if (engine.trackCount() > 1) {
+        printf("%s: %u transition(s), inter-track gap %llu frames total, %llu frames max\n",
+               engine.crossfadeMs() > 0 ? "Crossfade" : "Gapless", stats.transitions, (unsigned long long)stats.gap_frames,
+               (unsigned long long)stats.max_gap_frames);
+    }
+    if (engine.processingGraphActive()) {
+        std::cout << format_processing_stats(engine.processingStats()) << "\n";
+        if (options.engine.limiter) {
+            printf("Limiter: %llu frame(s) above %.1f dBFS\n", (unsigned long long)engine.limitedFrames(),
+                   LIMITER_CEILING_DB);
+        }
+    }
+    std::cout << format_device_stats(engine.deviceStats(), options.engine.device_reuse) << "\n";
     return 0;
 }
 
 // 显示帮助信息
 void show_help(const char* program_name) {
     std::cout << "Usage:\n";
-    std::cout << "  " << program_name << " play <audio_file> [--jump HH:MM:SS]\n";
-    std::cout << "  " << program_name << " directory|dir add <path>\n";
+    std::cout << "  " << program_name << " play <audio_file> [--jump HH:MM:SS] [--lookahead MS] [--io mmap|stdio] [--trace-startup]\n";
+    std::cout << "  " << program_name << " directory|dir add <path> [--recursive]\n";
     std::cout << "  " << program_name << " directory|dir remove <index>\n";
     std::cout << "  " << program_name << " directory|dir list\n";
     std::cout << "  " << program_name << " directory|dir select <index>\n";
     std::cout << "  " << program_name << " directory|dir files\n";
-    std::cout << "  " << program_name << " directory|dir play [--jump HH:MM:SS]\n";
+    std::cout << "  " << program_name << " directory|dir bench\n";
+    std::cout << "  " << program_name << " directory|dir play [--jump HH:MM:SS] [--lookahead MS] [--crossfade MS] [--io mmap|stdio]\n";
+    std::cout << "  " << program_name << " verify [dir] [--recursive] [--threads N]\n";
+    std::cout << "  " << program_name << " analyze [dir] [--recursive] [--threads N] [--force]\n";
+    std::cout << "  " << program_name << " transcode <src-dir> <dst-dir> [--format wav] [--rate HZ] [--channels N] [--sample-format s16|s24|s32|f32] [--recursive] [--threads N] [--io mmap|stdio]\n";
+    std::cout << "  " << program_name << " bench [audio_file...] [--period FRAMES] [--lookahead MS] [--crossfade MS] [--io mmap|stdio]\n";
+    std::cout << "  " << program_name << " bench decode [audio_file...] [--seconds N] [--repeat N] [--threads N] [--json FILE]\n";
+    std::cout << "  " << program_name << " bench dsp [--period FRAMES]\n";
+    std::cout << "  " << program_name << " daemon [--lookahead MS] [--crossfade MS] [--io mmap|stdio] [--device-reuse auto|reopen|convert]\n";
+    std::cout << "  " << program_name << " daemon stop|ping\n";
+    std::cout << "  " << program_name << " pause|resume|toggle|next|prev|stop|status|stats\n";
+    std::cout << "  " << program_name << " seek <HH:MM:SS>\n";
+    std::cout << "  " << program_name << " eq [on|off|toggle|<file>]\n";
+    std::cout << "  " << program_name << " queue <audio_file>...\n";
+    std::cout << "\nWhile a daemon is running, play and dir play are sent to it (use --local to play in-process).\n";
+    std::cout << "\nOutput options (play, dir play, daemon):\n";
+    std::cout << "  --output FORMAT         Pin the device format, e.g. f32/48k/stereo; unset parts follow the first track\n";
+    std::cout << "  --resampler QUALITY     Sample rate conversion quality: low, medium (default) or high\n";
+    std::cout << "  --replaygain MODE       Normalize loudness with 'caudio analyze' results: off (default), track or album\n";
+    std::cout << "  --eq FILE               Parametric EQ (peak/lowshelf/highshelf lines or an EqualizerAPO export)\n";
+    std::cout << "  --limiter               Peak limiter at the end of the processing graph (ceiling -1 dBFS)\n";
     std::cout << "\nExamples:\n";
     std::cout << "  " << program_name << " play song.wav\n";
     std::cout << "  " << program_name << " play song.wav --jump 1:30\n";
+    std::cout << "  " << program_name << " play song.mp3 --trace-startup\n";
+    std::cout << "  " << program_name << " play song.flac --output f32/48k/stereo --resampler high\n";
     std::cout << "  " << program_name << " dir add C:\\Music\n";
+    std::cout << "  " << program_name << " dir add /mnt/nas/music --recursive\n";
     std::cout << "  " << program_name << " dir list\n";
     std::cout << "  " << program_name << " dir select 0\n";
     std::cout << "  " << program_name << " dir files\n";
     std::cout << "  " << program_name << " dir play\n";
+    std::cout << "  " << program_name << " dir play --crossfade 3000\n";
+    std::cout << "  " << program_name << " analyze\n";
+    std::cout << "  " << program_name << " dir play --replaygain album\n";
+    std::cout << "  " << program_name << " play song.flac --eq headphones.txt\n";
 }
 
 int main(int argc, char* argv[]) {
@@ -293,7 +693,16 @@ int main(int argc, char* argv[]) {
                 std::cerr << "Error: directory add requires a path.\n";
                 return 1;
             }
-            return manager.addDirectory(argv[3]) ? 0 : 1;
+            bool recursive = false;
+            for (int i = 4; i < argc; ++i) {
+                std::string arg = argv[i];
+                if (arg == "--recursive" || arg == "-r") {
+                    recursive = true;
+                } else {
+                    std::cerr << "Warning: Unknown option: " << arg << "\n";
+                }
+            }
+            return manager.addDirectory(argv[3], recursive) ? 0 : 1;
         }
         else if (subcmd == "remove") {
             if (argc < 4) {
@@ -322,24 +731,101 @@ int main(int argc, char* argv[]) {
                 return 1;
             }
             
-            auto files = manager.getAudioFiles();
-            if (files.empty()) {
+            // 提取文件名（去掉路径）；递归目录显示相对路径以区分子目录
+            auto display_name = [&](const std::string& path) {
+                if (manager.isCurrentRecursive() && path.compare(0, current_dir.size(), current_dir) == 0) {
+                    return path.substr(current_dir.size() + 1);
+                }
+                size_t pos = path.find_last_of("/\\");
+                return pos != std::string::npos ? path.substr(pos + 1) : path;
+            };
+
+            // 按文件头探测结果区分可播放和无法解码的文件
+            std::vector<LibraryEntry> playable, skipped;
+            for (auto& entry : manager.getLibraryEntries()) {
+                (entry.decodable() ? playable : skipped).push_back(entry);
+            }
+            if (playable.empty() && skipped.empty()) {
                 std::cout << "No audio files found in: " << current_dir << "\n";
                 return 0;
             }
             
             std::cout << "Audio files in: " << current_dir << "\n";
-            std::cout << "Total: " << files.size() << " file(s)\n\n";
+            std::cout << "Total: " << playable.size() << " file(s)\n\n";
             
-            for (size_t i = 0; i < files.size(); ++i) {
-                // 提取文件名（去掉路径）
-                std::string filename = files[i];
-                size_t pos = filename.find_last_of("/\\");
-                if (pos != std::string::npos) {
-                    filename = filename.substr(pos + 1);
+            // 时长、格式和标签都来自索引（文件头探测结果），以 ~ 开头的时长是按码率估算的值
+            size_t estimated = 0;
+            for (size_t i = 0; i < playable.size(); ++i) {
+                const LibraryEntry& entry = playable[i];
+                std::cout << "  " << (i + 1) << ". " << display_name(entry.path);
+                if (entry.duration_ms > 0) {
+                    std::cout << "  [" << (entry.duration_exact ? "" : "~") << format_time(entry.duration_ms / 1000.0) << "]";
                 }
-                
-                std::cout << "  " << (i + 1) << ". " << filename << "\n";
+                std::cout << format_stream_info(entry) << "\n";
+                if (!entry.tags.empty()) {
+                    std::cout << "     " << format_tags(entry.tags) << "\n";
+                }
+                if (!entry.duration_exact && !entry.duration_unmeasurable) {
+                    ++estimated;
+                }
+            }
+
+            if (!skipped.empty()) {
+                std::cout << "\nSkipped " << skipped.size() << " undecodable file(s):\n";
+                for (const auto& entry : skipped) {
+                    std::cout << "  - " << display_name(entry.path) << " ("
+                              << (entry.detected == AudioFormat::Unknown ? "unrecognized content"
+                                                                        : std::string(audio_format_name(entry.detected)) + " is not supported")
+                              << ")\n";
+                }
+            }
+
+            // 列表先输出，再对没有时长头的文件完整扫描，精确时长写回索引，下次直接显示
+            if (estimated > 0) {
+                std::cout << "\nCounting exact duration of " << estimated << " file(s) without a length header...\n";
+                std::cout.flush();
+                LibraryIndex index(current_dir, manager.isCurrentRecursive());
+                index.load();
+                std::atomic<bool> abort{false};
+                size_t measured = index.measure(abort);
+                index.save();
+                std::cout << "Cached " << measured << " exact duration(s) in the index.\n";
+            }
+            return 0;
+        }
+        else if (subcmd == "bench") {
+            std::string current_dir = manager.getCurrentDirectory();
+            if (current_dir.empty()) {
+                std::cerr << "Error: No directory selected. Use 'directory select <index>' first.\n";
+                return 1;
+            }
+
+            using Clock = std::chrono::steady_clock;
+
+            // 冷启动：不读取索引，完整扫描目录
+            auto cold_start = Clock::now();
+            LibraryIndex cold(current_dir, manager.isCurrentRecursive());
+            IndexRefreshStats cold_stats = cold.refresh();
+            auto cold_end = Clock::now();
+            cold.save();
+
+            // 热启动：读取索引，只校验目录修改时间
+            auto warm_start = Clock::now();
+            LibraryIndex warm(current_dir, manager.isCurrentRecursive());
+            warm.load();
+            IndexRefreshStats warm_stats = warm.refresh();
+            auto warm_end = Clock::now();
+
+            double cold_ms = std::chrono::duration<double, std::milli>(cold_end - cold_start).count();
+            double warm_ms = std::chrono::duration<double, std::milli>(warm_end - warm_start).count();
+
+            std::cout << "Listing benchmark for: " << current_dir << "\n";
+            printf("  Cold (full scan):   %zu file(s) in %.3f ms, %zu dir(s), %zu thread(s)\n",
+                   cold_stats.files, cold_ms, cold_stats.directories_rescanned, cold_stats.threads);
+            printf("  Warm (index):       %zu file(s) in %.3f ms, %zu of %zu dir(s) rescanned\n",
+                   warm_stats.files, warm_ms, warm_stats.directories_rescanned, warm_stats.directories_checked);
+            if (warm_ms > 0) {
+                printf("  Speedup:            %.1fx\n", cold_ms / warm_ms);
             }
             return 0;
         }
@@ -350,32 +836,28 @@ int main(int argc, char* argv[]) {
                 return 1;
             }
 
+            // 解析 --jump / --lookahead / --crossfade 参数
+            PlayOptions options = parse_play_options(argc, argv, 3);
+
+            // 守护进程在运行时由它通过常驻索引列出目录并播放
+            int exit_code = 0;
+            if (!options.local &&
+                forward_to_daemon({"play-dir", std::to_string(options.jump_seconds),
+                                   manager.isCurrentRecursive() ? "1" : "0", absolute_path(current_dir)},
+                                  &exit_code)) {
+                warn_ignored_engine_options(options);
+                return exit_code;
+            }
+
             auto files = manager.getAudioFiles();
             if (files.empty()) {
                 std::cerr << "Error: No audio files found in selected directory.\n";
                 return 1;
             }
 
-            double jump_seconds = 0.0;
-            // 解析 --jump 参数
-            for (int i = 3; i < argc; ++i) {
-                if (std::string(argv[i]) == "--jump" && i + 1 < argc) {
-                    jump_seconds = parse_time(argv[i + 1]);
-                    break;
-                }
-            }
-
-            // 播放列表中的所有文件
+            // 播放列表中的所有文件（--jump 只作用于第一个文件）
             std::cout << "Playing " << files.size() << " file(s) from: " << current_dir << "\n";
-            for (size_t i = 0; i < files.size(); ++i) {
-                std::cout << "\n[" << (i + 1) << "/" << files.size() << "] ";
-                int result = play_audio(files[i], (i == 0) ? jump_seconds : 0.0);
-                if (result != 0 || g_stop) {
-                    break;
-                }
-                g_stop = false; // 重置停止标志
-            }
-            return 0;
+            return play_audio(files, options);
         }
         else {
             std::cerr << "Error: Unknown directory subcommand: " << subcmd << "\n";
@@ -383,6 +865,296 @@ int main(int argc, char* argv[]) {
             return 1;
         }
     }
+    // 批量校验：多线程完整解码目录中的所有文件
+    else if (command == "verify") {
+        std::string dir;
+        bool recursive = false;
+        size_t threads = 0;
+        for (int i = 2; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--recursive" || arg == "-r") {
+                recursive = true;
+            } else if (arg == "--threads" && i + 1 < argc) {
+                int n = std::stoi(argv[++i]);
+                threads = n > 0 ? (size_t)n : 0;
+            } else if (arg.compare(0, 2, "--") == 0) {
+                std::cerr << "Warning: Unknown option: " << arg << "\n";
+            } else {
+                dir = arg;
+            }
+        }
+
+        std::vector<LibraryEntry> entries;
+        if (dir.empty()) {
+            // 未指定目录时校验当前选中的目录
+            DirectoryManager manager;
+            dir = manager.getCurrentDirectory();
+            if (dir.empty()) {
+                std::cerr << "Error: No directory given or selected. Use 'verify <dir>' or 'directory select <index>' first.\n";
+                return 1;
+            }
+            entries = manager.getLibraryEntries();
+        } else {
+            LibraryIndex index(absolute_path(dir), recursive);
+            index.load();
+            index.update();
+            entries = index.entries();
+        }
+
+        if (entries.empty()) {
+            std::cout << "No audio files found in: " << dir << "\n";
+            return 0;
+        }
+        std::cout << "Verifying " << entries.size() << " file(s) in: " << dir << "\n";
+        return run_verify(entries, threads);
+    }
+    // 响度分析：多线程完整解码，测量积分响度和真峰值并写入曲库索引
+    else if (command == "analyze") {
+        std::string dir;
+        bool recursive = false;
+        bool force = false;
+        size_t threads = 0;
+        for (int i = 2; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--recursive" || arg == "-r") {
+                recursive = true;
+            } else if (arg == "--threads" && i + 1 < argc) {
+                int n = std::stoi(argv[++i]);
+                threads = n > 0 ? (size_t)n : 0;
+            } else if (arg == "--force") {
+                force = true;
+            } else if (arg.compare(0, 2, "--") == 0) {
+                std::cerr << "Warning: Unknown option: " << arg << "\n";
+            } else {
+                dir = arg;
+            }
+        }
+
+        // 未指定目录时分析当前选中的目录，结果写入它的索引，dir play --replaygain 直接使用
+        if (dir.empty()) {
+            DirectoryManager manager;
+            dir = manager.getCurrentDirectory();
+            if (dir.empty()) {
+                std::cerr << "Error: No directory given or selected. Use 'analyze <dir>' or 'directory select <index>' first.\n";
+                return 1;
+            }
+            recursive = manager.isCurrentRecursive();
+        } else {
+            dir = absolute_path(dir);
+        }
+
+        LibraryIndex index(dir, recursive);
+        index.load();
+        index.update();
+        std::cout << "Analyzing loudness in: " << dir << "\n";
+        std::cout.flush();
+
+        auto begin = std::chrono::steady_clock::now();
+        AnalyzeStats stats = index.analyze(threads, force, [](size_t done, size_t total, const LibraryEntry& entry,
+                                                              const std::string& error) {
+            if (error.empty()) {
+                printf("[%zu/%zu] %s  %s\n", done, total, format_loudness(entry.loudness.track_lufs,
+                                                                         entry.loudness.track_peak).c_str(),
+                       entry.path.c_str());
+            } else {
+                printf("[%zu/%zu] FAIL  %s: %s\n", done, total, entry.path.c_str(), error.c_str());
+            }
+            fflush(stdout);
+        });
+        double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        if (stats.files == 0) {
+            std::cout << "All files are already analyzed (use --force to analyze again).\n";
+            return 0;
+        }
+        index.save();
+
+        // 专辑值在全部曲目完成后才确定，单独列出
+        std::cout << "\nAlbums:\n";
+        std::set<std::string> listed;
+        for (const auto& entry : index.entries()) {
+            if (!entry.loudness.analyzed) {
+                continue;
+            }
+            size_t slash = entry.path.find_last_of("/\\");
+            std::string album = (slash != std::string::npos ? entry.path.substr(0, slash) : std::string(".")) +
+                                (entry.tags.album.empty() ? "" : " (" + entry.tags.album + ")");
+            if (listed.insert(album).second) {
+                char gain[32];
+                LoudnessInfo info = entry.loudness;
+                snprintf(gain, sizeof(gain), "%+.1f dB", amplitude_to_db(replay_gain_linear(info, ReplayGainMode::Album)));
+                std::cout << "  " << album << ": " << format_loudness(info.album_lufs, info.album_peak) << ", gain "
+                          << gain << "\n";
+            }
+        }
+
+        printf("\nAnalyzed %zu file(s) with %zu thread(s) in %.2f s: %zu OK, %zu failed\n", stats.files, stats.threads,
+               wall, stats.files - stats.failed, stats.failed);
+        printf("Measured %s of audio at %.0fx realtime\n", format_time(stats.audio_seconds).c_str(),
+               wall > 0 ? stats.audio_seconds / wall : 0.0);
+        return stats.failed > 0 ? 1 : 0;
+    }
+    // 批量转码：解码 → 采样率/声道转换 → WAV 编码，多个文件并行
+    else if (command == "transcode") {
+        std::vector<std::string> dirs;
+        TranscodeOptions options;
+        for (int i = 2; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--format" && i + 1 < argc) {
+                options.format = argv[++i];
+            } else if (arg == "--rate" && i + 1 < argc) {
+                int rate = std::stoi(argv[++i]);
+                options.sample_rate = rate > 0 ? (ma_uint32)rate : 0;
+            } else if (arg == "--channels" && i + 1 < argc) {
+                int channels = std::stoi(argv[++i]);
+                options.channels = channels > 0 ? (ma_uint32)channels : 0;
+            } else if (arg == "--sample-format" && i + 1 < argc) {
+                std::string format = argv[++i];
+                if (format == "s16") {
+                    options.sample_format = ma_format_s16;
+                } else if (format == "s24") {
+                    options.sample_format = ma_format_s24;
+                } else if (format == "s32") {
+                    options.sample_format = ma_format_s32;
+                } else if (format == "f32") {
+                    options.sample_format = ma_format_f32;
+                } else {
+                    std::cerr << "Warning: Unknown sample format '" << format << "', keeping the source format.\n";
+                }
+            } else if (arg == "--recursive" || arg == "-r") {
+                options.recursive = true;
+            } else if (arg == "--threads" && i + 1 < argc) {
+                int n = std::stoi(argv[++i]);
+                options.threads = n > 0 ? (size_t)n : 0;
+            } else if (arg == "--io" && i + 1 < argc) {
+                std::string mode = argv[++i];
+                if (!parse_io_mode(mode, &options.io_mode)) {
+                    std::cerr << "Warning: Unknown I/O mode '" << mode << "', using stdio.\n";
+                } else if (options.io_mode == IoMode::Mmap && !MMAP_IO_SUPPORTED) {
+                    std::cerr << "Warning: mmap I/O is not supported on this platform, using stdio.\n";
+                    options.io_mode = IoMode::Stdio;
+                }
+            } else if (arg.compare(0, 2, "--") == 0) {
+                std::cerr << "Warning: Unknown option: " << arg << "\n";
+            } else {
+                dirs.push_back(arg);
+            }
+        }
+
+        if (dirs.size() != 2) {
+            std::cerr << "Error: transcode requires a source and a destination directory.\n";
+            return 1;
+        }
+        return run_transcode(absolute_path(dirs[0]), dirs[1], options);
+    }
+    // 基准测试：不打开声卡，按设备回调的路径尽快驱动整个播放流程
+    else if (command == "bench" && argc >= 3 && std::string(argv[2]) == "dsp") {
+        ma_uint32 period = DEFAULT_BENCH_PERIOD_FRAMES;
+        for (int i = 3; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--period" && i + 1 < argc) {
+                int frames = std::stoi(argv[++i]);
+                period = frames > 0 ? (ma_uint32)frames : DEFAULT_BENCH_PERIOD_FRAMES;
+            } else {
+                std::cerr << "Warning: Unknown option: " << arg << "\n";
+            }
+        }
+        return run_dsp_benchmark(period);
+    }
+    else if (command == "bench" && argc >= 3 && std::string(argv[2]) == "decode") {
+        // 离线解码吞吐：格式 × 块大小 × 输出格式 × 线程数
+        std::vector<std::string> files;
+        DecodeBenchmarkOptions options;
+        for (int i = 3; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--seconds" && i + 1 < argc) {
+                int seconds = std::stoi(argv[++i]);
+                options.seconds = seconds > 0 ? (ma_uint32)seconds : options.seconds;
+            } else if (arg == "--repeat" && i + 1 < argc) {
+                int repeat = std::stoi(argv[++i]);
+                options.repeat = repeat > 0 ? (ma_uint32)repeat : options.repeat;
+            } else if (arg == "--threads" && i + 1 < argc) {
+                int threads = std::stoi(argv[++i]);
+                options.max_threads = threads > 0 ? (size_t)threads : 0;
+            } else if (arg == "--json" && i + 1 < argc) {
+                options.json_path = argv[++i];
+            } else if (arg.compare(0, 2, "--") == 0) {
+                std::cerr << "Warning: Unknown option: " << arg << "\n";
+            } else {
+                files.push_back(arg);
+            }
+        }
+        return run_decode_benchmark(files, options);
+    }
+    else if (command == "bench") {
+        // --period 只用于基准测试，其余参数（引擎选项和文件）与 play 相同，交给 parse_play_options
+        ma_uint32 period = DEFAULT_BENCH_PERIOD_FRAMES;
+        std::vector<char*> play_args;
+        for (int i = 2; i < argc; ++i) {
+            if (std::string(argv[i]) == "--period" && i + 1 < argc) {
+                int frames = std::stoi(argv[++i]);
+                period = frames > 0 ? (ma_uint32)frames : DEFAULT_BENCH_PERIOD_FRAMES;
+            } else {
+                play_args.push_back(argv[i]);
+            }
+        }
+        PlayOptions options = parse_play_options((int)play_args.size(), play_args.data(), 0);
+        return run_playback_benchmark(options.files, options.engine, period);
+    }
+    // 守护进程：常驻播放设备和曲库索引，其他命令作为客户端通过控制套接字与之通信
+    else if (command == "daemon") {
+        std::string subcmd = argc >= 3 ? argv[2] : "";
+        if (subcmd == "stop" || subcmd == "ping") {
+            auto begin = std::chrono::steady_clock::now();
+            DaemonReply reply;
+            if (!daemon_request({subcmd == "stop" ? "shutdown" : "ping"}, &reply)) {
+                std::cerr << "Error: caudio daemon is not running.\n";
+                return 1;
+            }
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+            std::cout << reply.message;
+            if (subcmd == "ping") {
+                printf(" (round trip %.3f ms)", ms);
+            }
+            std::cout << "\n";
+            return reply.ok ? 0 : 1;
+        }
+
+        // 引擎参数（--lookahead / --crossfade / --io）在守护进程启动时指定
+        PlayOptions options = parse_play_options(argc, argv, 2);
+        return run_daemon(options.engine);
+    }
+    else if (command == "pause" || command == "resume" || command == "toggle" || command == "next" ||
+             command == "prev" || command == "stop" || command == "status" || command == "stats" || command == "seek" ||
+             command == "queue" || command == "eq") {
+        std::vector<std::string> args = {command};
+        if (command == "seek") {
+            if (argc < 3) {
+                std::cerr << "Error: seek requires a time (HH:MM:SS, MM:SS or SS).\n";
+                return 1;
+            }
+            args.push_back(std::to_string(parse_time(argv[2])));
+        } else if (command == "queue") {
+            if (argc < 3) {
+                std::cerr << "Error: queue requires at least one audio file.\n";
+                return 1;
+            }
+            for (int i = 2; i < argc; ++i) {
+                args.push_back(absolute_path(argv[i]));
+            }
+        } else if (command == "eq" && argc >= 3) {
+            std::string arg = argv[2];
+            bool keyword = arg == "on" || arg == "off" || arg == "toggle";
+            args.push_back(keyword ? arg : absolute_path(arg));
+        }
+
+        int exit_code = 0;
+        if (!forward_to_daemon(args, &exit_code)) {
+            std::cerr << "Error: caudio daemon is not running. Start it with '" << argv[0] << " daemon'.\n";
+            return 1;
+        }
+        return exit_code;
+    }
     // 处理 play 命令
     else if (command == "play") {
         if (argc < 3) {
@@ -392,15 +1164,9 @@ int main(int argc, char* argv[]) {
         }
 
         std::string audio_file = argv[2];
-        double jump_seconds = 0.0;
 
-        // 解析 --jump 参数
-        for (int i = 3; i < argc; ++i) {
-            if (std::string(argv[i]) == "--jump" && i + 1 < argc) {
-                jump_seconds = parse_time(argv[i + 1]);
-                break;
-            }
-        }
+        // 解析 --jump / --lookahead 参数
+        PlayOptions options = parse_play_options(argc, argv, 3);
 
         // 检查是否是相对路径（不包含路径分隔符）
         bool is_relative_path = (audio_file.find('/') == std::string::npos && 
@@ -420,7 +1186,14 @@ int main(int argc, char* argv[]) {
             }
         }
 
-        return play_audio(audio_file, jump_seconds);
+        int exit_code = 0;
+        if (!options.local &&
+            forward_to_daemon({"play", std::to_string(options.jump_seconds), absolute_path(audio_file)}, &exit_code)) {
+            warn_ignored_engine_options(options);
+            return exit_code;
+        }
+
+        return play_audio({audio_file}, options);
     }
     else {
         std::cerr << "Error: Unknown command: " << command << "\n";
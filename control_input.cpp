@@ -0,0 +1,232 @@
+#include "control_input.h"
+
+#include <chrono>
+#include <thread>
+
+#ifdef _WIN32
+#include <conio.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+EventPipe::EventPipe() : queue_(), write_pos_(0), pending_count_(0), read_pos_(0) {
+}
+
+EventPipe::~EventPipe() {
+}
+
+void EventPipe::notify(char event) {
+    if (pending_count_.load() >= QUEUE_SIZE) {
+        return;  // 队列已满时丢弃，控制循环仍会被已有事件唤醒
+    }
+    size_t pos = write_pos_.fetch_add(1) % QUEUE_SIZE;
+    queue_[pos] = event;
+    pending_count_.fetch_add(1);
+}
+
+size_t EventPipe::drain(char* events, size_t max_events) {
+    size_t count = 0;
+    while (count < max_events && pending_count_.load() > 0) {
+        events[count++] = queue_[read_pos_];
+        read_pos_ = (read_pos_ + 1) % QUEUE_SIZE;
+        pending_count_.fetch_sub(1);
+    }
+    return count;
+}
+
+#else
+
+EventPipe::EventPipe() {
+    fds_[0] = fds_[1] = -1;
+    if (pipe(fds_) == 0) {
+        // 两端都设为非阻塞：写端满了丢弃事件，读端用于一次性取空
+        fcntl(fds_[0], F_SETFL, fcntl(fds_[0], F_GETFL) | O_NONBLOCK);
+        fcntl(fds_[1], F_SETFL, fcntl(fds_[1], F_GETFL) | O_NONBLOCK);
+        fcntl(fds_[0], F_SETFD, FD_CLOEXEC);
+        fcntl(fds_[1], F_SETFD, FD_CLOEXEC);
+    }
+}
+
+EventPipe::~EventPipe() {
+    if (fds_[0] >= 0) close(fds_[0]);
+    if (fds_[1] >= 0) close(fds_[1]);
+}
+
+void EventPipe::notify(char event) {
+    if (fds_[1] >= 0) {
+        int saved_errno = errno;  // 信号处理函数中不能改变 errno
+        ssize_t ignored = write(fds_[1], &event, 1);
+        (void)ignored;
+        errno = saved_errno;
+    }
+}
+
+size_t EventPipe::drain(char* events, size_t max_events) {
+    if (fds_[0] < 0) {
+        return 0;
+    }
+    ssize_t n = read(fds_[0], events, max_events);
+    return n > 0 ? (size_t)n : 0;
+}
+
+#endif
+
+ControlInput::ControlInput(EventPipe& events)
+    : events_(events), stdin_open_(true), pending_(), pending_count_(0) {
+#ifndef _WIN32
+    raw_mode_ = false;
+    if (isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &saved_) == 0) {
+        termios raw = saved_;
+        raw.c_lflag &= ~(ICANON | ECHO);
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
+        raw_mode_ = tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0;
+    }
+#endif
+}
+
+ControlInput::~ControlInput() {
+#ifndef _WIN32
+    if (raw_mode_) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &saved_);
+    }
+#endif
+}
+
+void ControlInput::decodeKeys(const char* bytes, size_t count, ControlWakeup* wakeup) {
+    auto push = [wakeup](Key key, char ch) {
+        if (wakeup->key_count < ControlWakeup::MAX_BYTES) {
+            wakeup->keys[wakeup->key_count++] = KeyEvent{key, ch};
+        }
+    };
+    auto arrow = [](char code, Key* key) {
+        switch (code) {
+#ifdef _WIN32
+        case 'H': *key = Key::Up;    return true;
+        case 'P': *key = Key::Down;  return true;
+        case 'M': *key = Key::Right; return true;
+        case 'K': *key = Key::Left;  return true;
+#else
+        case 'A': *key = Key::Up;    return true;
+        case 'B': *key = Key::Down;  return true;
+        case 'C': *key = Key::Right; return true;
+        case 'D': *key = Key::Left;  return true;
+#endif
+        default:  return false;
+        }
+    };
+
+    for (size_t i = 0; i < count; ++i) {
+        char ch = bytes[i];
+        if (pending_count_ == 0) {
+#ifdef _WIN32
+            // 控制台的功能键是两个字节：0x00 或 0xE0 前缀加扫描码
+            bool prefix = ch == 0 || ch == (char)0xE0;
+#else
+            bool prefix = ch == '\x1b';
+#endif
+            if (prefix) {
+                pending_[pending_count_++] = ch;
+            } else if (ch == '\n' || ch == '\r') {
+                push(Key::Enter, ch);
+            } else {
+                push(Key::Char, ch);
+            }
+            continue;
+        }
+
+        pending_[pending_count_++] = ch;
+        Key key;
+#ifdef _WIN32
+        if (arrow(ch, &key)) {
+            push(key, 0);
+        }
+        pending_count_ = 0;
+#else
+        // ESC [ ... 终结字节 或 ESC O 终结字节；参数部分（如 Shift 修饰）忽略
+        if (pending_count_ == 2) {
+            if (ch != '[' && ch != 'O') {
+                pending_count_ = 0;  // 单独的 ESC：丢弃
+            }
+            continue;
+        }
+        if (ch >= 0x40 && ch <= 0x7E) {
+            if (arrow(ch, &key)) {
+                push(key, 0);
+            }
+            pending_count_ = 0;
+        } else if (pending_count_ == sizeof(pending_)) {
+            pending_count_ = 0;  // 无法识别的长序列
+        }
+#endif
+    }
+}
+
+#ifdef _WIN32
+
+ControlWakeup ControlInput::wait(int timeout_ms) {
+    // Windows 控制台没有可 poll 的句柄，退化为 10ms 轮询
+    ControlWakeup wakeup;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    for (;;) {
+        char bytes[ControlWakeup::MAX_BYTES];
+        size_t count = 0;
+        while (_kbhit() && count < ControlWakeup::MAX_BYTES) {
+            bytes[count++] = (char)_getch();
+        }
+        decodeKeys(bytes, count, &wakeup);
+        wakeup.event_count = events_.drain(wakeup.events, ControlWakeup::MAX_BYTES);
+        if (wakeup.key_count > 0 || wakeup.event_count > 0) {
+            return wakeup;
+        }
+        if (timeout_ms >= 0 && std::chrono::steady_clock::now() >= deadline) {
+            wakeup.timed_out = true;
+            return wakeup;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+#else
+
+ControlWakeup ControlInput::wait(int timeout_ms) {
+    ControlWakeup wakeup;
+
+    pollfd fds[2];
+    fds[0].fd = events_.readFd();
+    fds[0].events = POLLIN;
+    fds[1].fd = stdin_open_ ? STDIN_FILENO : -1;
+    fds[1].events = POLLIN;
+
+    int ready = poll(fds, 2, timeout_ms);
+    if (ready == 0) {
+        wakeup.timed_out = true;
+        return wakeup;
+    }
+    if (ready < 0) {
+        return wakeup;  // EINTR：信号处理函数已写入唤醒管道，下次 poll 会立即返回
+    }
+
+    if (fds[0].revents & POLLIN) {
+        wakeup.event_count = events_.drain(wakeup.events, ControlWakeup::MAX_BYTES);
+    }
+    if (fds[1].revents & (POLLIN | POLLHUP)) {
+        char bytes[ControlWakeup::MAX_BYTES];
+        ssize_t n = read(STDIN_FILENO, bytes, sizeof(bytes));
+        if (n > 0) {
+            decodeKeys(bytes, (size_t)n, &wakeup);
+        } else if (n == 0) {
+            stdin_open_ = false;  // stdin 已关闭（重定向自文件或管道）
+        }
+    } else if (fds[1].revents & (POLLERR | POLLNVAL)) {
+        stdin_open_ = false;
+    }
+    return wakeup;
+}
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef CONTROL_INPUT_H
+#define CONTROL_INPUT_H
+
+#include <atomic>
+#include <cstddef>
+
+#ifndef _WIN32
+#include <termios.h>
+#endif
+
+// 播放事件（通过唤醒管道传递的单字节）
+enum PlaybackEvent : char {
+    EVENT_TRACK_CHANGED  = 't',  // 回调越过曲目边界
+    EVENT_QUEUE_END      = 'e',  // 队列播放完毕
+    EVENT_DEVICE_STOPPED = 's',  // 设备被停止（拔出、驱动错误等）
+    EVENT_INTERRUPT      = 'i',  // 收到 SIGINT
+};
+
+// 唤醒管道：音频线程和信号处理函数写入事件，控制循环在 poll() 中等待
+// notify() 只调用非阻塞 write()，可在信号处理函数和实时回调中使用
+class EventPipe {
+public:
+    EventPipe();
+    ~EventPipe();
+
+    EventPipe(const EventPipe&) = delete;
+    EventPipe& operator=(const EventPipe&) = delete;
+
+    void notify(char event);
+
+    // 取出所有待处理事件，返回事件个数
+    size_t drain(char* events, size_t max_events);
+
+#ifdef _WIN32
+    bool pending() const { return pending_count_.load() > 0; }
+#else
+    int readFd() const { return fds_[0]; }
+#endif
+
+private:
+#ifdef _WIN32
+    static constexpr size_t QUEUE_SIZE = 64;
+    char queue_[QUEUE_SIZE];
+    std::atomic<size_t> write_pos_;
+    std::atomic<size_t> pending_count_;
+    size_t read_pos_;
+#else
+    int fds_[2];
+#endif
+};
+
+// 按键：终端转义序列（方向键等）解码后的结果
+enum class Key : char {
+    Char,   // 普通字符，见 KeyEvent::ch
+    Enter,
+    Left,
+    Right,
+    Up,
+    Down,
+};
+
+struct KeyEvent {
+    Key key;
+    char ch;  // Key::Char 时的字符
+};
+
+// 一次唤醒的结果
+struct ControlWakeup {
+    static constexpr size_t MAX_BYTES = 32;
+    KeyEvent keys[MAX_BYTES];  // 从终端读到并解码的按键
+    size_t key_count = 0;
+    char events[MAX_BYTES];    // 唤醒管道中的事件
+    size_t event_count = 0;
+    bool timed_out = false;
+};
+
+// 控制输入：整个播放会话只把终端切换一次到非规范、无回显模式，
+// 之后在 stdin 和唤醒管道上阻塞等待，没有按键和事件时不会被唤醒
+class ControlInput {
+public:
+    explicit ControlInput(EventPipe& events);
+    ~ControlInput();  // 恢复终端设置
+
+    ControlInput(const ControlInput&) = delete;
+    ControlInput& operator=(const ControlInput&) = delete;
+
+    // 等待按键或事件；timeout_ms < 0 表示无限等待
+    ControlWakeup wait(int timeout_ms);
+
+private:
+    // 把读到的原始字节解码为按键；转义序列可能被拆在两次读取之间，未完成的部分留到下一次
+    void decodeKeys(const char* bytes, size_t count, ControlWakeup* wakeup);
+
+    EventPipe& events_;
+    bool stdin_open_;   // stdin 到达 EOF 后不再监听
+    char pending_[8];   // 未完成的转义序列
+    size_t pending_count_;
+#ifndef _WIN32
+    bool raw_mode_;
+    termios saved_;
+#endif
+};
+
+#endif // CONTROL_INPUT_H
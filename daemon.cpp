@@ -0,0 +1,754 @@
+#include "daemon.h"
+#include "control_input.h"
+#include "library_index.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// 协议：客户端每次连接发送一行命令，命令名和参数之间用制表符分隔（路径中可以有空格）；
+// 守护进程回复一行 "OK <消息>" 或 "ERR <消息>" 后关闭连接
+static const size_t MAX_REQUEST_BYTES = 1 << 20;
+
+#ifndef _WIN32
+// 没有 XDG_RUNTIME_DIR 时套接字放在本用户的私有目录中（0700），
+// 不直接放在 /tmp 下，避免其他用户预先占用固定的路径
+static std::string daemon_fallback_directory() {
+    return "/tmp/caudio-" + std::to_string((unsigned long)getuid());
+}
+#endif
+
+std::string daemon_socket_path() {
+    const char* env = std::getenv("CAUDIO_SOCKET");
+    if (env != nullptr && env[0] != '\0') {
+        return env;
+    }
+#ifdef _WIN32
+    return "";
+#else
+    // XDG_RUNTIME_DIR 由登录会话创建，只有本用户可以访问
+    const char* runtime = std::getenv("XDG_RUNTIME_DIR");
+    if (runtime != nullptr && runtime[0] == '/') {
+        return std::string(runtime) + "/caudio.sock";
+    }
+    return daemon_fallback_directory() + "/daemon.sock";
+#endif
+}
+
+#ifdef _WIN32
+
+int run_daemon(const PlaybackEngineConfig&) {
+    std::cerr << "Error: Daemon mode requires Unix domain sockets and is not supported on this platform.\n";
+    return 1;
+}
+
+bool daemon_request(const std::vector<std::string>&, DaemonReply*) {
+    return false;
+}
+
+#else
+
+namespace {
+
+EventPipe* g_daemon_events = nullptr;
+
+void daemon_signal_handler(int) {
+    if (g_daemon_events != nullptr) {
+        g_daemon_events->notify(EVENT_INTERRUPT);
+    }
+}
+
+std::string format_seconds(double seconds) {
+    int total = (int)seconds;
+    char buf[32];
+    if (total >= 3600) {
+        snprintf(buf, sizeof(buf), "%d:%02d:%02d", total / 3600, (total % 3600) / 60, total % 60);
+    } else {
+        snprintf(buf, sizeof(buf), "%d:%02d", total / 60, total % 60);
+    }
+    return buf;
+}
+
+std::string base_name(const std::string& path) {
+    size_t pos = path.find_last_of('/');
+    return pos == std::string::npos ? path : path.substr(pos + 1);
+}
+
+std::string parent_path(const std::string& path) {
+    size_t pos = path.find_last_of('/');
+    if (pos == std::string::npos) {
+        return ".";
+    }
+    return pos == 0 ? "/" : path.substr(0, pos);
+}
+
+// 套接字所在目录必须属于本用户或 root，其他用户可写时必须带粘滞位（如 /tmp），
+// 否则别人可以随时把套接字换掉
+bool directory_trusted(const std::string& dir, std::string* error) {
+    struct stat info;
+    if (lstat(dir.c_str(), &info) != 0 || !S_ISDIR(info.st_mode)) {
+        *error = dir + " is not a directory";
+        return false;
+    }
+    if (info.st_uid != getuid() && info.st_uid != 0) {
+        *error = dir + " is owned by another user";
+        return false;
+    }
+    if ((info.st_mode & (S_IWGRP | S_IWOTH)) != 0 && (info.st_mode & S_ISVTX) == 0) {
+        *error = dir + " is writable by other users";
+        return false;
+    }
+    return true;
+}
+
+enum class SocketState {
+    Missing,    // 不存在
+    Owned,      // 本用户的套接字
+    Untrusted,  // 属于其他用户，或不是套接字，或所在目录不可信
+};
+
+// 连接或删除之前检查套接字的所有者，避免连到其他用户抢先创建的监听端，或删掉别人的文件
+SocketState check_socket(const std::string& path, std::string* error) {
+    if (!directory_trusted(parent_path(path), error)) {
+        return SocketState::Untrusted;
+    }
+    struct stat info;
+    if (lstat(path.c_str(), &info) != 0) {
+        if (errno == ENOENT) {
+            return SocketState::Missing;
+        }
+        *error = path + ": " + strerror(errno);
+        return SocketState::Untrusted;
+    }
+    if (!S_ISSOCK(info.st_mode)) {
+        *error = path + " is not a socket";
+        return SocketState::Untrusted;
+    }
+    if (info.st_uid != getuid()) {
+        *error = path + " is owned by another user";
+        return SocketState::Untrusted;
+    }
+    return SocketState::Owned;
+}
+
+// 默认路径的目录（/tmp/caudio-<uid>），不存在时以 0700 创建；已存在时必须是本用户的私有目录
+bool prepare_socket_directory(const std::string& path, std::string* error) {
+    std::string dir = parent_path(path);
+    if (dir != daemon_fallback_directory()) {
+        return true;
+    }
+    if (mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST) {
+        *error = "cannot create " + dir + ": " + strerror(errno);
+        return false;
+    }
+    struct stat info;
+    if (lstat(dir.c_str(), &info) != 0 || !S_ISDIR(info.st_mode) || info.st_uid != getuid() ||
+        (info.st_mode & (S_IRWXG | S_IRWXO)) != 0) {
+        *error = dir + " is not a private directory of the current user";
+        return false;
+    }
+    return true;
+}
+
+bool fill_address(const std::string& path, sockaddr_un* addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr->sun_path)) {
+        return false;
+    }
+    memcpy(addr->sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+// 连接守护进程，失败时返回 -1；套接字不属于本用户时不连接
+int connect_daemon() {
+    std::string path = daemon_socket_path();
+    sockaddr_un addr;
+    if (!fill_address(path, &addr)) {
+        return -1;
+    }
+    std::string error;
+    SocketState state = check_socket(path, &error);
+    if (state != SocketState::Owned) {
+        if (state == SocketState::Untrusted) {
+            std::cerr << "Warning: Ignoring daemon socket: " << error << "\n";
+        }
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (const sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool write_all(int fd, const std::string& data) {
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        done += (size_t)n;
+    }
+    return true;
+}
+
+// 读取一行（不含换行符），连接关闭或超出长度时返回 false
+bool read_line(int fd, std::string* line) {
+    line->clear();
+    char buf[4096];
+    while (line->size() < MAX_REQUEST_BYTES) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        line->append(buf, (size_t)n);
+        size_t newline = line->find('\n');
+        if (newline != std::string::npos) {
+            line->resize(newline);
+            return true;
+        }
+    }
+    return false;
+}
+
+// 常驻播放服务：队列保存在守护进程中，引擎按需从队列中的某个位置重新打开
+class PlaybackDaemon {
+public:
+    explicit PlaybackDaemon(const PlaybackEngineConfig& config)
+        : config_(config), base_(0), announced_(SIZE_MAX), paused_(false) {
+    }
+
+    ~PlaybackDaemon() {
+        stopEngine();
+    }
+
+    int run(const std::string& socket_path);
+
+private:
+    std::string handle(const std::vector<std::string>& args);
+    void handleEvents();
+
+    // 从队列第 index 首的 seconds 秒处开始播放，打开失败的曲目依次跳过
+    bool startAt(size_t index, double seconds, std::string* error);
+    void stopEngine();
+
+    bool playing() const { return engine_ != nullptr; }
+    size_t currentIndex() const { return base_ + engine_->position().track; }
+
+    std::string status() const;
+    // 引擎中第 track 首曲目、第 frame 帧处的状态行
+    std::string describe(size_t track, ma_uint64 frame) const;
+
+    // 队列中第 index 首曲目已在当前引擎中时，用引擎的跳转（丢弃缓冲，一个设备周期内生效）；
+    // 否则重新打开引擎
+    bool jumpTo(size_t index, double seconds, std::string* error);
+
+    // 曲库索引常驻内存，每次只校验目录修改时间
+    bool libraryFiles(const std::string& dir, bool recursive, std::vector<std::string>* files);
+
+    // 在常驻索引中查找文件（不在其中时加载所在目录的非递归索引），没有时返回 nullptr
+    const LibraryEntry* libraryEntry(const std::string& path);
+
+    PlaybackEngineConfig config_;
+    EventPipe events_;
+    AudioOutput output_;  // 播放设备在守护进程的整个生命周期内保持打开，由先后创建的引擎共用
+    std::unique_ptr<PlaybackEngine> engine_;
+    std::vector<std::string> queue_;
+    size_t base_;       // 引擎第 0 首对应的队列位置
+    size_t announced_;  // 最近一次输出 "Playing:" 的队列位置
+    bool paused_;
+    std::map<std::string, std::unique_ptr<LibraryIndex>> indexes_;
+};
+
+int PlaybackDaemon::run(const std::string& socket_path) {
+    sockaddr_un addr;
+    if (!fill_address(socket_path, &addr)) {
+        std::cerr << "Error: Invalid socket path: " << socket_path << "\n";
+        return 1;
+    }
+
+    std::string error;
+    if (!prepare_socket_directory(socket_path, &error)) {
+        std::cerr << "Error: " << error << "\n";
+        return 1;
+    }
+    // 不是本用户的套接字时既不连接也不删除
+    SocketState state = check_socket(socket_path, &error);
+    if (state == SocketState::Untrusted) {
+        std::cerr << "Error: Refusing to use " << socket_path << ": " << error << "\n";
+        return 1;
+    }
+
+    // 已有守护进程在运行时不抢占；连接不上说明是上次残留的套接字文件
+    if (state == SocketState::Owned) {
+        int probe = connect_daemon();
+        if (probe >= 0) {
+            close(probe);
+            std::cerr << "Error: caudio daemon is already running on " << socket_path << "\n";
+            return 1;
+        }
+        unlink(socket_path.c_str());
+    }
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0 || bind(listen_fd, (const sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, 16) != 0) {
+        std::cerr << "Error: Cannot listen on " << socket_path << ": " << strerror(errno) << "\n";
+        if (listen_fd >= 0) close(listen_fd);
+        return 1;
+    }
+    chmod(socket_path.c_str(), 0600);
+
+    g_daemon_events = &events_;
+    signal(SIGINT, daemon_signal_handler);
+    signal(SIGTERM, daemon_signal_handler);
+
+    std::cout << "caudio daemon listening on " << socket_path << "\n";
+    std::cout.flush();
+
+    bool running = true;
+    while (running) {
+        pollfd fds[2];
+        fds[0].fd = listen_fd;
+        fds[0].events = POLLIN;
+        fds[1].fd = events_.readFd();
+        fds[1].events = POLLIN;
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        if (fds[1].revents & POLLIN) {
+            char events[ControlWakeup::MAX_BYTES];
+            size_t count = events_.drain(events, sizeof(events));
+            for (size_t i = 0; i < count; ++i) {
+                if (events[i] == EVENT_INTERRUPT) {
+                    running = false;
+                }
+            }
+            handleEvents();
+        }
+
+        if (running && (fds[0].revents & POLLIN)) {
+            int client = accept(listen_fd, nullptr, nullptr);
+            if (client < 0) {
+                continue;
+            }
+
+            // 客户端迟迟不发送命令时不能卡住整个服务
+            timeval timeout = {1, 0};
+            setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+            std::string line;
+            if (read_line(client, &line)) {
+                std::vector<std::string> args;
+                std::stringstream ss(line);
+                std::string arg;
+                while (std::getline(ss, arg, '\t')) {
+                    args.push_back(arg);
+                }
+
+                std::string reply = handle(args);
+                write_all(client, reply + "\n");
+                if (!args.empty() && args[0] == "shutdown") {
+                    running = false;
+                }
+            }
+            close(client);
+        }
+    }
+
+    g_daemon_events = nullptr;
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    stopEngine();
+    close(listen_fd);
+    unlink(socket_path.c_str());
+    std::cout << "caudio daemon stopped.\n";
+    return 0;
+}
+
+void PlaybackDaemon::handleEvents() {
+    if (!playing()) {
+        return;
+    }
+
+    // 事件不区分引擎实例，以引擎当前状态为准
+    if (engine_->finished()) {
+        size_t next = base_ + engine_->trackCount();
+        stopEngine();
+        std::string error;
+        if (next < queue_.size() && !startAt(next, 0, &error)) {
+            std::cerr << "Error: " << error << "\n";
+        }
+        return;
+    }
+    if (!engine_->deviceStarted()) {
+        std::cerr << "Error: Playback device stopped.\n";
+        stopEngine();
+        return;
+    }
+
+    size_t index = currentIndex();
+    if (index != announced_) {
+        announced_ = index;
+        std::cout << "Playing: " << base_name(queue_[index]) << "\n";
+        std::cout.flush();
+    }
+}
+
+bool PlaybackDaemon::startAt(size_t index, double seconds, std::string* error) {
+    stopEngine();
+    announced_ = SIZE_MAX;
+
+    while (index < queue_.size()) {
+        auto engine = std::make_unique<PlaybackEngine>();
+        engine->setOutput(&output_);
+        engine->prepareDevice();
+        std::vector<std::string> tracks(queue_.begin() + index, queue_.end());
+        ma_result result = engine->open(tracks, config_);
+        if (result != MA_SUCCESS) {
+            if (engine->trackCount() > 0 && engine->track(0).result != MA_SUCCESS) {
+                // 第一首打不开：跳过它，与队列中间打开失败的曲目一样处理
+                std::cerr << "Skipped: " << base_name(queue_[index]) << " (" << ma_result_description(result) << ")\n";
+                ++index;
+                seconds = 0;
+                continue;
+            }
+            *error = std::string("Failed to allocate decode buffer: ") + ma_result_description(result);
+            return false;
+        }
+
+        if (config_.replay_gain != ReplayGainMode::Off) {
+            for (size_t i = 0; i < tracks.size(); ++i) {
+                if (const LibraryEntry* entry = libraryEntry(tracks[i])) {
+                    engine->setTrackLoudness(i, entry->loudness);
+                }
+            }
+        }
+
+        // 跳转位置按第一首曲目打开后确定的输出采样率换算
+        ma_uint64 frame = (ma_uint64)(seconds * engine->sampleRate());
+        if (frame >= engine->track(0).length_frames) {
+            *error = "Seek position exceeds track duration (" +
+                     format_seconds(engine->track(0).length_frames / (double)engine->sampleRate()) + ")";
+            return false;
+        }
+        if (frame > 0) {
+            engine->seekFirstTrack(frame);
+        }
+
+        engine->setEventPipe(&events_);
+        engine->setPaused(paused_);
+        result = engine->start();
+        if (result != MA_SUCCESS) {
+            *error = std::string("Failed to open playback device: ") + ma_result_description(result);
+            return false;
+        }
+
+        engine_ = std::move(engine);
+        base_ = index;
+        handleEvents();
+        return true;
+    }
+
+    *error = "No playable file in queue";
+    return false;
+}
+
+void PlaybackDaemon::stopEngine() {
+    if (engine_ != nullptr) {
+        engine_->stop();
+        engine_.reset();
+    }
+}
+
+std::string PlaybackDaemon::status() const {
+    if (!playing()) {
+        return "OK stopped, " + std::to_string(queue_.size()) + " track(s) in queue";
+    }
+
+    PlaybackPosition position = engine_->position();
+    return describe(position.track, position.track_frame);
+}
+
+std::string PlaybackDaemon::describe(size_t track_index, ma_uint64 frame) const {
+    const TrackSlot& track = engine_->track(track_index);
+    double rate = engine_->sampleRate();
+    return std::string("OK ") + (paused_ ? "paused" : "playing") + " [" + std::to_string(base_ + track_index + 1) + "/" +
+           std::to_string(queue_.size()) + "] " + base_name(track.path) + " " + format_seconds(frame / rate) +
+           " / " + format_seconds(track.length_frames / rate);
+}
+
+bool PlaybackDaemon::jumpTo(size_t index, double seconds, std::string* error) {
+    if (playing() && index >= base_ && index - base_ < engine_->trackCount()) {
+        engine_->seek(index - base_, (ma_uint64)(seconds * engine_->sampleRate()));
+        return true;
+    }
+    return startAt(index, seconds, error);
+}
+
+bool PlaybackDaemon::libraryFiles(const std::string& dir, bool recursive, std::vector<std::string>* files) {
+    std::string key = dir + (recursive ? "\t1" : "\t0");
+    auto it = indexes_.find(key);
+    if (it == indexes_.end()) {
+        auto index = std::make_unique<LibraryIndex>(dir, recursive);
+        index->load();
+        it = indexes_.emplace(key, std::move(index)).first;
+    }
+
+    LibraryIndex& index = *it->second;
+    index.update();
+
+    files->clear();
+    for (const auto& entry : index.entries()) {
+        if (entry.decodable()) {
+            files->push_back(entry.path);
+        }
+    }
+    return !files->empty();
+}
+
+const LibraryEntry* PlaybackDaemon::libraryEntry(const std::string& path) {
+    auto find = [&path](const LibraryIndex& index) -> const LibraryEntry* {
+        const auto& entries = index.entries();
+        auto it = std::lower_bound(entries.begin(), entries.end(), path,
+                                   [](const LibraryEntry& entry, const std::string& p) { return entry.path < p; });
+        return it != entries.end() && it->path == path ? &*it : nullptr;
+    };
+    for (const auto& item : indexes_) {
+        if (const LibraryEntry* entry = find(*item.second)) {
+            return entry;
+        }
+    }
+
+    size_t slash = path.find_last_of('/');
+    if (slash == std::string::npos) {
+        return nullptr;
+    }
+    std::string dir = path.substr(0, slash);
+    std::string key = dir + "\t0";
+    if (indexes_.count(key) > 0) {
+        return nullptr;
+    }
+    auto index = std::make_unique<LibraryIndex>(dir, false);
+    index->load();
+    const LibraryEntry* entry = find(*index);
+    indexes_.emplace(key, std::move(index));
+    return entry;
+}
+
+std::string PlaybackDaemon::handle(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        return "ERR Empty command";
+    }
+
+    const std::string& command = args[0];
+    std::string error;
+
+    if (command == "ping") {
+        return "OK pong";
+    }
+    if (command == "status") {
+        return status();
+    }
+    if (command == "stats") {
+        std::string text = format_device_stats(output_.stats(), config_.device_reuse);
+        if (playing() && engine_->processingGraphActive()) {
+            text += "; " + format_processing_stats(engine_->processingStats());
+        }
+        return "OK " + text;
+    }
+    if (command == "shutdown") {
+        return "OK shutting down";
+    }
+
+    // play <起始秒数> <文件>...：替换队列并从头播放
+    if (command == "play") {
+        if (args.size() < 3) {
+            return "ERR play requires a start time and at least one file";
+        }
+        queue_.assign(args.begin() + 2, args.end());
+        paused_ = false;
+        if (!startAt(0, atof(args[1].c_str()), &error)) {
+            return "ERR " + error;
+        }
+        return "OK Playing " + std::to_string(queue_.size()) + " file(s)";
+    }
+
+    // play-dir <起始秒数> <是否递归> <目录>：通过常驻索引列出目录并播放
+    if (command == "play-dir") {
+        if (args.size() < 4) {
+            return "ERR play-dir requires a start time, a recursive flag and a directory";
+        }
+        std::vector<std::string> files;
+        if (!libraryFiles(args[3], args[2] == "1", &files)) {
+            return "ERR No audio files found in: " + args[3];
+        }
+        std::vector<std::string> play_args = {"play", args[1]};
+        play_args.insert(play_args.end(), files.begin(), files.end());
+        return handle(play_args);
+    }
+
+    // queue <文件>...：追加到队列末尾，空闲时立即开始播放
+    if (command == "queue") {
+        if (args.size() < 2) {
+            return "ERR queue requires at least one file";
+        }
+        size_t first_new = queue_.size();
+        queue_.insert(queue_.end(), args.begin() + 1, args.end());
+        if (!playing() && !startAt(first_new, 0, &error)) {
+            return "ERR " + error;
+        }
+        return "OK Queued " + std::to_string(args.size() - 1) + " file(s), " + std::to_string(queue_.size()) +
+               " in queue";
+    }
+
+    if (command == "stop") {
+        stopEngine();
+        queue_.clear();
+        return "OK Stopped";
+    }
+
+    // eq [on|off|toggle|<文件>]：切换均衡或换一组参数，对正在播放的引擎立即生效（淡变），之后的播放沿用
+    if (command == "eq") {
+        if (!config_.eq) {
+            return "ERR Equalizer is not active (start the daemon with --eq FILE)";
+        }
+        if (args.size() >= 2) {
+            const std::string& arg = args[1];
+            if (arg == "on" || arg == "off" || arg == "toggle") {
+                config_.eq_enabled = arg == "toggle" ? !config_.eq_enabled : arg == "on";
+            } else {
+                EqSettings settings;
+                if (!load_eq_file(arg, &settings, &error)) {
+                    return "ERR " + error;
+                }
+                config_.eq_settings = settings;
+                if (playing()) {
+                    engine_->setEqSettings(settings);
+                }
+            }
+            if (playing()) {
+                engine_->setEqEnabled(config_.eq_enabled);
+            }
+        }
+        return std::string("OK Equalizer ") + (config_.eq_enabled ? "on" : "off") + ", " +
+               describe_eq(config_.eq_settings);
+    }
+
+    if (!playing()) {
+        return "ERR Nothing is playing";
+    }
+
+    if (command == "pause" || command == "resume" || command == "toggle") {
+        paused_ = command == "toggle" ? !paused_ : command == "pause";
+        engine_->setPaused(paused_);
+        return paused_ ? "OK Paused" : "OK Playing";
+    }
+
+    if (command == "seek") {
+        if (args.size() < 2) {
+            return "ERR seek requires a time";
+        }
+        double seconds = atof(args[1].c_str());
+        // 播放位置只读一次：检查长度和跳转必须针对同一首曲目（两次读取之间可能刚好换曲）。
+        // 越界时保持当前播放不变
+        size_t current = engine_->position().track;
+        const TrackSlot& track = engine_->track(current);
+        if (seconds < 0 || seconds * engine_->sampleRate() >= track.length_frames) {
+            return "ERR Seek position exceeds track duration (" +
+                   format_seconds(track.length_frames / (double)engine_->sampleRate()) + ")";
+        }
+        if (!jumpTo(base_ + current, seconds, &error)) {
+            return "ERR " + error;
+        }
+        return "OK Seeked to " + format_seconds(seconds);
+    }
+
+    if (command == "next" || command == "prev") {
+        size_t index = currentIndex();
+        if (command == "next") {
+            if (index + 1 >= queue_.size()) {
+                return "ERR Already at the last track";
+            }
+            ++index;
+        } else if (engine_->position().track_frame < 3 * (ma_uint64)engine_->sampleRate() && index > 0) {
+            // 曲目开头几秒内回到上一首，否则从头重放当前曲目
+            --index;
+        }
+        bool in_engine = index >= base_ && index - base_ < engine_->trackCount();
+        if (!jumpTo(index, 0, &error)) {
+            return "ERR " + error;
+        }
+        // 引擎内的跳转由回调异步生效，此时的播放位置还是旧的
+        return in_engine ? describe(index - base_, 0) : status();
+    }
+
+    return "ERR Unknown command: " + command;
+}
+
+} // namespace
+
+int run_daemon(const PlaybackEngineConfig& config) {
+    PlaybackDaemon daemon(config);
+    return daemon.run(daemon_socket_path());
+}
+
+bool daemon_request(const std::vector<std::string>& args, DaemonReply* reply) {
+    int fd = connect_daemon();
+    if (fd < 0) {
+        return false;
+    }
+
+    std::string line;
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (i > 0) line += '\t';
+        line += args[i];
+    }
+    line += '\n';
+
+    std::string response;
+    bool ok = write_all(fd, line) && read_line(fd, &response);
+    close(fd);
+    if (!ok) {
+        reply->ok = false;
+        reply->message = "No reply from caudio daemon";
+        return true;
+    }
+
+    size_t space = response.find(' ');
+    std::string status = response.substr(0, space);
+    reply->ok = status == "OK";
+    reply->message = space == std::string::npos ? "" : response.substr(space + 1);
+    return true;
+}
+
+#endif
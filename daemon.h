@@ -0,0 +1,34 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include "playback_engine.h"
+
+#include <string>
+#include <vector>
+
+// 守护进程是否可用（需要 Unix 域套接字）
+#ifdef _WIN32
+constexpr bool DAEMON_SUPPORTED = false;
+#else
+constexpr bool DAEMON_SUPPORTED = true;
+#endif
+
+// 控制套接字路径：优先使用环境变量 CAUDIO_SOCKET，其次 $XDG_RUNTIME_DIR/caudio.sock，
+// 最后是本用户的私有目录 /tmp/caudio-<uid>/daemon.sock
+std::string daemon_socket_path();
+
+// 在前台运行守护进程：播放设备、解码器和曲库索引常驻内存，
+// 通过控制套接字接收命令，直到收到 shutdown 命令或 SIGINT/SIGTERM
+int run_daemon(const PlaybackEngineConfig& config);
+
+// 守护进程的应答
+struct DaemonReply {
+    bool ok = false;
+    std::string message;
+};
+
+// 客户端：发送一条命令（命令名和参数）并等待应答。
+// 守护进程没有运行时返回 false，调用方可以退回到进程内播放
+bool daemon_request(const std::vector<std::string>& args, DaemonReply* reply);
+
+#endif // DAEMON_H
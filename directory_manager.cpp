@@ -11,16 +11,18 @@
 #define F_OK 0
 #else
 #include <unistd.h>
-#include <dirent.h>
 #include <sys/stat.h>
 #endif
 
-DirectoryManager::DirectoryManager() : current_index_(-1) {
+DirectoryManager::DirectoryManager() : current_index_(-1), modified_(false) {
     loadConfig(); // 启动时自动加载配置
 }
 
 DirectoryManager::~DirectoryManager() {
-    saveConfig(); // 退出时自动保存配置
+    // 退出时自动保存配置；只读命令不改写配置文件
+    if (modified_) {
+        saveConfig();
+    }
 }
 
 bool DirectoryManager::isValidDirectory(const std::string& path) const {
@@ -35,67 +37,7 @@ bool DirectoryManager::isValidDirectory(const std::string& path) const {
 #endif
 }
 
-bool DirectoryManager::isAudioFile(const std::string& filename) const {
-    std::string lower = filename;
-    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
-    
-    auto endsWith = [](const std::string& str, const std::string& suffix) {
-        if (suffix.length() > str.length()) return false;
-        return str.compare(str.length() - suffix.length(), suffix.length(), suffix) == 0;
-    };
-    
-    return endsWith(lower, ".wav") || 
-           endsWith(lower, ".mp3") || 
-           endsWith(lower, ".flac") ||
-           endsWith(lower, ".ogg") ||
-           endsWith(lower, ".m4a") ||
-           endsWith(lower, ".aac");
-}
-
-std::vector<std::string> DirectoryManager::scanAudioFiles(const std::string& dir) const {
-    std::vector<std::string> files;
-    
-#ifdef _WIN32
-    std::string pattern = dir + "\\*";
-    WIN32_FIND_DATAA findData;
-    HANDLE hFind = FindFirstFileA(pattern.c_str(), &findData);
-    
-    if (hFind != INVALID_HANDLE_VALUE) {
-        do {
-            if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
-                std::string filename = findData.cFileName;
-                if (isAudioFile(filename)) {
-                    files.push_back(dir + "\\" + filename);
-                }
-            }
-        } while (FindNextFileA(hFind, &findData));
-        FindClose(hFind);
-    }
-#else
-    DIR* dp = opendir(dir.c_str());
-    if (dp != nullptr) {
-        struct dirent* entry;
-        while ((entry = readdir(dp)) != nullptr) {
-            std::string filename = entry->d_name;
-            if (filename != "." && filename != "..") {
-                std::string fullpath = dir + "/" + filename;
-                struct stat info;
-                if (stat(fullpath.c_str(), &info) == 0 && S_ISREG(info.st_mode)) {
-                    if (isAudioFile(filename)) {
-                        files.push_back(fullpath);
-                    }
-                }
-            }
-        }
-        closedir(dp);
-    }
-#endif
-    
-    std::sort(files.begin(), files.end());
-    return files;
-}
-
-bool DirectoryManager::addDirectory(const std::string& path) {
+bool DirectoryManager::addDirectory(const std::string& path, bool recursive) {
     if (!isValidDirectory(path)) {
         std::cerr << "Error: Invalid directory: " << path << "\n";
         return false;
@@ -110,7 +52,9 @@ bool DirectoryManager::addDirectory(const std::string& path) {
     }
     
     directories_.push_back(path);
-    std::cout << "Added directory: " << path << "\n";
+    recursive_.push_back(recursive);
+    modified_ = true;
+    std::cout << "Added directory: " << path << (recursive ? " (recursive)" : "") << "\n";
     return true;
 }
 
@@ -121,7 +65,10 @@ bool DirectoryManager::removeDirectory(int index) {
     }
     
     std::cout << "Removed directory: " << directories_[index] << "\n";
+    LibraryIndex::removeIndexFile(directories_[index]);
     directories_.erase(directories_.begin() + index);
+    recursive_.erase(recursive_.begin() + index);
+    modified_ = true;
     
     // 如果删除的是当前选中的目录，重置选中状态
     if (current_index_ == index) {
@@ -141,7 +88,10 @@ void DirectoryManager::listDirectories() const {
     
     std::cout << "Directories:\n";
     for (size_t i = 0; i < directories_.size(); ++i) {
-        std::string marker = (i == current_index_) ? " [SELECTED]" : "";
+        std::string marker = recursive_[i] ? " [RECURSIVE]" : "";
+        if (i == current_index_) {
+            marker += " [SELECTED]";
+        }
         std::cout << "  " << i << ". " << directories_[i] << marker << "\n";
     }
 }
@@ -153,6 +103,7 @@ bool DirectoryManager::selectDirectory(int index) {
     }
     
     current_index_ = index;
+    modified_ = true;
     std::cout << "Selected directory: " << directories_[index] << "\n";
     
     // 显示该目录下的音频文件数量
@@ -169,12 +120,33 @@ std::string DirectoryManager::getCurrentDirectory() const {
     return directories_[current_index_];
 }
 
+bool DirectoryManager::isCurrentRecursive() const {
+    if (current_index_ < 0 || current_index_ >= (int)directories_.size()) {
+        return false;
+    }
+    return recursive_[current_index_];
+}
+
 std::vector<std::string> DirectoryManager::getAudioFiles() const {
+    std::vector<std::string> files;
+    for (const auto& entry : getLibraryEntries()) {
+        if (entry.decodable()) {
+            files.push_back(entry.path);
+        }
+    }
+    return files;
+}
+
+std::vector<LibraryEntry> DirectoryManager::getLibraryEntries() const {
     std::string dir = getCurrentDirectory();
     if (dir.empty()) {
         return {};
     }
-    return scanAudioFiles(dir);
+
+    LibraryIndex index(dir, isCurrentRecursive());
+    index.load();
+    index.update();
+    return index.entries();
 }
 
 bool DirectoryManager::saveConfig(const std::string& config_file) const {
@@ -188,6 +160,13 @@ bool DirectoryManager::saveConfig(const std::string& config_file) const {
     for (const auto& dir : directories_) {
         file << dir << "\n";
     }
+
+    // 递归标记单独放在末尾一行，旧版本读取配置时会忽略它
+    file << "recursive";
+    for (bool recursive : recursive_) {
+        file << " " << (recursive ? 1 : 0);
+    }
+    file << "\n";
     
     return true;
 }
@@ -203,18 +182,45 @@ bool DirectoryManager::loadConfig(const std::string& config_file) {
     file >> count;
     file.ignore(); // 跳过换行符
     
-    directories_.clear();
+    std::vector<std::string> dirs;
     for (int i = 0; i < count; ++i) {
         std::string dir;
         std::getline(file, dir);
-        if (!dir.empty() && isValidDirectory(dir)) {
-            directories_.push_back(dir);
+        dirs.push_back(dir);
+    }
+
+    // 旧配置没有递归标记行，全部按非递归处理
+    std::vector<bool> flags(dirs.size(), false);
+    std::string line;
+    if (std::getline(file, line)) {
+        std::istringstream in(line);
+        std::string tag;
+        int flag;
+        if (in >> tag && tag == "recursive") {
+            for (size_t i = 0; i < flags.size() && in >> flag; ++i) {
+                flags[i] = flag != 0;
+            }
+        }
+    }
+
+    directories_.clear();
+    recursive_.clear();
+    for (size_t i = 0; i < dirs.size(); ++i) {
+        if (!dirs[i].empty() && isValidDirectory(dirs[i])) {
+            directories_.push_back(dirs[i]);
+            recursive_.push_back(flags[i]);
         }
     }
     
+    // 有目录已失效时，退出时写回过滤后的列表
+    if (directories_.size() != dirs.size()) {
+        modified_ = true;
+    }
+
     // 验证当前索引是否有效
     if (current_index_ >= (int)directories_.size()) {
         current_index_ = -1;
+        modified_ = true;
     }
     
     return true;
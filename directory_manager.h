@@ -1,6 +1,8 @@
 #ifndef DIRECTORY_MANAGER_H
 #define DIRECTORY_MANAGER_H
 
+#include "library_index.h"
+
 #include <string>
 #include <vector>
 
@@ -9,8 +11,8 @@ public:
     DirectoryManager();
     ~DirectoryManager();
 
-    // 添加目录到列表
-    bool addDirectory(const std::string& path);
+    // 添加目录到列表（recursive 为 true 时包含所有子目录）
+    bool addDirectory(const std::string& path, bool recursive = false);
     
     // 从列表移除目录
     bool removeDirectory(int index);
@@ -23,9 +25,16 @@ public:
     
     // 获取当前选中的目录
     std::string getCurrentDirectory() const;
+
+    // 当前选中的目录是否递归扫描
+    bool isCurrentRecursive() const;
     
-    // 获取当前选中目录的所有音频文件
+    // 获取当前选中目录中可以解码的音频文件（通过持久化索引，只重新扫描有变化的目录，
+    // 文件头探测结果也缓存在索引中）
     std::vector<std::string> getAudioFiles() const;
+
+    // 获取当前选中目录的索引条目（包含大小、修改时间、时长、格式、探测结果）
+    std::vector<LibraryEntry> getLibraryEntries() const;
     
     // 获取目录列表
     std::vector<std::string> getDirectories() const { return directories_; }
@@ -41,16 +50,12 @@ public:
 
 private:
     std::vector<std::string> directories_;
+    std::vector<bool> recursive_;  // 与 directories_ 一一对应
     int current_index_;  // -1 表示未选中
+    bool modified_;      // 配置有改动时才在退出时写回
     
     // 检查路径是否存在且为目录
     bool isValidDirectory(const std::string& path) const;
-    
-    // 获取目录中的所有音频文件
-    std::vector<std::string> scanAudioFiles(const std::string& dir) const;
-    
-    // 检查文件是否为音频文件
-    bool isAudioFile(const std::string& filename) const;
 };
 
 #endif // DIRECTORY_MANAGER_H
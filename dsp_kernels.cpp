@@ -0,0 +1,910 @@
+#include "dsp_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CAUDIO_DSP_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CAUDIO_DSP_NEON 1
+#endif
+
+// AVX2 内核单独按目标属性编译，程序本身不要求 AVX2，运行时检测到才使用
+#if defined(CAUDIO_DSP_SSE2) && (defined(__GNUC__) || defined(_MSC_VER))
+#include <immintrin.h>
+#define CAUDIO_DSP_AVX2 1
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define CAUDIO_TARGET_AVX2
+#else
+#define CAUDIO_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+void make_equal_power_curve(float* fade_out, float* fade_in, ma_uint32 frames) {
+    const double half_pi = 1.57079632679489661923;
+    for (ma_uint32 i = 0; i < frames; ++i) {
+        double t = frames > 1 ? (double)i / (frames - 1) : 1.0;
+        fade_out[i] = (float)std::cos(t * half_pi);
+        fade_in[i]  = (float)std::sin(t * half_pi);
+    }
+}
+
+static void mix_crossfade_scalar(float* out, const float* a, const float* b,
+                                 const float* gain_a, const float* gain_b,
+                                 ma_uint32 frames, ma_uint32 channels) {
+    for (ma_uint32 i = 0; i < frames; ++i) {
+        float ga = gain_a[i];
+        float gb = gain_b[i];
+        for (ma_uint32 c = 0; c < channels; ++c) {
+            size_t k = (size_t)i * channels + c;
+            out[k] = a[k] * ga + b[k] * gb;
+        }
+    }
+}
+
+void mix_crossfade_f32(float* out, const float* a, const float* b,
+                       const float* gain_a, const float* gain_b,
+                       ma_uint32 frames, ma_uint32 channels) {
+    ma_uint32 i = 0;
+
+#if defined(CAUDIO_DSP_SSE2)
+    if (channels == 2) {
+        // 每次处理 4 帧：增益 [g0 g1 g2 g3] 展开为 [g0 g0 g1 g1] 和 [g2 g2 g3 g3]
+        for (; i + 4 <= frames; i += 4) {
+            __m128 ga = _mm_loadu_ps(gain_a + i);
+            __m128 gb = _mm_loadu_ps(gain_b + i);
+            __m128 ga_lo = _mm_unpacklo_ps(ga, ga);
+            __m128 ga_hi = _mm_unpackhi_ps(ga, ga);
+            __m128 gb_lo = _mm_unpacklo_ps(gb, gb);
+            __m128 gb_hi = _mm_unpackhi_ps(gb, gb);
+            size_t k = (size_t)i * 2;
+            __m128 lo = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a + k), ga_lo),
+                                   _mm_mul_ps(_mm_loadu_ps(b + k), gb_lo));
+            __m128 hi = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a + k + 4), ga_hi),
+                                   _mm_mul_ps(_mm_loadu_ps(b + k + 4), gb_hi));
+            _mm_storeu_ps(out + k, lo);
+            _mm_storeu_ps(out + k + 4, hi);
+        }
+    } else if (channels == 1) {
+        for (; i + 4 <= frames; i += 4) {
+            __m128 v = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(gain_a + i)),
+                                  _mm_mul_ps(_mm_loadu_ps(b + i), _mm_loadu_ps(gain_b + i)));
+            _mm_storeu_ps(out + i, v);
+        }
+    }
+#elif defined(CAUDIO_DSP_NEON)
+    if (channels == 2) {
+        for (; i + 4 <= frames; i += 4) {
+            float32x4_t ga = vld1q_f32(gain_a + i);
+            float32x4_t gb = vld1q_f32(gain_b + i);
+            float32x4x2_t ga2 = vzipq_f32(ga, ga);
+            float32x4x2_t gb2 = vzipq_f32(gb, gb);
+            size_t k = (size_t)i * 2;
+            float32x4_t lo = vmlaq_f32(vmulq_f32(vld1q_f32(a + k), ga2.val[0]), vld1q_f32(b + k), gb2.val[0]);
+            float32x4_t hi = vmlaq_f32(vmulq_f32(vld1q_f32(a + k + 4), ga2.val[1]), vld1q_f32(b + k + 4), gb2.val[1]);
+            vst1q_f32(out + k, lo);
+            vst1q_f32(out + k + 4, hi);
+        }
+    } else if (channels == 1) {
+        for (; i + 4 <= frames; i += 4) {
+            float32x4_t v = vmlaq_f32(vmulq_f32(vld1q_f32(a + i), vld1q_f32(gain_a + i)),
+                                      vld1q_f32(b + i), vld1q_f32(gain_b + i));
+            vst1q_f32(out + i, v);
+        }
+    }
+#endif
+
+    // 剩余的帧以及其他声道数
+    if (i < frames) {
+        size_t k = (size_t)i * channels;
+        mix_crossfade_scalar(out + k, a + k, b + k, gain_a + i, gain_b + i, frames - i, channels);
+    }
+}
+
+// ---- 音量、增益渐变与混音 ----
+
+const char* dsp_isa_name(DspIsa isa) {
+    switch (isa) {
+    case DspIsa::Sse2:
+        return "sse2";
+    case DspIsa::Avx2:
+        return "avx2";
+    case DspIsa::Neon:
+        return "neon";
+    default:
+        return "scalar";
+    }
+}
+
+namespace {
+
+inline ma_int16 clamp_s16(float v) {
+    v = std::min(std::max(v, -32768.0f), 32767.0f);
+    return (ma_int16)lrintf(v);
+}
+
+void gain_ramp_f32_scalar(float* samples, ma_uint32 frames, ma_uint32 channels, float from, float to) {
+    float step = (to - from) / (float)frames;
+    for (ma_uint32 i = 0; i < frames; ++i) {
+        float g = from + step * (float)i;
+        for (ma_uint32 c = 0; c < channels; ++c) {
+            samples[(size_t)i * channels + c] *= g;
+        }
+    }
+}
+
+void gain_ramp_s16_scalar(ma_int16* samples, ma_uint32 frames, ma_uint32 channels, float from, float to) {
+    float step = (to - from) / (float)frames;
+    for (ma_uint32 i = 0; i < frames; ++i) {
+        float g = from + step * (float)i;
+        for (ma_uint32 c = 0; c < channels; ++c) {
+            size_t k = (size_t)i * channels + c;
+            samples[k] = clamp_s16(samples[k] * g);
+        }
+    }
+}
+
+void mix_f32_scalar(float* out, const float* in, size_t samples, float gain) {
+    for (size_t i = 0; i < samples; ++i) {
+        out[i] += in[i] * gain;
+    }
+}
+
+// 向量宽度为 lanes 时，声道数能整除 lanes 才能让每个通道在向量内对应固定的帧偏移
+inline bool lanes_fit(ma_uint32 channels, ma_uint32 lanes) {
+    return channels > 0 && channels <= lanes && lanes % channels == 0;
+}
+
+#if defined(CAUDIO_DSP_SSE2)
+
+// 第 j 个通道属于第 j / channels 帧；每个向量前进 4 / channels 帧
+inline __m128 lane_frames_sse2(ma_uint32 channels) {
+    return _mm_set_ps((float)(3 / channels), (float)(2 / channels), (float)(1 / channels), 0.0f);
+}
+
+void gain_ramp_f32_sse2(float* samples, ma_uint32 frames, ma_uint32 channels, float from, float to) {
+    if (!lanes_fit(channels, 4)) {
+        gain_ramp_f32_scalar(samples, frames, channels, from, to);
+        return;
+    }
+    float step = (to - from) / (float)frames;
+    size_t total = (size_t)frames * channels;
+    size_t k = 0;
+    __m128 frame = lane_frames_sse2(channels);
+    __m128 advance = _mm_set1_ps((float)(4 / channels));
+    __m128 base = _mm_set1_ps(from);
+    __m128 slope = _mm_set1_ps(step);
+    for (; k + 4 <= total; k += 4) {
+        __m128 g = _mm_add_ps(base, _mm_mul_ps(slope, frame));
+        _mm_storeu_ps(samples + k, _mm_mul_ps(_mm_loadu_ps(samples + k), g));
+        frame = _mm_add_ps(frame, advance);
+    }
+    if (k < total) {
+        ma_uint32 done = (ma_uint32)(k / channels);
+        gain_ramp_f32_scalar(samples + k, frames - done, channels, from + step * (float)done, to);
+    }
+}
+
+void gain_ramp_s16_sse2(ma_int16* samples, ma_uint32 frames, ma_uint32 channels, float from, float to) {
+    if (!lanes_fit(channels, 4)) {
+        gain_ramp_s16_scalar(samples, frames, channels, from, to);
+        return;
+    }
+    float step = (to - from) / (float)frames;
+    size_t total = (size_t)frames * channels;
+    size_t k = 0;
+    // 每次处理 8 个样本：扩展为两组 4 × int32 → float，乘增益后取整并饱和打包
+    __m128 frame = lane_frames_sse2(channels);
+    __m128 half = _mm_set1_ps((float)(4 / channels));
+    __m128 advance = _mm_set1_ps((float)(8 / channels));
+    __m128 base = _mm_set1_ps(from);
+    __m128 slope = _mm_set1_ps(step);
+    for (; k + 8 <= total; k += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(samples + k));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        __m128 g_lo = _mm_add_ps(base, _mm_mul_ps(slope, frame));
+        __m128 g_hi = _mm_add_ps(base, _mm_mul_ps(slope, _mm_add_ps(frame, half)));
+        lo = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(lo), g_lo));
+        hi = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(hi), g_hi));
+        _mm_storeu_si128((__m128i*)(samples + k), _mm_packs_epi32(lo, hi));
+        frame = _mm_add_ps(frame, advance);
+    }
+    if (k < total) {
+        ma_uint32 done = (ma_uint32)(k / channels);
+        gain_ramp_s16_scalar(samples + k, frames - done, channels, from + step * (float)done, to);
+    }
+}
+
+void mix_f32_sse2(float* out, const float* in, size_t samples, float gain) {
+    __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_loadu_ps(in + i), g)));
+    }
+    mix_f32_scalar(out + i, in + i, samples - i, gain);
+}
+
+#endif // CAUDIO_DSP_SSE2
+
+#if defined(CAUDIO_DSP_AVX2)
+
+CAUDIO_TARGET_AVX2 inline __m256 lane_frames_avx2(ma_uint32 channels) {
+    return _mm256_set_ps((float)(7 / channels), (float)(6 / channels), (float)(5 / channels), (float)(4 / channels),
+                         (float)(3 / channels), (float)(2 / channels), (float)(1 / channels), 0.0f);
+}
+
+CAUDIO_TARGET_AVX2 void gain_ramp_f32_avx2(float* samples, ma_uint32 frames, ma_uint32 channels, float from,
+                                           float to) {
+    if (!lanes_fit(channels, 8)) {
+        gain_ramp_f32_scalar(samples, frames, channels, from, to);
+        return;
+    }
+    float step = (to - from) / (float)frames;
+    size_t total = (size_t)frames * channels;
+    size_t k = 0;
+    __m256 frame = lane_frames_avx2(channels);
+    __m256 advance = _mm256_set1_ps((float)(8 / channels));
+    __m256 base = _mm256_set1_ps(from);
+    __m256 slope = _mm256_set1_ps(step);
+    for (; k + 8 <= total; k += 8) {
+        __m256 g = _mm256_add_ps(base, _mm256_mul_ps(slope, frame));
+        _mm256_storeu_ps(samples + k, _mm256_mul_ps(_mm256_loadu_ps(samples + k), g));
+        frame = _mm256_add_ps(frame, advance);
+    }
+    if (k < total) {
+        ma_uint32 done = (ma_uint32)(k / channels);
+        gain_ramp_f32_scalar(samples + k, frames - done, channels, from + step * (float)done, to);
+    }
+}
+
+CAUDIO_TARGET_AVX2 void gain_ramp_s16_avx2(ma_int16* samples, ma_uint32 frames, ma_uint32 channels, float from,
+                                           float to) {
+    if (!lanes_fit(channels, 8)) {
+        gain_ramp_s16_scalar(samples, frames, channels, from, to);
+        return;
+    }
+    float step = (to - from) / (float)frames;
+    size_t total = (size_t)frames * channels;
+    size_t k = 0;
+    // 每次处理 16 个样本；_mm256_packs_epi32 在两个 128 位半区内分别打包，最后按 64 位重排回原顺序
+    __m256 frame = lane_frames_avx2(channels);
+    __m256 half = _mm256_set1_ps((float)(8 / channels));
+    __m256 advance = _mm256_set1_ps((float)(16 / channels));
+    __m256 base = _mm256_set1_ps(from);
+    __m256 slope = _mm256_set1_ps(step);
+    for (; k + 16 <= total; k += 16) {
+        __m128i v_lo = _mm_loadu_si128((const __m128i*)(samples + k));
+        __m128i v_hi = _mm_loadu_si128((const __m128i*)(samples + k + 8));
+        __m256 g_lo = _mm256_add_ps(base, _mm256_mul_ps(slope, frame));
+        __m256 g_hi = _mm256_add_ps(base, _mm256_mul_ps(slope, _mm256_add_ps(frame, half)));
+        __m256i lo = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v_lo)), g_lo));
+        __m256i hi = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v_hi)), g_hi));
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+        _mm256_storeu_si256((__m256i*)(samples + k), packed);
+        frame = _mm256_add_ps(frame, advance);
+    }
+    if (k < total) {
+        ma_uint32 done = (ma_uint32)(k / channels);
+        gain_ramp_s16_scalar(samples + k, frames - done, channels, from + step * (float)done, to);
+    }
+}
+
+CAUDIO_TARGET_AVX2 void mix_f32_avx2(float* out, const float* in, size_t samples, float gain) {
+    __m256 g = _mm256_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(out + i), _mm256_mul_ps(_mm256_loadu_ps(in + i), g)));
+    }
+    mix_f32_scalar(out + i, in + i, samples - i, gain);
+}
+
+bool cpu_has_avx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    // AVX2 需要 CPU 支持（CPUID.7:EBX[5]）且操作系统保存 YMM 状态（OSXSAVE + XCR0[2:1]）
+    int info[4];
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // CAUDIO_DSP_AVX2
+
+#if defined(CAUDIO_DSP_NEON)
+
+inline float32x4_t lane_frames_neon(ma_uint32 channels) {
+    const float lanes[4] = {0.0f, (float)(1 / channels), (float)(2 / channels), (float)(3 / channels)};
+    return vld1q_f32(lanes);
+}
+
+inline int32x4_t round_s32_neon(float32x4_t v) {
+#if defined(__aarch64__)
+    return vcvtnq_s32_f32(v);
+#else
+    // ARMv7 只有向零取整，加减 0.5 近似四舍五入
+    float32x4_t half = vbslq_f32(vcltq_f32(v, vdupq_n_f32(0.0f)), vdupq_n_f32(-0.5f), vdupq_n_f32(0.5f));
+    return vcvtq_s32_f32(vaddq_f32(v, half));
+#endif
+}
+
+void gain_ramp_f32_neon(float* samples, ma_uint32 frames, ma_uint32 channels, float from, float to) {
+    if (!lanes_fit(channels, 4)) {
+        gain_ramp_f32_scalar(samples, frames, channels, from, to);
+        return;
+    }
+    float step = (to - from) / (float)frames;
+    size_t total = (size_t)frames * channels;
+    size_t k = 0;
+    float32x4_t frame = lane_frames_neon(channels);
+    float32x4_t advance = vdupq_n_f32((float)(4 / channels));
+    float32x4_t base = vdupq_n_f32(from);
+    float32x4_t slope = vdupq_n_f32(step);
+    for (; k + 4 <= total; k += 4) {
+        float32x4_t g = vmlaq_f32(base, slope, frame);
+        vst1q_f32(samples + k, vmulq_f32(vld1q_f32(samples + k), g));
+        frame = vaddq_f32(frame, advance);
+    }
+    if (k < total) {
+        ma_uint32 done = (ma_uint32)(k / channels);
+        gain_ramp_f32_scalar(samples + k, frames - done, channels, from + step * (float)done, to);
+    }
+}
+
+void gain_ramp_s16_neon(ma_int16* samples, ma_uint32 frames, ma_uint32 channels, float from, float to) {
+    if (!lanes_fit(channels, 4)) {
+        gain_ramp_s16_scalar(samples, frames, channels, from, to);
+        return;
+    }
+    float step = (to - from) / (float)frames;
+    size_t total = (size_t)frames * channels;
+    size_t k = 0;
+    float32x4_t frame = lane_frames_neon(channels);
+    float32x4_t half = vdupq_n_f32((float)(4 / channels));
+    float32x4_t advance = vdupq_n_f32((float)(8 / channels));
+    float32x4_t base = vdupq_n_f32(from);
+    float32x4_t slope = vdupq_n_f32(step);
+    for (; k + 8 <= total; k += 8) {
+        int16x8_t v = vld1q_s16(samples + k);
+        float32x4_t g_lo = vmlaq_f32(base, slope, frame);
+        float32x4_t g_hi = vmlaq_f32(base, slope, vaddq_f32(frame, half));
+        int32x4_t lo = round_s32_neon(vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), g_lo));
+        int32x4_t hi = round_s32_neon(vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), g_hi));
+        vst1q_s16(samples + k, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+        frame = vaddq_f32(frame, advance);
+    }
+    if (k < total) {
+        ma_uint32 done = (ma_uint32)(k / channels);
+        gain_ramp_s16_scalar(samples + k, frames - done, channels, from + step * (float)done, to);
+    }
+}
+
+void mix_f32_neon(float* out, const float* in, size_t samples, float gain) {
+    float32x4_t g = vdupq_n_f32(gain);
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        vst1q_f32(out + i, vmlaq_f32(vld1q_f32(out + i), vld1q_f32(in + i), g));
+    }
+    mix_f32_scalar(out + i, in + i, samples - i, gain);
+}
+
+#endif // CAUDIO_DSP_NEON
+
+const DspKernels SCALAR_KERNELS = {DspIsa::Scalar, gain_ramp_f32_scalar, gain_ramp_s16_scalar, mix_f32_scalar};
+#if defined(CAUDIO_DSP_SSE2)
+const DspKernels SSE2_KERNELS = {DspIsa::Sse2, gain_ramp_f32_sse2, gain_ramp_s16_sse2, mix_f32_sse2};
+#endif
+#if defined(CAUDIO_DSP_AVX2)
+const DspKernels AVX2_KERNELS = {DspIsa::Avx2, gain_ramp_f32_avx2, gain_ramp_s16_avx2, mix_f32_avx2};
+#endif
+#if defined(CAUDIO_DSP_NEON)
+const DspKernels NEON_KERNELS = {DspIsa::Neon, gain_ramp_f32_neon, gain_ramp_s16_neon, mix_f32_neon};
+#endif
+
+// 24 位有符号整数（小端 3 字节）
+inline ma_int32 load_s24(const ma_uint8* p) {
+    return (ma_int32)((ma_uint32)p[0] << 8 | (ma_uint32)p[1] << 16 | (ma_uint32)p[2] << 24) >> 8;
+}
+
+inline void store_s24(ma_uint8* p, ma_int32 v) {
+    p[0] = (ma_uint8)v;
+    p[1] = (ma_uint8)(v >> 8);
+    p[2] = (ma_uint8)(v >> 16);
+}
+
+} // namespace
+
+const DspKernels* dsp_kernels_for(DspIsa isa) {
+    switch (isa) {
+    case DspIsa::Scalar:
+        return &SCALAR_KERNELS;
+#if defined(CAUDIO_DSP_SSE2)
+    case DspIsa::Sse2:
+        return &SSE2_KERNELS;
+#endif
+#if defined(CAUDIO_DSP_AVX2)
+    case DspIsa::Avx2:
+        return cpu_has_avx2() ? &AVX2_KERNELS : nullptr;
+#endif
+#if defined(CAUDIO_DSP_NEON)
+    case DspIsa::Neon:
+        return &NEON_KERNELS;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+const DspKernels& dsp_kernels() {
+    // 局部静态变量的初始化是线程安全的，程序启动后第一次打开设备前就会完成
+    static const DspKernels* best = [] {
+        for (DspIsa isa : {DspIsa::Avx2, DspIsa::Sse2, DspIsa::Neon}) {
+            if (const DspKernels* kernels = dsp_kernels_for(isa)) {
+                return kernels;
+            }
+        }
+        return &SCALAR_KERNELS;
+    }();
+    return *best;
+}
+
+void apply_gain_ramp(void* samples, ma_format format, ma_uint32 frames, ma_uint32 channels, float from, float to) {
+    if (frames == 0 || (from == 1.0f && to == 1.0f)) {
+        return;
+    }
+
+    const DspKernels& kernels = dsp_kernels();
+    float step = (to - from) / (float)frames;
+    switch (format) {
+    case ma_format_f32:
+        kernels.gain_ramp_f32((float*)samples, frames, channels, from, to);
+        break;
+    case ma_format_s16:
+        kernels.gain_ramp_s16((ma_int16*)samples, frames, channels, from, to);
+        break;
+    case ma_format_u8: {
+        ma_uint8* p = (ma_uint8*)samples;
+        for (ma_uint32 i = 0; i < frames; ++i) {
+            float g = from + step * (float)i;
+            for (ma_uint32 c = 0; c < channels; ++c, ++p) {
+                float v = ((int)*p - 128) * g;
+                *p = (ma_uint8)(std::min(std::max(lrintf(v), -128L), 127L) + 128);
+            }
+        }
+        break;
+    }
+    case ma_format_s24: {
+        ma_uint8* p = (ma_uint8*)samples;
+        for (ma_uint32 i = 0; i < frames; ++i) {
+            float g = from + step * (float)i;
+            for (ma_uint32 c = 0; c < channels; ++c, p += 3) {
+                double v = (double)load_s24(p) * g;
+                store_s24(p, (ma_int32)std::min(std::max(std::lrint(v), -8388608L), 8388607L));
+            }
+        }
+        break;
+    }
+    case ma_format_s32: {
+        ma_int32* p = (ma_int32*)samples;
+        for (ma_uint32 i = 0; i < frames; ++i) {
+            float g = from + step * (float)i;
+            for (ma_uint32 c = 0; c < channels; ++c, ++p) {
+                double v = (double)*p * g;
+                *p = (ma_int32)std::min(std::max(v, -2147483648.0), 2147483647.0);
+            }
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+// ---- 响度测量（ITU-R BS.1770 K 加权与真峰值） ----
+
+namespace {
+
+// 真峰值插值的标量实现（向量路径处理不足一组的尾部）
+float true_peak_scalar(const float* x, size_t frames, const float* coeffs) {
+    float peak = 0.0f;
+    for (size_t n = 0; n < frames; ++n) {
+        for (ma_uint32 p = 0; p < TRUE_PEAK_PHASES; ++p) {
+            float acc = coeffs[p] * x[n];
+            for (ma_uint32 k = 1; k < TRUE_PEAK_TAPS; ++k) {
+                acc += coeffs[k * TRUE_PEAK_PHASES + p] * x[(ptrdiff_t)n - k];
+            }
+            peak = std::max(peak, std::fabs(acc));
+        }
+    }
+    return peak;
+}
+
+} // namespace
+
+void k_weight_init(KWeightState* state, const BiquadCoeffs& pre, const BiquadCoeffs& rlb) {
+    const BiquadCoeffs* stages[4] = {&pre, &pre, &rlb, &rlb};
+    for (int lane = 0; lane < 4; ++lane) {
+        state->coeffs[0][lane] = stages[lane]->b0;
+        state->coeffs[1][lane] = stages[lane]->b1;
+        state->coeffs[2][lane] = stages[lane]->b2;
+        state->coeffs[3][lane] = stages[lane]->a1;
+        state->coeffs[4][lane] = stages[lane]->a2;
+        state->s1[lane] = 0.0f;
+        state->s2[lane] = 0.0f;
+    }
+    state->stage1_out[0] = 0.0f;
+    state->stage1_out[1] = 0.0f;
+}
+
+#if defined(CAUDIO_DSP_SSE2)
+
+namespace {
+
+// 四路转置直接 II 型双二阶滤波推进一帧
+inline __m128 biquad_step(__m128 in, const __m128* c, __m128* s1, __m128* s2) {
+    __m128 y = _mm_add_ps(_mm_mul_ps(c[0], in), *s1);
+    *s1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(c[1], in), _mm_mul_ps(c[3], y)), *s2);
+    *s2 = _mm_sub_ps(_mm_mul_ps(c[2], in), _mm_mul_ps(c[4], y));
+    return y;
+}
+
+} // namespace
+
+void k_weight_energy_f32(const float* samples, ma_uint32 frames, ma_uint32 channels, ma_uint32 first_channel,
+                         ma_uint32 count, KWeightState* state, double* energy) {
+    __m128 c[5];
+    for (int i = 0; i < 5; ++i) {
+        c[i] = _mm_loadu_ps(state->coeffs[i]);
+    }
+    __m128 s1 = _mm_loadu_ps(state->s1);
+    __m128 s2 = _mm_loadu_ps(state->s2);
+    __m128 prev = _mm_setr_ps(state->stage1_out[0], state->stage1_out[1], 0.0f, 0.0f);
+    __m128 acc = _mm_setzero_ps();
+
+    const float* p = samples + first_channel;
+    if (count > 1) {
+        for (ma_uint32 i = 0; i < frames; ++i, p += channels) {
+            // 低两路为本帧的两个声道，高两路为一级上一帧的输出
+            __m128 x = _mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)p));
+            prev = biquad_step(_mm_movelh_ps(x, prev), c, &s1, &s2);
+            acc = _mm_add_ps(acc, _mm_mul_ps(prev, prev));
+        }
+    } else {
+        for (ma_uint32 i = 0; i < frames; ++i, p += channels) {
+            prev = biquad_step(_mm_movelh_ps(_mm_load_ss(p), prev), c, &s1, &s2);
+            acc = _mm_add_ps(acc, _mm_mul_ps(prev, prev));
+        }
+    }
+
+    float sums[4];
+    float out[4];
+    _mm_storeu_ps(sums, acc);
+    _mm_storeu_ps(out, prev);
+    _mm_storeu_ps(state->s1, s1);
+    _mm_storeu_ps(state->s2, s2);
+    state->stage1_out[0] = out[0];
+    state->stage1_out[1] = out[1];
+    for (ma_uint32 ch = 0; ch < count; ++ch) {
+        energy[ch] += sums[2 + ch];
+    }
+}
+
+float true_peak_f32(const float* x, size_t frames, const float* coeffs) {
+    // 每次计算 4 个相位在连续 4 帧上的输出：四个累加器互不依赖，
+    // 每个抽头只需一次非对齐加载 x[n-k .. n-k+3]，与四个相位的系数各乘一次
+    __m128 c[TRUE_PEAK_TAPS * TRUE_PEAK_PHASES];
+    for (ma_uint32 i = 0; i < TRUE_PEAK_TAPS * TRUE_PEAK_PHASES; ++i) {
+        c[i] = _mm_set1_ps(coeffs[i]);
+    }
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 peak = _mm_setzero_ps();
+    size_t n = 0;
+    for (; n + 4 <= frames; n += 4) {
+        __m128 v = _mm_loadu_ps(x + n);
+        __m128 acc0 = _mm_mul_ps(c[0], v);
+        __m128 acc1 = _mm_mul_ps(c[1], v);
+        __m128 acc2 = _mm_mul_ps(c[2], v);
+        __m128 acc3 = _mm_mul_ps(c[3], v);
+        for (ma_uint32 k = 1; k < TRUE_PEAK_TAPS; ++k) {
+            v = _mm_loadu_ps(x + (ptrdiff_t)n - k);
+            const __m128* ck = c + k * TRUE_PEAK_PHASES;
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(ck[0], v));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(ck[1], v));
+            acc2 = _mm_add_ps(acc2, _mm_mul_ps(ck[2], v));
+            acc3 = _mm_add_ps(acc3, _mm_mul_ps(ck[3], v));
+        }
+        peak = _mm_max_ps(peak, _mm_max_ps(_mm_and_ps(acc0, abs_mask), _mm_and_ps(acc1, abs_mask)));
+        peak = _mm_max_ps(peak, _mm_max_ps(_mm_and_ps(acc2, abs_mask), _mm_and_ps(acc3, abs_mask)));
+    }
+    peak = _mm_max_ps(peak, _mm_shuffle_ps(peak, peak, _MM_SHUFFLE(1, 0, 3, 2)));
+    peak = _mm_max_ps(peak, _mm_shuffle_ps(peak, peak, _MM_SHUFFLE(2, 3, 0, 1)));
+    return std::max(_mm_cvtss_f32(peak), true_peak_scalar(x + n, frames - n, coeffs));
+}
+
+#elif defined(CAUDIO_DSP_NEON)
+
+namespace {
+
+inline float32x4_t biquad_step(float32x4_t in, const float32x4_t* c, float32x4_t* s1, float32x4_t* s2) {
+    float32x4_t y = vaddq_f32(vmulq_f32(c[0], in), *s1);
+    *s1 = vaddq_f32(vsubq_f32(vmulq_f32(c[1], in), vmulq_f32(c[3], y)), *s2);
+    *s2 = vsubq_f32(vmulq_f32(c[2], in), vmulq_f32(c[4], y));
+    return y;
+}
+
+} // namespace
+
+void k_weight_energy_f32(const float* samples, ma_uint32 frames, ma_uint32 channels, ma_uint32 first_channel,
+                         ma_uint32 count, KWeightState* state, double* energy) {
+    float32x4_t c[5];
+    for (int i = 0; i < 5; ++i) {
+        c[i] = vld1q_f32(state->coeffs[i]);
+    }
+    float32x4_t s1 = vld1q_f32(state->s1);
+    float32x4_t s2 = vld1q_f32(state->s2);
+    float32x4_t prev = vcombine_f32(vld1_f32(state->stage1_out), vdup_n_f32(0.0f));
+    float32x4_t acc = vdupq_n_f32(0.0f);
+
+    const float* p = samples + first_channel;
+    for (ma_uint32 i = 0; i < frames; ++i, p += channels) {
+        float32x2_t x = count > 1 ? vld1_f32(p) : vset_lane_f32(p[0], vdup_n_f32(0.0f), 0);
+        prev = biquad_step(vcombine_f32(x, vget_low_f32(prev)), c, &s1, &s2);
+        acc = vaddq_f32(acc, vmulq_f32(prev, prev));
+    }
+
+    float sums[4];
+    vst1q_f32(sums, acc);
+    vst1q_f32(state->s1, s1);
+    vst1q_f32(state->s2, s2);
+    vst1_f32(state->stage1_out, vget_low_f32(prev));
+    for (ma_uint32 ch = 0; ch < count; ++ch) {
+        energy[ch] += sums[2 + ch];
+    }
+}
+
+float true_peak_f32(const float* x, size_t frames, const float* coeffs) {
+    float32x4_t peak = vdupq_n_f32(0.0f);
+    size_t n = 0;
+    for (; n + 4 <= frames; n += 4) {
+        float32x4_t v = vld1q_f32(x + n);
+        float32x4_t acc0 = vmulq_n_f32(v, coeffs[0]);
+        float32x4_t acc1 = vmulq_n_f32(v, coeffs[1]);
+        float32x4_t acc2 = vmulq_n_f32(v, coeffs[2]);
+        float32x4_t acc3 = vmulq_n_f32(v, coeffs[3]);
+        for (ma_uint32 k = 1; k < TRUE_PEAK_TAPS; ++k) {
+            v = vld1q_f32(x + (ptrdiff_t)n - k);
+            const float* ck = coeffs + k * TRUE_PEAK_PHASES;
+            acc0 = vaddq_f32(acc0, vmulq_n_f32(v, ck[0]));
+            acc1 = vaddq_f32(acc1, vmulq_n_f32(v, ck[1]));
+            acc2 = vaddq_f32(acc2, vmulq_n_f32(v, ck[2]));
+            acc3 = vaddq_f32(acc3, vmulq_n_f32(v, ck[3]));
+        }
+        peak = vmaxq_f32(peak, vmaxq_f32(vabsq_f32(acc0), vabsq_f32(acc1)));
+        peak = vmaxq_f32(peak, vmaxq_f32(vabsq_f32(acc2), vabsq_f32(acc3)));
+    }
+    float lanes[4];
+    vst1q_f32(lanes, peak);
+    float vector_peak = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+    return std::max(vector_peak, true_peak_scalar(x + n, frames - n, coeffs));
+}
+
+#else
+
+void k_weight_energy_f32(const float* samples, ma_uint32 frames, ma_uint32 channels, ma_uint32 first_channel,
+                         ma_uint32 count, KWeightState* state, double* energy) {
+    float prev[2] = {state->stage1_out[0], state->stage1_out[1]};
+    float sums[2] = {0.0f, 0.0f};
+    const float* p = samples + first_channel;
+    for (ma_uint32 i = 0; i < frames; ++i, p += channels) {
+        float in[4] = {p[0], count > 1 ? p[1] : 0.0f, prev[0], prev[1]};
+        float y[4];
+        for (int lane = 0; lane < 4; ++lane) {
+            const float (*c)[4] = state->coeffs;
+            y[lane] = c[0][lane] * in[lane] + state->s1[lane];
+            state->s1[lane] = c[1][lane] * in[lane] - c[3][lane] * y[lane] + state->s2[lane];
+            state->s2[lane] = c[2][lane] * in[lane] - c[4][lane] * y[lane];
+        }
+        prev[0] = y[0];
+        prev[1] = y[1];
+        sums[0] += y[2] * y[2];
+        sums[1] += y[3] * y[3];
+    }
+    state->stage1_out[0] = prev[0];
+    state->stage1_out[1] = prev[1];
+    for (ma_uint32 ch = 0; ch < count; ++ch) {
+        energy[ch] += sums[ch];
+    }
+}
+
+float true_peak_f32(const float* x, size_t frames, const float* coeffs) {
+    return true_peak_scalar(x, frames, coeffs);
+}
+
+#endif
+
+void make_true_peak_filter(float* coeffs) {
+    const ma_uint32 length = TRUE_PEAK_TAPS * TRUE_PEAK_PHASES;
+    const double pi = 3.14159265358979323846;
+    double h[TRUE_PEAK_TAPS * TRUE_PEAK_PHASES];
+    for (ma_uint32 i = 0; i < length; ++i) {
+        // 截止频率为原采样率的奈奎斯特频率，Blackman 窗
+        double t = ((double)i - (length - 1) / 2.0) / TRUE_PEAK_PHASES;
+        double sinc = t == 0.0 ? 1.0 : std::sin(pi * t) / (pi * t);
+        double w = 0.42 - 0.5 * std::cos(2 * pi * i / (length - 1)) + 0.08 * std::cos(4 * pi * i / (length - 1));
+        h[i] = sinc * w;
+    }
+    for (ma_uint32 p = 0; p < TRUE_PEAK_PHASES; ++p) {
+        double sum = 0.0;
+        for (ma_uint32 k = 0; k < TRUE_PEAK_TAPS; ++k) {
+            sum += h[k * TRUE_PEAK_PHASES + p];
+        }
+        for (ma_uint32 k = 0; k < TRUE_PEAK_TAPS; ++k) {
+            coeffs[k * TRUE_PEAK_PHASES + p] = (float)(h[k * TRUE_PEAK_PHASES + p] / sum);
+        }
+    }
+}
+
+// ---- 级联双二阶滤波（参数均衡） ----
+
+void biquad_cascade_init(BiquadCascadeState* state, ma_uint32 stages) {
+    stages = std::min(stages, MAX_BIQUAD_STAGES);
+    state->vectors = (stages + 1) / 2;
+    memset(state->s1, 0, sizeof(state->s1));
+    memset(state->s2, 0, sizeof(state->s2));
+    memset(state->out, 0, sizeof(state->out));
+    biquad_cascade_set(state, nullptr, 0);
+}
+
+void biquad_cascade_set(BiquadCascadeState* state, const BiquadCoeffs* stages, ma_uint32 count) {
+    const BiquadCoeffs identity = {1.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    for (ma_uint32 stage = 0; stage < state->vectors * 2; ++stage) {
+        const BiquadCoeffs& c = stage < count ? stages[stage] : identity;
+        float (*lanes)[4] = state->coeffs[stage / 2];
+        for (ma_uint32 lane = (stage % 2) * 2; lane < (stage % 2) * 2 + 2; ++lane) {
+            lanes[0][lane] = c.b0;
+            lanes[1][lane] = c.b1;
+            lanes[2][lane] = c.b2;
+            lanes[3][lane] = c.a1;
+            lanes[4][lane] = c.a2;
+        }
+    }
+}
+
+#if defined(CAUDIO_DSP_SSE2)
+
+void biquad_cascade_f32(float* samples, ma_uint32 frames, ma_uint32 channels, ma_uint32 first_channel,
+                        ma_uint32 count, BiquadCascadeState* state) {
+    const ma_uint32 vectors = state->vectors;
+    if (vectors == 0) {
+        return;
+    }
+    __m128 c[MAX_BIQUAD_STAGES / 2][5];
+    __m128 s1[MAX_BIQUAD_STAGES / 2];
+    __m128 s2[MAX_BIQUAD_STAGES / 2];
+    __m128 y[MAX_BIQUAD_STAGES / 2];
+    for (ma_uint32 v = 0; v < vectors; ++v) {
+        for (int i = 0; i < 5; ++i) {
+            c[v][i] = _mm_loadu_ps(state->coeffs[v][i]);
+        }
+        s1[v] = _mm_loadu_ps(state->s1[v]);
+        s2[v] = _mm_loadu_ps(state->s2[v]);
+        y[v] = _mm_loadu_ps(state->out[v]);
+    }
+
+    float* p = samples + first_channel;
+    for (ma_uint32 i = 0; i < frames; ++i, p += channels) {
+        __m128 x = count > 1 ? _mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)p)) : _mm_load_ss(p);
+        // 从后往前推进：每个向量的输入都是前一级上一帧的输出
+        for (ma_uint32 v = vectors - 1; v > 0; --v) {
+            __m128 in = _mm_shuffle_ps(y[v - 1], y[v], _MM_SHUFFLE(1, 0, 3, 2));
+            y[v] = biquad_step(in, c[v], &s1[v], &s2[v]);
+        }
+        y[0] = biquad_step(_mm_movelh_ps(x, y[0]), c[0], &s1[0], &s2[0]);
+
+        __m128 out = _mm_movehl_ps(y[vectors - 1], y[vectors - 1]);
+        if (count > 1) {
+            _mm_storel_pi((__m64*)p, out);
+        } else {
+            _mm_store_ss(p, out);
+        }
+    }
+
+    for (ma_uint32 v = 0; v < vectors; ++v) {
+        _mm_storeu_ps(state->s1[v], s1[v]);
+        _mm_storeu_ps(state->s2[v], s2[v]);
+        _mm_storeu_ps(state->out[v], y[v]);
+    }
+}
+
+#elif defined(CAUDIO_DSP_NEON)
+
+void biquad_cascade_f32(float* samples, ma_uint32 frames, ma_uint32 channels, ma_uint32 first_channel,
+                        ma_uint32 count, BiquadCascadeState* state) {
+    const ma_uint32 vectors = state->vectors;
+    if (vectors == 0) {
+        return;
+    }
+    float32x4_t c[MAX_BIQUAD_STAGES / 2][5];
+    float32x4_t s1[MAX_BIQUAD_STAGES / 2];
+    float32x4_t s2[MAX_BIQUAD_STAGES / 2];
+    float32x4_t y[MAX_BIQUAD_STAGES / 2];
+    for (ma_uint32 v = 0; v < vectors; ++v) {
+        for (int i = 0; i < 5; ++i) {
+            c[v][i] = vld1q_f32(state->coeffs[v][i]);
+        }
+        s1[v] = vld1q_f32(state->s1[v]);
+        s2[v] = vld1q_f32(state->s2[v]);
+        y[v] = vld1q_f32(state->out[v]);
+    }
+
+    float* p = samples + first_channel;
+    for (ma_uint32 i = 0; i < frames; ++i, p += channels) {
+        float32x2_t x = count > 1 ? vld1_f32(p) : vset_lane_f32(p[0], vdup_n_f32(0.0f), 0);
+        for (ma_uint32 v = vectors - 1; v > 0; --v) {
+            float32x4_t in = vcombine_f32(vget_high_f32(y[v - 1]), vget_low_f32(y[v]));
+            y[v] = biquad_step(in, c[v], &s1[v], &s2[v]);
+        }
+        y[0] = biquad_step(vcombine_f32(x, vget_low_f32(y[0])), c[0], &s1[0], &s2[0]);
+
+        float32x2_t out = vget_high_f32(y[vectors - 1]);
+        if (count > 1) {
+            vst1_f32(p, out);
+        } else {
+            p[0] = vget_lane_f32(out, 0);
+        }
+    }
+
+    for (ma_uint32 v = 0; v < vectors; ++v) {
+        vst1q_f32(state->s1[v], s1[v]);
+        vst1q_f32(state->s2[v], s2[v]);
+        vst1q_f32(state->out[v], y[v]);
+    }
+}
+
+#else
+
+void biquad_cascade_f32(float* samples, ma_uint32 frames, ma_uint32 channels, ma_uint32 first_channel,
+                        ma_uint32 count, BiquadCascadeState* state) {
+    const ma_uint32 vectors = state->vectors;
+    if (vectors == 0) {
+        return;
+    }
+    float* p = samples + first_channel;
+    for (ma_uint32 i = 0; i < frames; ++i, p += channels) {
+        float x[2] = {p[0], count > 1 ? p[1] : 0.0f};
+        for (ma_uint32 v = vectors; v-- > 0;) {
+            float in[4];
+            if (v > 0) {
+                in[0] = state->out[v - 1][2];
+                in[1] = state->out[v - 1][3];
+            } else {
+                in[0] = x[0];
+                in[1] = x[1];
+            }
+            in[2] = state->out[v][0];
+            in[3] = state->out[v][1];
+            const float (*c)[4] = state->coeffs[v];
+            for (int lane = 0; lane < 4; ++lane) {
+                float y = c[0][lane] * in[lane] + state->s1[v][lane];
+                state->s1[v][lane] = c[1][lane] * in[lane] - c[3][lane] * y + state->s2[v][lane];
+                state->s2[v][lane] = c[2][lane] * in[lane] - c[4][lane] * y;
+                state->out[v][lane] = y;
+            }
+        }
+        p[0] = state->out[vectors - 1][2];
+        if (count > 1) {
+            p[1] = state->out[vectors - 1][3];
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef DSP_KERNELS_H
+#define DSP_KERNELS_H
+
+#include "third-party/miniaudio.h"
+
+// 生成等功率交叉淡入淡出曲线：fade_out[i] = cos(t·π/2)，fade_in[i] = sin(t·π/2)，t = i / frames
+// 任意时刻 fade_out² + fade_in² = 1，两路不相关信号叠加后响度保持不变
+void make_equal_power_curve(float* fade_out, float* fade_in, ma_uint32 frames);
+
+// 交叉混音（f32 交错格式，可原地处理 out == a）：
+//   out[i][c] = a[i][c] * gain_a[i] + b[i][c] * gain_b[i]
+// 增益按帧给出；单声道和立体声走向量化路径，其余声道数走标量路径
+void mix_crossfade_f32(float* out, const float* a, const float* b,
+                       const float* gain_a, const float* gain_b,
+                       ma_uint32 frames, ma_uint32 channels);
+
+// ---- 音量、增益渐变与混音 ----
+// 以下内核按运行时检测到的 CPU 特性选择实现（AVX2 / SSE2 / NEON，其余走标量），
+// 不分配内存、不加锁，可以在设备回调中直接调用
+
+// 内核实现的指令集
+enum class DspIsa {
+    Scalar,
+    Sse2,
+    Avx2,
+    Neon,
+};
+
+const char* dsp_isa_name(DspIsa isa);
+
+// 一组内核实现。增益渐变：第 i 帧（i = 0 .. frames-1）的增益为 from + (to - from) * i / frames，
+// 下一段从 to 开始即可无缝衔接；from == to 时是恒定增益。
+// 向量路径处理声道数整除向量宽度的情况（1/2/4/8 声道），其余声道数走标量路径
+struct DspKernels {
+    DspIsa isa;
+    void (*gain_ramp_f32)(float* samples, ma_uint32 frames, ma_uint32 channels, float from, float to);
+    void (*gain_ramp_s16)(ma_int16* samples, ma_uint32 frames, ma_uint32 channels, float from, float to);
+    // 混音累加：out[i] += in[i] * gain（按样本计数）
+    void (*mix_f32)(float* out, const float* in, size_t samples, float gain);
+};
+
+// 当前 CPU 上可用的最快实现（第一次调用时检测，之后不变）
+const DspKernels& dsp_kernels();
+
+// 指定指令集的实现；未编译进来或当前 CPU 不支持时返回 nullptr（基准测试用）
+const DspKernels* dsp_kernels_for(DspIsa isa);
+
+// 按采样格式对交错 PCM 做增益渐变：f32 / s16 走上面的内核，u8 / s24 / s32 走标量路径
+void apply_gain_ramp(void* samples, ma_format format, ma_uint32 frames, ma_uint32 channels, float from, float to);
+
+// ---- 响度测量（ITU-R BS.1770 K 加权与真峰值） ----
+// 以下内核按编译目标选择 SSE2 / NEON 实现，其余平台走标量路径，结果与标量路径一致
+
+// 双二阶滤波器系数（已按 a0 归一化）
+struct BiquadCoeffs {
+    float b0, b1, b2, a1, a2;
+};
+
+// 一对声道的 K 加权滤波器（两级双二阶：高架预滤波 + RLB 高通，转置直接 II 型）。
+// IIR 在时间上无法并行，这里把两级流水线化后放进 4 个通道：
+//   [声道 0 一级, 声道 1 一级, 声道 0 二级, 声道 1 二级]
+// 二级处理的是一级上一帧的输出，每帧用同一组乘加同时推进四路，滤波输出因此比输入晚一帧
+struct KWeightState {
+    float coeffs[5][4];   // b0 b1 b2 a1 a2，按通道展开
+    float s1[4];
+    float s2[4];
+    float stage1_out[2];  // 一级上一帧的输出（二级下一帧的输入）
+};
+
+// 按两级系数初始化并清零滤波器状态
+void k_weight_init(KWeightState* state, const BiquadCoeffs& pre, const BiquadCoeffs& rlb);
+
+// 对交错 f32 中从 first_channel 开始的 count（1 或 2）个声道做 K 加权，
+// 把滤波输出的平方和累加到 energy[0 .. count-1]
+void k_weight_energy_f32(const float* samples, ma_uint32 frames, ma_uint32 channels, ma_uint32 first_channel,
+                         ma_uint32 count, KWeightState* state, double* energy);
+
+// 真峰值：4 倍过采样的多相 FIR 插值，每相的抽头数
+constexpr ma_uint32 TRUE_PEAK_PHASES = 4;
+constexpr ma_uint32 TRUE_PEAK_TAPS = 12;
+
+// 生成插值滤波器系数：coeffs[k * 4 + p] 为第 p 相的第 k 个抽头（加窗 sinc，每相直流增益为 1）
+void make_true_peak_filter(float* coeffs);
+
+// 对单声道连续样本 x[0 .. frames-1] 做 4 倍插值，返回插值结果的最大绝对值。
+// 向量路径每次计算连续 4 帧上四个相位的输出（四个独立的累加器）；x 之前必须有 TRUE_PEAK_TAPS - 1 个历史样本可读
+float true_peak_f32(const float* x, size_t frames, const float* coeffs);
+
+// ---- 级联双二阶滤波（参数均衡） ----
+
+// 级联的最大级数（两级放一个向量）
+constexpr ma_uint32 MAX_BIQUAD_STAGES = 16;
+
+// 一对声道的级联双二阶滤波器（转置直接 II 型）。与 K 加权相同的流水线方式：
+// 第 v 个向量放第 2v、2v+1 级的两个声道 [声道 0 偶数级, 声道 1 偶数级, 声道 0 奇数级, 声道 1 奇数级]，
+// 每帧所有向量都以上一帧的结果为输入同时推进，互不依赖。输出比输入晚 2 * vectors - 1 帧
+struct BiquadCascadeState {
+    ma_uint32 vectors;
+    float coeffs[MAX_BIQUAD_STAGES / 2][5][4];  // b0 b1 b2 a1 a2，按通道展开
+    float s1[MAX_BIQUAD_STAGES / 2][4];
+    float s2[MAX_BIQUAD_STAGES / 2][4];
+    float out[MAX_BIQUAD_STAGES / 2][4];        // 各向量上一帧的输出
+};
+
+// 按级数初始化：清零状态，所有级为直通
+void biquad_cascade_init(BiquadCascadeState* state, ma_uint32 stages);
+
+// 只替换系数（保留滤波器状态），count 之后的级为直通
+void biquad_cascade_set(BiquadCascadeState* state, const BiquadCoeffs* stages, ma_uint32 count);
+
+// 原地滤波交错 f32 中从 first_channel 开始的 count（1 或 2）个声道
+void biquad_cascade_f32(float* samples, ma_uint32 frames, ma_uint32 channels, ma_uint32 first_channel,
+                        ma_uint32 count, BiquadCascadeState* state);
+
+#endif // DSP_KERNELS_H
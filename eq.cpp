@@ -0,0 +1,337 @@
+#include "eq.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+// 频段增益和前级增益的允许范围（dB）
+const double EQ_MAX_GAIN_DB = 30.0;
+
+bool parse_number(const std::string& text, double* value) {
+    char* end = nullptr;
+    *value = strtod(text.c_str(), &end);
+    return end != text.c_str() && *end == '\0' && std::isfinite(*value);
+}
+
+std::string lower(std::string text) {
+    for (char& c : text) {
+        c = (char)tolower((unsigned char)c);
+    }
+    return text;
+}
+
+bool parse_band_type(const std::string& name, EqBandType* type) {
+    if (name == "peak" || name == "peaking" || name == "pk" || name == "peq") {
+        *type = EqBandType::Peaking;
+        return true;
+    }
+    if (name == "lowshelf" || name == "ls" || name == "lsc" || name == "lowshelf2") {
+        *type = EqBandType::LowShelf;
+        return true;
+    }
+    if (name == "highshelf" || name == "hs" || name == "hsc" || name == "highshelf2") {
+        *type = EqBandType::HighShelf;
+        return true;
+    }
+    return false;
+}
+
+// EqualizerAPO 的一行 "Filter 1: ON PK Fc 105 Hz Gain -3.2 dB Q 0.70"（已去掉 "Filter N:"），
+// enabled 为 false 表示该频段标记为 OFF
+bool parse_apo_filter(const std::vector<std::string>& tokens, size_t begin, EqBand* band, bool* enabled,
+                      std::string* error) {
+    size_t i = begin;
+    *enabled = true;
+    if (i < tokens.size() && (tokens[i] == "on" || tokens[i] == "off")) {
+        *enabled = tokens[i] == "on";
+        ++i;
+    }
+    if (i >= tokens.size() || !parse_band_type(tokens[i], &band->type)) {
+        *error = "unsupported filter type" + (i < tokens.size() ? " '" + tokens[i] + "'" : std::string());
+        return false;
+    }
+    bool has_frequency = false;
+    for (++i; i < tokens.size(); ++i) {
+        const std::string& key = tokens[i];
+        double* target = key == "fc" ? &band->frequency : key == "gain" ? &band->gain_db : key == "q" ? &band->q : nullptr;
+        if (target == nullptr) {
+            continue;  // 单位 "Hz" / "dB"
+        }
+        if (i + 1 >= tokens.size() || !parse_number(tokens[i + 1], target)) {
+            *error = "missing value for '" + key + "'";
+            return false;
+        }
+        has_frequency |= target == &band->frequency;
+        ++i;
+    }
+    if (!has_frequency) {
+        *error = "missing Fc";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool load_eq_file(const std::string& path, EqSettings* settings, std::string* error) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        *error = "cannot open " + path;
+        return false;
+    }
+
+    EqSettings result;
+    std::string line;
+    for (int number = 1; std::getline(file, line); ++number) {
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+        std::vector<std::string> tokens;
+        std::istringstream ss(lower(line));
+        for (std::string token; ss >> token;) {
+            tokens.push_back(token);
+        }
+        if (tokens.empty()) {
+            continue;
+        }
+
+        std::string message;
+        std::string keyword = tokens[0];
+        if (!keyword.empty() && keyword.back() == ':') {
+            keyword.pop_back();
+        }
+        if (keyword == "preamp") {
+            if (tokens.size() < 2 || !parse_number(tokens[1], &result.preamp_db)) {
+                message = "invalid preamp";
+            } else if (std::fabs(result.preamp_db) > EQ_MAX_GAIN_DB) {
+                message = "preamp out of range";
+            }
+        } else {
+            EqBand band;
+            bool enabled = true;
+            if (keyword.compare(0, 6, "filter") == 0) {
+                // "Filter:"、"Filter 1:"、"Filter1:"
+                size_t begin = 1;
+                if (tokens[0].back() != ':' && begin < tokens.size() && tokens[begin].back() == ':') {
+                    ++begin;
+                }
+                parse_apo_filter(tokens, begin, &band, &enabled, &message);
+            } else if (!parse_band_type(keyword, &band.type)) {
+                message = "unknown keyword '" + tokens[0] + "'";
+            } else if (tokens.size() < 3 || tokens.size() > 4 || !parse_number(tokens[1], &band.frequency) ||
+                       !parse_number(tokens[2], &band.gain_db) ||
+                       (tokens.size() == 4 && !parse_number(tokens[3], &band.q))) {
+                message = "expected '" + tokens[0] + " <Hz> <dB> [Q]'";
+            }
+
+            if (message.empty() && (band.frequency <= 0.0 || band.q <= 0.0)) {
+                message = "frequency and Q must be positive";
+            } else if (message.empty() && std::fabs(band.gain_db) > EQ_MAX_GAIN_DB) {
+                message = "gain out of range";
+            } else if (message.empty() && enabled && result.bands.size() >= EQ_MAX_BANDS) {
+                message = "too many bands (max " + std::to_string(EQ_MAX_BANDS) + ")";
+            }
+            if (message.empty() && enabled) {
+                result.bands.push_back(band);
+            }
+        }
+
+        if (!message.empty()) {
+            *error = path + ":" + std::to_string(number) + ": " + message;
+            return false;
+        }
+    }
+
+    *settings = result;
+    return true;
+}
+
+std::string describe_eq(const EqSettings& settings) {
+    char text[64];
+    snprintf(text, sizeof(text), "%zu band%s, preamp %.1f dB", settings.bands.size(),
+             settings.bands.size() == 1 ? "" : "s", settings.preamp_db);
+    return text;
+}
+
+BiquadCoeffs eq_band_coeffs(const EqBand& band, ma_uint32 sample_rate) {
+    const BiquadCoeffs identity = {1.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    if (sample_rate == 0 || band.frequency >= sample_rate / 2.0 || band.gain_db == 0.0) {
+        return identity;
+    }
+
+    const double pi = 3.14159265358979323846;
+    double a = std::pow(10.0, band.gain_db / 40.0);
+    double w0 = 2.0 * pi * band.frequency / sample_rate;
+    double cosw = std::cos(w0);
+    double alpha = std::sin(w0) / (2.0 * band.q);
+    double b0, b1, b2, a0, a1, a2;
+    switch (band.type) {
+    case EqBandType::LowShelf: {
+        double k = 2.0 * std::sqrt(a) * alpha;
+        b0 = a * ((a + 1) - (a - 1) * cosw + k);
+        b1 = 2 * a * ((a - 1) - (a + 1) * cosw);
+        b2 = a * ((a + 1) - (a - 1) * cosw - k);
+        a0 = (a + 1) + (a - 1) * cosw + k;
+        a1 = -2 * ((a - 1) + (a + 1) * cosw);
+        a2 = (a + 1) + (a - 1) * cosw - k;
+        break;
+    }
+    case EqBandType::HighShelf: {
+        double k = 2.0 * std::sqrt(a) * alpha;
+        b0 = a * ((a + 1) + (a - 1) * cosw + k);
+        b1 = -2 * a * ((a - 1) + (a + 1) * cosw);
+        b2 = a * ((a + 1) + (a - 1) * cosw - k);
+        a0 = (a + 1) - (a - 1) * cosw + k;
+        a1 = 2 * ((a - 1) - (a + 1) * cosw);
+        a2 = (a + 1) - (a - 1) * cosw - k;
+        break;
+    }
+    default:
+        b0 = 1 + alpha * a;
+        b1 = -2 * cosw;
+        b2 = 1 - alpha * a;
+        a0 = 1 + alpha / a;
+        a1 = -2 * cosw;
+        a2 = 1 - alpha / a;
+        break;
+    }
+    return {(float)(b0 / a0), (float)(b1 / a0), (float)(b2 / a0), (float)(a1 / a0), (float)(a2 / a0)};
+}
+
+Equalizer::Equalizer()
+    : sample_rate_(0),
+      channels_(0),
+      enabled_(true),
+      shared_(1),
+      back_(0),
+      front_(2),
+      fade_frames_(0),
+      fade_position_(0),
+      fading_(false) {
+}
+
+void Equalizer::configure(ma_uint32 sample_rate, ma_uint32 channels, const EqSettings& settings, bool enabled) {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    sample_rate_ = sample_rate;
+    channels_ = channels;
+    settings_ = settings;
+    enabled_.store(enabled, std::memory_order_relaxed);
+
+    fade_frames_ = std::max<ma_uint32>(sample_rate * EQ_FADE_MS / 1000, 1);
+    fade_in_.resize(fade_frames_);
+    fade_out_.resize(fade_frames_);
+    for (ma_uint32 i = 0; i < fade_frames_; ++i) {
+        // 新旧滤波器的输出高度相关，线性淡变（两者之和为 1）才能保持响度不变
+        fade_in_[i] = (float)(i + 1) / (float)fade_frames_;
+        fade_out_[i] = 1.0f - fade_in_[i];
+    }
+    scratch_.resize((size_t)fade_frames_ * channels);
+
+    // 直接应用到回调端，不经过三缓冲，也不淡变
+    computeSlot(&slots_[front_]);
+    states_.resize((channels + 1) / 2);
+    previous_.resize(states_.size());
+    for (auto& state : states_) {
+        biquad_cascade_init(&state, EQ_MAX_BANDS);
+        biquad_cascade_set(&state, slots_[front_].stages, slots_[front_].count);
+    }
+    shared_.store(shared_.load(std::memory_order_relaxed) & ~SLOT_DIRTY, std::memory_order_relaxed);
+    fading_ = false;
+    fade_position_ = 0;
+}
+
+void Equalizer::setSettings(const EqSettings& settings) {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    settings_ = settings;
+    publish();
+}
+
+void Equalizer::setEnabled(bool enabled) {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    if (enabled_.load(std::memory_order_relaxed) != enabled) {
+        enabled_.store(enabled, std::memory_order_relaxed);
+        publish();
+    }
+}
+
+ma_uint32 Equalizer::latencyFrames() const {
+    return configured() ? (EQ_MAX_BANDS + 1) / 2 * 2 - 1 : 0;
+}
+
+void Equalizer::computeSlot(CoeffSlot* slot) const {
+    slot->count = 0;
+    if (!enabled_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    for (const EqBand& band : settings_.bands) {
+        if (slot->count < EQ_MAX_BANDS) {
+            slot->stages[slot->count++] = eq_band_coeffs(band, sample_rate_);
+        }
+    }
+    // 前级增益并入第一级的分子
+    if (settings_.preamp_db != 0.0) {
+        float gain = (float)std::pow(10.0, settings_.preamp_db / 20.0);
+        if (slot->count == 0) {
+            slot->stages[slot->count++] = {1.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+        }
+        slot->stages[0].b0 *= gain;
+        slot->stages[0].b1 *= gain;
+        slot->stages[0].b2 *= gain;
+    }
+}
+
+void Equalizer::publish() {
+    if (!configured()) {
+        return;
+    }
+    computeSlot(&slots_[back_]);
+    back_ = shared_.exchange(back_ | SLOT_DIRTY, std::memory_order_acq_rel) & ~SLOT_DIRTY;
+}
+
+void Equalizer::filter(float* samples, ma_uint32 frames, std::vector<BiquadCascadeState>& states) {
+    for (ma_uint32 pair = 0; pair < states.size(); ++pair) {
+        ma_uint32 first = pair * 2;
+        biquad_cascade_f32(samples, frames, channels_, first, std::min<ma_uint32>(channels_ - first, 2), &states[pair]);
+    }
+}
+
+void Equalizer::process(float* samples, ma_uint32 frames) {
+    if (!configured()) {
+        return;
+    }
+
+    // 淡变进行中不取新系数，结束后再取最新的一组
+    if (!fading_ && (shared_.load(std::memory_order_relaxed) & SLOT_DIRTY) != 0) {
+        front_ = shared_.exchange(front_, std::memory_order_acq_rel) & ~SLOT_DIRTY;
+        const CoeffSlot& slot = slots_[front_];
+        for (size_t pair = 0; pair < states_.size(); ++pair) {
+            previous_[pair] = states_[pair];
+            biquad_cascade_set(&states_[pair], slot.stages, slot.count);
+        }
+        fading_ = true;
+        fade_position_ = 0;
+    }
+
+    while (fading_ && frames > 0) {
+        ma_uint32 n = std::min(frames, fade_frames_ - fade_position_);
+        size_t samples_count = (size_t)n * channels_;
+        memcpy(scratch_.data(), samples, samples_count * sizeof(float));
+        filter(scratch_.data(), n, previous_);
+        filter(samples, n, states_);
+        mix_crossfade_f32(samples, samples, scratch_.data(), fade_in_.data() + fade_position_,
+                          fade_out_.data() + fade_position_, n, channels_);
+        fade_position_ += n;
+        fading_ = fade_position_ < fade_frames_;
+        samples += samples_count;
+        frames -= n;
+    }
+    filter(samples, frames, states_);
+}
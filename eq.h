@@ -0,0 +1,122 @@
+#ifndef EQ_H
+#define EQ_H
+
+#include "dsp_kernels.h"
+#include "third-party/miniaudio.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 频段数上限：级联固定为这么多级（不足的为直通），增减频段时滤波延迟不变
+constexpr ma_uint32 EQ_MAX_BANDS = 10;
+
+// 切换参数或开关时新旧滤波器输出交叉淡变的时长（毫秒）
+constexpr ma_uint32 EQ_FADE_MS = 20;
+
+enum class EqBandType {
+    Peaking,    // 峰值（钟形）
+    LowShelf,   // 低架
+    HighShelf,  // 高架
+};
+
+struct EqBand {
+    EqBandType type = EqBandType::Peaking;
+    double frequency = 1000.0;  // 中心 / 转折频率（Hz）
+    double gain_db = 0.0;
+    double q = 0.707;
+};
+
+struct EqSettings {
+    double preamp_db = 0.0;    // 前级增益，为提升频段留出余量
+    std::vector<EqBand> bands;
+};
+
+// 读取均衡器配置文件，每行一项，'#' 之后为注释：
+//   preamp -3
+//   peak 1000 -3 1.41          （类型 频率 增益 [Q]）
+//   lowshelf 105 4.5 0.7
+//   highshelf 8000 -2
+// 也接受 EqualizerAPO / REW 导出的格式：
+//   Preamp: -6.1 dB
+//   Filter 1: ON PK Fc 105 Hz Gain -3.2 dB Q 0.70    （PK / LSC / HSC，OFF 的行忽略）
+// 失败时返回 false 并写入带行号的 error
+bool load_eq_file(const std::string& path, EqSettings* settings, std::string* error);
+
+// "3 bands, preamp -6.0 dB" 形式的说明
+std::string describe_eq(const EqSettings& settings);
+
+// 按 RBJ Audio EQ Cookbook 计算一个频段的系数（与 miniaudio 的 ma_peak2 / ma_loshelf2 / ma_hishelf2 相同）。
+// 频率不低于奈奎斯特频率时返回直通
+BiquadCoeffs eq_band_coeffs(const EqBand& band, ma_uint32 sample_rate);
+
+// 参数均衡器：交错 f32 每对声道一个级联双二阶滤波器，在设备回调中原地处理。
+// 控制线程修改参数或开关时在控制线程上算好系数，经三缓冲无锁交给回调；
+// 回调拿到新系数后保留旧滤波器，在 EQ_FADE_MS 内从旧输出线性淡到新输出，不会因系数突变产生爆音。
+// 关闭时换成直通系数（同样淡变），滤波延迟始终不变
+class Equalizer {
+public:
+    Equalizer();
+
+    Equalizer(const Equalizer&) = delete;
+    Equalizer& operator=(const Equalizer&) = delete;
+
+    // 按输出格式分配全部状态并直接应用参数（不淡变）。在回调开始之前由控制线程调用
+    void configure(ma_uint32 sample_rate, ma_uint32 channels, const EqSettings& settings, bool enabled);
+
+    bool configured() const { return channels_ > 0; }
+
+    // 控制线程调用，可在播放中随时调用
+    void setSettings(const EqSettings& settings);
+    void setEnabled(bool enabled);
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // 滤波延迟（帧）
+    ma_uint32 latencyFrames() const;
+
+    // 回调线程调用：原地处理 frames 帧，不分配内存、不加锁
+    void process(float* samples, ma_uint32 frames);
+
+private:
+    struct CoeffSlot {
+        BiquadCoeffs stages[EQ_MAX_BANDS];
+        ma_uint32 count = 0;
+    };
+
+    // 按当前参数和开关计算系数
+    void computeSlot(CoeffSlot* slot) const;
+
+    // 把新系数写入后台槽位并与共享槽位交换（持有 control_mutex_）
+    void publish();
+
+    // 对每对声道运行级联滤波
+    void filter(float* samples, ma_uint32 frames, std::vector<BiquadCascadeState>& states);
+
+    ma_uint32 sample_rate_;
+    ma_uint32 channels_;
+
+    // 控制线程的状态（受 control_mutex_ 保护）
+    std::mutex control_mutex_;
+    EqSettings settings_;
+    std::atomic<bool> enabled_;
+
+    // 三缓冲：控制线程写 back_，回调读 front_，shared_ 为中间槽位，DIRTY 位表示有未取走的新系数
+    static constexpr int SLOT_DIRTY = 4;
+    CoeffSlot slots_[3];
+    std::atomic<int> shared_;
+    int back_;
+    int front_;
+
+    // 回调线程独占的状态（configure() 中预先分配）
+    std::vector<BiquadCascadeState> states_;    // 每对声道一个
+    std::vector<BiquadCascadeState> previous_;  // 淡变期间的旧滤波器
+    std::vector<float> scratch_;
+    std::vector<float> fade_in_;
+    std::vector<float> fade_out_;
+    ma_uint32 fade_frames_;
+    ma_uint32 fade_position_;
+    bool fading_;
+};
+
+#endif // EQ_H
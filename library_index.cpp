@@ -0,0 +1,1423 @@
+#include "library_index.h"
+#include "loudness.h"
+#include "mmap_vfs.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+// 索引文件格式：魔数 + 版本号，格式变化时递增版本号，旧索引自动作废重建
+static const uint32_t INDEX_MAGIC = 0x58494143;  // "CAIX"
+static const uint32_t INDEX_VERSION = 6;
+
+// 每条记录编码后的最小字节数（字符串按空串计）：用来在分配之前检查记录数，
+// 损坏的索引声明的记录数超出文件剩余大小时直接作废，而不是按它分配内存
+static const uint64_t INDEX_DIRECTORY_MIN_BYTES = 4 + 8;
+static const uint64_t INDEX_ENTRY_MIN_BYTES = 4 + 8 * 3 + 1 * 4 + 4 * 2 + 8 + 4 * 3 + 1 + 4 * 4;
+
+// 目录读取以等待 I/O 为主，线程数取硬件线程数的两倍（至少 4 个）
+static size_t scan_threads() {
+    return std::min<size_t>(std::max<size_t>(4, hardware_threads() * 2), 64);
+}
+
+#ifdef _WIN32
+static const char PATH_SEPARATOR = '\\';
+#else
+static const char PATH_SEPARATOR = '/';
+#endif
+
+AudioFormat audio_format_from_name(const std::string& filename) {
+    size_t dot = filename.find_last_of('.');
+    if (dot == std::string::npos) {
+        return AudioFormat::Unknown;
+    }
+
+    std::string ext = filename.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+
+    if (ext == "wav")  return AudioFormat::Wav;
+    if (ext == "mp3")  return AudioFormat::Mp3;
+    if (ext == "flac") return AudioFormat::Flac;
+    if (ext == "ogg")  return AudioFormat::Ogg;
+    if (ext == "m4a")  return AudioFormat::M4a;
+    if (ext == "aac")  return AudioFormat::Aac;
+    return AudioFormat::Unknown;
+}
+
+const char* audio_format_name(AudioFormat format) {
+    switch (format) {
+    case AudioFormat::Wav:  return "WAV";
+    case AudioFormat::Mp3:  return "MP3";
+    case AudioFormat::Flac: return "FLAC";
+    case AudioFormat::Ogg:  return "OGG";
+    case AudioFormat::M4a:  return "M4A";
+    case AudioFormat::Aac:  return "AAC";
+    default:                return "?";
+    }
+}
+
+bool audio_format_decodable(AudioFormat format) {
+    return format == AudioFormat::Wav || format == AudioFormat::Mp3 || format == AudioFormat::Flac;
+}
+
+namespace {
+
+// 探测时读取的文件头长度
+const size_t PROBE_BYTES = 4096;
+
+// MP3 比特率表（kbps）
+const int MP3_BITRATES[2][3][15] = {
+    {   // MPEG-1: Layer I / II / III
+        {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448},
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},
+        {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320},
+    },
+    {   // MPEG-2 / 2.5: Layer I / II / III
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},
+        {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},
+        {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},
+    },
+};
+const int MP3_SAMPLE_RATES[3] = {44100, 48000, 32000};
+
+// MP3 帧头中与时长有关的字段
+struct Mp3FrameHeader {
+    bool mpeg1 = false;
+    int layer = 0;           // 1: I, 2: II, 3: III
+    int bitrate = 0;         // bps
+    int sample_rate = 0;
+    bool mono = false;
+    bool crc = false;        // 帧头后跟 16 位 CRC
+    uint32_t samples = 0;    // 每帧的采样数
+    size_t length = 0;       // 帧长度（字节）
+};
+
+// 解析 MP3 帧头，不是合法帧头时返回 false
+bool parse_mp3_header(const unsigned char* h, Mp3FrameHeader* header) {
+    if (h[0] != 0xFF || (h[1] & 0xE0) != 0xE0) {
+        return false;
+    }
+    int version = (h[1] >> 3) & 3;       // 0: 2.5, 2: 2, 3: 1
+    int layer = (h[1] >> 1) & 3;         // 1: III, 2: II, 3: I
+    int bitrate_index = h[2] >> 4;
+    int rate_index = (h[2] >> 2) & 3;
+    int padding = (h[2] >> 1) & 1;
+    if (version == 1 || layer == 0 || bitrate_index == 0 || bitrate_index == 15 || rate_index == 3) {
+        return false;
+    }
+
+    bool mpeg1 = version == 3;
+    header->mpeg1 = mpeg1;
+    header->layer = 4 - layer;
+    header->bitrate = MP3_BITRATES[mpeg1 ? 0 : 1][3 - layer][bitrate_index] * 1000;
+    header->sample_rate = MP3_SAMPLE_RATES[rate_index] >> (mpeg1 ? 0 : (version == 2 ? 1 : 2));
+    header->mono = (h[3] >> 6) == 3;
+    header->crc = (h[1] & 1) == 0;
+    if (layer == 3) {
+        header->samples = 384;
+        header->length = (size_t)((12 * header->bitrate / header->sample_rate + padding) * 4);
+    } else {
+        header->samples = (layer == 1 && !mpeg1) ? 576 : 1152;
+        header->length = (size_t)(header->samples / 8 * header->bitrate / header->sample_rate + padding);
+    }
+    return true;
+}
+
+// 返回帧长度（字节），不是合法帧头时返回 0
+size_t mp3_frame_length(const unsigned char* h) {
+    Mp3FrameHeader header;
+    return parse_mp3_header(h, &header) ? header.length : 0;
+}
+
+// 在缓冲中查找两个相连的 MP3 帧头（避免把随机数据误判为帧同步），返回第一帧的偏移
+bool find_mp3_frame(const unsigned char* data, size_t size, size_t* offset) {
+    for (size_t i = 0; i + 4 <= size; ++i) {
+        size_t length = mp3_frame_length(data + i);
+        if (length == 0) {
+            continue;
+        }
+        if (i + length + 4 > size) {
+            // 第二个帧头超出已读范围：只有文件开头的帧头才直接接受
+            *offset = i;
+            return i == 0;
+        }
+        if (mp3_frame_length(data + i + length) != 0) {
+            *offset = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool find_mp3_sync(const unsigned char* data, size_t size) {
+    size_t offset;
+    return find_mp3_frame(data, size, &offset);
+}
+
+uint16_t le16(const unsigned char* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+uint32_t le32(const unsigned char* p) { return (uint32_t)le16(p) | ((uint32_t)le16(p + 2) << 16); }
+uint64_t le64(const unsigned char* p) { return (uint64_t)le32(p) | ((uint64_t)le32(p + 4) << 32); }
+uint32_t be32(const unsigned char* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+// 一次文件头探测得到的信息
+struct HeaderInfo {
+    bool has_duration = false;
+    DurationEstimate duration;
+    uint32_t channels = 0;
+    uint64_t audio_bytes = 0;   // 音频数据大小（不含标签和元数据块），用于计算平均码率
+    AudioTags tags;
+};
+
+// 标签中单个字段的长度上限，超过时（通常是损坏的标签）不读取
+const uint32_t MAX_TAG_FIELD_BYTES = 4096;
+
+void append_utf8(std::string* out, uint32_t cp) {
+    if (cp < 0x80) {
+        out->push_back((char)cp);
+    } else if (cp < 0x800) {
+        out->push_back((char)(0xC0 | (cp >> 6)));
+        out->push_back((char)(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out->push_back((char)(0xE0 | (cp >> 12)));
+        out->push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+        out->push_back((char)(0x80 | (cp & 0x3F)));
+    } else {
+        out->push_back((char)(0xF0 | (cp >> 18)));
+        out->push_back((char)(0x80 | ((cp >> 12) & 0x3F)));
+        out->push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+        out->push_back((char)(0x80 | (cp & 0x3F)));
+    }
+}
+
+// 去掉末尾的空白和 NUL（ID3v1 用空格或 NUL 补齐定长字段）
+std::string trim_tag(std::string text) {
+    size_t end = text.find('\0');
+    if (end != std::string::npos) {
+        text.resize(end);
+    }
+    while (!text.empty() && (unsigned char)text.back() <= ' ') {
+        text.pop_back();
+    }
+    return text;
+}
+
+std::string latin1_to_utf8(const unsigned char* p, size_t size) {
+    std::string out;
+    for (size_t i = 0; i < size && p[i] != 0; ++i) {
+        append_utf8(&out, p[i]);
+    }
+    return trim_tag(out);
+}
+
+std::string utf16_to_utf8(const unsigned char* p, size_t size, bool big_endian) {
+    std::string out;
+    for (size_t i = 0; i + 1 < size; i += 2) {
+        uint32_t unit = big_endian ? ((p[i] << 8) | p[i + 1]) : (p[i] | (p[i + 1] << 8));
+        if (unit == 0) {
+            break;
+        }
+        if (unit >= 0xD800 && unit < 0xDC00 && i + 3 < size) {
+            uint32_t low = big_endian ? ((p[i + 2] << 8) | p[i + 3]) : (p[i + 2] | (p[i + 3] << 8));
+            if (low >= 0xDC00 && low < 0xE000) {
+                unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+                i += 2;
+            }
+        }
+        append_utf8(&out, unit);
+    }
+    return trim_tag(out);
+}
+
+// ID3v2 文本帧：第一个字节是编码（0 ISO-8859-1，1 带 BOM 的 UTF-16，2 UTF-16BE，3 UTF-8）
+std::string id3_text(const unsigned char* p, size_t size) {
+    if (size < 2) {
+        return "";
+    }
+    switch (p[0]) {
+    case 0:
+        return latin1_to_utf8(p + 1, size - 1);
+    case 1:
+        if (size >= 3 && p[1] == 0xFE && p[2] == 0xFF) {
+            return utf16_to_utf8(p + 3, size - 3, true);
+        }
+        if (size >= 3 && p[1] == 0xFF && p[2] == 0xFE) {
+            return utf16_to_utf8(p + 3, size - 3, false);
+        }
+        return utf16_to_utf8(p + 1, size - 1, false);
+    case 2:
+        return utf16_to_utf8(p + 1, size - 1, true);
+    default:
+        return trim_tag(std::string((const char*)p + 1, size - 1));
+    }
+}
+
+// 读取 ID3v2 标签中的标题、艺术家和专辑（v2.2 / v2.3 / v2.4）。
+// 逐帧读取帧头，封面等大帧直接跳过，不把整个标签读入内存
+void read_id3v2_tags(std::istream& in, const unsigned char* header, uint64_t tag_size, AudioTags* tags) {
+    int major = header[3];
+    int flags = header[5];
+    if (major < 2 || major > 4 || (flags & 0x80)) {
+        return;  // 不认识的版本；整个标签做过反同步处理的（很少见）也不解析
+    }
+
+    uint64_t pos = 10;
+    uint64_t end = tag_size - ((flags & 0x10) ? 10 : 0);
+    unsigned char frame[10];
+    in.clear();
+    if ((flags & 0x40) && major >= 3) {
+        // 扩展头：v2.3 的长度不含自身的 4 字节，v2.4 的长度是同步安全整数且包含自身
+        in.seekg(10);
+        if (!in.read((char*)frame, 4)) {
+            return;
+        }
+        pos += major == 3 ? 4 + be32(frame)
+                          : ((uint64_t)(frame[0] & 0x7F) << 21) | ((frame[1] & 0x7F) << 14) |
+                                ((frame[2] & 0x7F) << 7) | (frame[3] & 0x7F);
+    }
+
+    size_t header_size = major == 2 ? 6 : 10;
+    while (pos + header_size <= end && (tags->title.empty() || tags->artist.empty() || tags->album.empty())) {
+        in.seekg((std::streamoff)pos);
+        if (!in.read((char*)frame, (std::streamsize)header_size) || frame[0] == 0) {
+            break;  // 读到填充区
+        }
+
+        std::string id;
+        uint64_t size;
+        if (major == 2) {
+            id.assign((const char*)frame, 3);
+            size = ((uint64_t)frame[3] << 16) | (frame[4] << 8) | frame[5];
+        } else {
+            id.assign((const char*)frame, 4);
+            size = major == 3 ? be32(frame + 4)
+                              : ((uint64_t)(frame[4] & 0x7F) << 21) | ((frame[5] & 0x7F) << 14) |
+                                    ((frame[6] & 0x7F) << 7) | (frame[7] & 0x7F);
+        }
+        pos += header_size;
+        if (size > end - pos) {
+            break;
+        }
+
+        std::string* field = nullptr;
+        if (id == "TIT2" || id == "TT2") {
+            field = &tags->title;
+        } else if (id == "TPE1" || id == "TP1") {
+            field = &tags->artist;
+        } else if (id == "TALB" || id == "TAL") {
+            field = &tags->album;
+        }
+        if (field != nullptr && field->empty() && size <= MAX_TAG_FIELD_BYTES) {
+            unsigned char body[MAX_TAG_FIELD_BYTES];
+            if (!in.read((char*)body, (std::streamsize)size)) {
+                break;
+            }
+            *field = id3_text(body, (size_t)size);
+        }
+        pos += size;
+    }
+}
+
+// ID3v1 标签：文件末尾 128 字节，定长的 ISO-8859-1 字段
+void read_id3v1_tags(const unsigned char* tag, AudioTags* tags) {
+    if (tags->title.empty()) {
+        tags->title = latin1_to_utf8(tag + 3, 30);
+    }
+    if (tags->artist.empty()) {
+        tags->artist = latin1_to_utf8(tag + 33, 30);
+    }
+    if (tags->album.empty()) {
+        tags->album = latin1_to_utf8(tag + 63, 30);
+    }
+}
+
+// 按不区分大小写的键名把 Vorbis comment / RIFF INFO 字段写入标签
+void set_tag(AudioTags* tags, const std::string& key, const std::string& value) {
+    std::string upper;
+    for (char c : key) {
+        upper.push_back((char)toupper((unsigned char)c));
+    }
+    if ((upper == "TITLE" || upper == "INAM") && tags->title.empty()) {
+        tags->title = trim_tag(value);
+    } else if ((upper == "ARTIST" || upper == "IART") && tags->artist.empty()) {
+        tags->artist = trim_tag(value);
+    } else if ((upper == "ALBUM" || upper == "IPRD") && tags->album.empty()) {
+        tags->album = trim_tag(value);
+    }
+}
+
+// MP3：第一帧中的 Xing/Info 头（LAME 写入）或 VBRI 头（Fraunhofer 写入）记录了总帧数，
+// 编码延迟和填充的扣除方式与 dr_mp3 一致，结果等于解码器实际输出的帧数。
+// 都没有时按开头几帧的平均码率和音频数据大小估算，CBR 文件基本准确，VBR 文件可能有偏差。
+// data 从 ID3v2 标签之后开始，info->audio_bytes 为标签之后的数据总长度（不含 ID3v1 标签）
+bool mp3_info(const unsigned char* data, size_t size, HeaderInfo* info) {
+    size_t offset;
+    Mp3FrameHeader header;
+    if (!find_mp3_frame(data, size, &offset) || !parse_mp3_header(data + offset, &header)) {
+        return false;
+    }
+    DurationEstimate* duration = &info->duration;
+    duration->sample_rate = (uint32_t)header.sample_rate;
+    info->channels = header.mono ? 1 : 2;
+    info->audio_bytes = info->audio_bytes > offset ? info->audio_bytes - offset : 0;
+
+    const unsigned char* frame = data + offset;
+    size_t frame_size = std::min(header.length, size - offset);
+    if (header.layer == 3) {
+        size_t side_info = header.mpeg1 ? (header.mono ? 17 : 32) : (header.mono ? 9 : 17);
+        size_t tag = 4 + (header.crc ? 2 : 0) + side_info;
+        if (tag + 8 <= frame_size && (memcmp(frame + tag, "Xing", 4) == 0 || memcmp(frame + tag, "Info", 4) == 0)) {
+            const unsigned char* p = frame + tag;
+            const unsigned char* end = frame + frame_size;
+            uint32_t flags = p[7];
+            p += 8;
+            if ((flags & 0x01) && p + 4 <= end) {
+                uint64_t total = (uint64_t)be32(p) * header.samples;
+                p += 4;
+                p += (flags & 0x02) ? 4 : 0;
+                p += (flags & 0x04) ? 100 : 0;
+                p += (flags & 0x08) ? 4 : 0;
+
+                // LAME 扩展头中的编码延迟和末尾填充
+                if (p + 24 <= end && p[0] != 0) {
+                    const unsigned char* gap = p + 21;
+                    uint64_t delay = (((uint32_t)gap[0] << 4) | (gap[1] >> 4)) + 529;
+                    int padding = (int)((((uint32_t)gap[1] & 0xF) << 8) | gap[2]) - 529;
+                    total = total > delay ? total - delay : 0;
+                    if (padding > 0) {
+                        total = total > (uint64_t)padding ? total - padding : 0;
+                    }
+                }
+                duration->frames = total;
+                duration->exact = true;
+                return true;
+            }
+        }
+        // VBRI 头固定在帧头之后 32 字节处；dr_mp3 不识别它，把所在的帧当作普通帧解码，所以计入一帧
+        if (4 + 32 + 18 <= frame_size && memcmp(frame + 36, "VBRI", 4) == 0) {
+            duration->frames = ((uint64_t)be32(frame + 36 + 14) + 1) * header.samples;
+            duration->exact = true;
+            return true;
+        }
+    }
+
+    // 用已读入的几个连续帧的平均码率，比只看第一帧更接近 VBR 文件的实际码率
+    uint64_t sampled_bytes = 0, sampled_frames = 0;
+    Mp3FrameHeader next;
+    for (size_t pos = offset; pos + 4 <= size && parse_mp3_header(data + pos, &next) && pos + next.length <= size;
+         pos += next.length) {
+        sampled_bytes += next.length;
+        sampled_frames += next.samples;
+    }
+    if (sampled_bytes > 0) {
+        duration->frames = info->audio_bytes * sampled_frames / sampled_bytes;
+    } else {
+        duration->frames = info->audio_bytes * 8 * (uint64_t)header.sample_rate / (uint64_t)header.bitrate;
+    }
+    duration->exact = false;
+    return true;
+}
+
+// FLAC：按块遍历元数据，STREAMINFO 给出采样率、声道数和总采样数（为 0 表示编码器未写入），
+// VORBIS_COMMENT 给出标签。封面（PICTURE）等其他块直接跳过
+bool flac_info(std::istream& in, uint64_t start, uint64_t file_size, HeaderInfo* info) {
+    uint64_t offset = start + 4;
+    bool has_streaminfo = false;
+    for (int block = 0; block < 128; ++block) {
+        unsigned char header[4];
+        in.clear();
+        in.seekg((std::streamoff)offset);
+        if (!in.read((char*)header, sizeof(header))) {
+            break;
+        }
+        bool last = (header[0] & 0x80) != 0;
+        int type = header[0] & 0x7F;
+        uint32_t size = ((uint32_t)header[1] << 16) | (header[2] << 8) | header[3];
+        offset += 4 + size;
+
+        if (type == 0 && size >= 34) {
+            unsigned char streaminfo[34];
+            if (!in.read((char*)streaminfo, sizeof(streaminfo))) {
+                break;
+            }
+            uint32_t sample_rate = ((uint32_t)streaminfo[10] << 12) | ((uint32_t)streaminfo[11] << 4) |
+                                   (streaminfo[12] >> 4);
+            uint64_t total = ((uint64_t)(streaminfo[13] & 0x0F) << 32) | be32(streaminfo + 14);
+            info->channels = ((streaminfo[12] >> 1) & 7) + 1;
+            info->duration.sample_rate = sample_rate;
+            info->duration.frames = total;
+            info->duration.exact = true;
+            has_streaminfo = sample_rate > 0 && total > 0;
+        } else if (type == 4 && size >= 8 && size <= 65536) {
+            std::vector<unsigned char> body(size);
+            if (!in.read((char*)body.data(), size)) {
+                break;
+            }
+            // 小端的长度前缀：厂商字符串，然后是 "KEY=value" 列表
+            uint64_t pos = 4 + (uint64_t)le32(body.data());
+            uint32_t count = pos + 4 <= size ? le32(body.data() + pos) : 0;
+            pos += 4;
+            for (uint32_t i = 0; i < count && pos + 4 <= size; ++i) {
+                uint32_t length = le32(body.data() + pos);
+                pos += 4;
+                if (length > size - pos) {
+                    break;
+                }
+                std::string comment((const char*)body.data() + pos, length);
+                size_t eq = comment.find('=');
+                if (eq != std::string::npos) {
+                    set_tag(&info->tags, comment.substr(0, eq), comment.substr(eq + 1));
+                }
+                pos += length;
+            }
+        }
+        if (last) {
+            break;
+        }
+    }
+    info->audio_bytes = file_size > offset ? file_size - offset : 0;
+    return has_streaminfo;
+}
+
+// WAV：按块遍历，PCM / 浮点 / A-law / μ-law 用 data 块大小除以块对齐，
+// 压缩格式用 fact 块中的采样数，RF64 的实际大小记录在 ds64 块中。
+// LIST/INFO 块通常写在 data 块之后，所以找到 data 后继续向后查找
+bool wav_info(std::istream& in, uint64_t start, HeaderInfo* info) {
+    unsigned char riff[12];
+    in.clear();
+    in.seekg((std::streamoff)start);
+    if (!in.read((char*)riff, sizeof(riff)) || memcmp(riff + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+    bool rf64 = memcmp(riff, "RF64", 4) == 0;
+
+    uint64_t ds64_data_size = 0, fact_frames = 0, data_size = 0;
+    uint32_t format_tag = 0, sample_rate = 0, block_align = 0;
+    bool have_fmt = false, have_data = false;
+    uint64_t offset = start + sizeof(riff);
+    for (int chunk = 0; chunk < 64; ++chunk) {
+        unsigned char header[8];
+        in.clear();
+        in.seekg((std::streamoff)offset);
+        if (!in.read((char*)header, sizeof(header))) {
+            break;
+        }
+        uint64_t size = le32(header + 4);
+
+        if (memcmp(header, "data", 4) == 0) {
+            if (rf64 && size == 0xFFFFFFFF) {
+                size = ds64_data_size;
+            }
+            data_size = size;
+            have_data = true;
+        } else if (memcmp(header, "LIST", 4) == 0 && size >= 4 && size <= 65536) {
+            std::vector<unsigned char> body((size_t)size);
+            if (in.read((char*)body.data(), (std::streamsize)size) && memcmp(body.data(), "INFO", 4) == 0) {
+                for (size_t pos = 4; pos + 8 <= size;) {
+                    uint32_t length = le32(body.data() + pos + 4);
+                    if (length > size - pos - 8) {
+                        break;
+                    }
+                    set_tag(&info->tags, std::string((const char*)body.data() + pos, 4),
+                            std::string((const char*)body.data() + pos + 8, length));
+                    pos += 8 + length + (length & 1);
+                }
+            }
+        } else {
+            unsigned char body[40];
+            size_t body_size = (size_t)std::min<uint64_t>(size, sizeof(body));
+            if (body_size > 0 && !in.read((char*)body, (std::streamsize)body_size)) {
+                break;
+            }
+            if (memcmp(header, "fmt ", 4) == 0 && body_size >= 16) {
+                format_tag = le16(body);
+                info->channels = le16(body + 2);
+                sample_rate = le32(body + 4);
+                block_align = le16(body + 12);
+                if (format_tag == 0xFFFE && body_size >= 26) {
+                    format_tag = le16(body + 24);  // WAVE_FORMAT_EXTENSIBLE：子格式 GUID 的前两个字节
+                }
+                have_fmt = true;
+            } else if (memcmp(header, "fact", 4) == 0 && body_size >= 4) {
+                fact_frames = le32(body);
+            } else if (memcmp(header, "ds64", 4) == 0 && body_size >= 24) {
+                ds64_data_size = le64(body + 8);
+                fact_frames = le64(body + 16);
+            }
+        }
+        offset += 8 + size + (size & 1);  // 块按偶数字节对齐
+    }
+
+    if (!have_fmt || !have_data || sample_rate == 0) {
+        return false;
+    }
+    bool linear = format_tag == 1 || format_tag == 3 || format_tag == 6 || format_tag == 7;
+    if (linear && block_align > 0) {
+        info->duration.frames = data_size / block_align;
+    } else if (fact_frames > 0) {
+        info->duration.frames = fact_frames;
+    } else {
+        return false;
+    }
+    info->duration.sample_rate = sample_rate;
+    info->duration.exact = true;
+    info->audio_bytes = data_size;
+    return true;
+}
+
+// 按魔数识别格式
+AudioFormat sniff_format(const unsigned char* data, size_t size) {
+    if (size >= 12 && (memcmp(data, "RIFF", 4) == 0 || memcmp(data, "RF64", 4) == 0) &&
+        memcmp(data + 8, "WAVE", 4) == 0) {
+        return AudioFormat::Wav;
+    }
+    if (size >= 16 && memcmp(data, "riff\x2E\x91\xCF\x11", 8) == 0) {
+        return AudioFormat::Wav;  // Sony Wave64
+    }
+    if (size >= 4 && memcmp(data, "fLaC", 4) == 0) {
+        return AudioFormat::Flac;
+    }
+    if (size >= 4 && memcmp(data, "OggS", 4) == 0) {
+        return AudioFormat::Ogg;
+    }
+    if (size >= 8 && memcmp(data + 4, "ftyp", 4) == 0) {
+        return AudioFormat::M4a;
+    }
+    if (size >= 2 && data[0] == 0xFF && (data[1] & 0xF6) == 0xF0) {
+        return AudioFormat::Aac;  // ADTS：同步字后 layer 固定为 0
+    }
+    if (find_mp3_sync(data, size)) {
+        return AudioFormat::Mp3;
+    }
+    return AudioFormat::Unknown;
+}
+
+// FNV-1a，用于由目录路径生成索引文件名
+uint64_t fnv1a(const std::string& text) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+#ifdef _WIN32
+int64_t filetime_to_ns(const FILETIME& ft) {
+    uint64_t ticks = ((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+    return (int64_t)(ticks * 100);  // FILETIME 单位为 100ns
+}
+#else
+int64_t stat_mtime_ns(const struct stat& info) {
+#if defined(__APPLE__)
+    return (int64_t)info.st_mtimespec.tv_sec * 1000000000LL + info.st_mtimespec.tv_nsec;
+#else
+    return (int64_t)info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+#endif
+}
+#endif
+
+// 获取目录的修改时间，目录不存在时返回 false
+bool directory_mtime(const std::string& path, int64_t* mtime) {
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data) ||
+        !(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+        return false;
+    }
+    *mtime = filetime_to_ns(data.ftLastWriteTime);
+    return true;
+#else
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0 || !S_ISDIR(info.st_mode)) {
+        return false;
+    }
+    *mtime = stat_mtime_ns(info);
+    return true;
+#endif
+}
+
+void write_u8(std::ostream& out, uint8_t v) { out.write((const char*)&v, sizeof(v)); }
+void write_u32(std::ostream& out, uint32_t v) { out.write((const char*)&v, sizeof(v)); }
+void write_u64(std::ostream& out, uint64_t v) { out.write((const char*)&v, sizeof(v)); }
+void write_f32(std::ostream& out, float v) { out.write((const char*)&v, sizeof(v)); }
+void write_string(std::ostream& out, const std::string& s) {
+    write_u32(out, (uint32_t)s.size());
+    out.write(s.data(), (std::streamsize)s.size());
+}
+
+bool read_u8(std::istream& in, uint8_t* v) { return (bool)in.read((char*)v, sizeof(*v)); }
+bool read_u32(std::istream& in, uint32_t* v) { return (bool)in.read((char*)v, sizeof(*v)); }
+bool read_u64(std::istream& in, uint64_t* v) { return (bool)in.read((char*)v, sizeof(*v)); }
+bool read_f32(std::istream& in, float* v) { return (bool)in.read((char*)v, sizeof(*v)); }
+// 从当前位置到文件末尾的字节数
+uint64_t bytes_left(std::istream& in) {
+    std::streampos position = in.tellg();
+    in.seekg(0, std::ios::end);
+    std::streampos end = in.tellg();
+    in.seekg(position);
+    return position >= 0 && end > position ? (uint64_t)(end - position) : 0;
+}
+
+bool read_string(std::istream& in, std::string* s) {
+    uint32_t size;
+    if (!read_u32(in, &size) || size > 65536) {
+        return false;
+    }
+    s->resize(size);
+    return size == 0 || (bool)in.read(&(*s)[0], size);
+}
+
+// 读取文件头识别格式，info 不为空时顺带读出时长、声道数和标签（同一次打开）
+AudioFormat probe_file(const std::string& path, HeaderInfo* info) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        return AudioFormat::Unknown;
+    }
+
+    unsigned char header[PROBE_BYTES];
+    in.read((char*)header, sizeof(header));
+    size_t size = (size_t)in.gcount();
+
+    // ID3v2 标签可能很大（内嵌封面），跳到标签之后再读一次
+    uint64_t tag_size = 0;
+    if (size >= 10 && memcmp(header, "ID3", 3) == 0) {
+        tag_size = ((uint64_t)(header[6] & 0x7F) << 21) | ((header[7] & 0x7F) << 14) |
+                   ((header[8] & 0x7F) << 7) | (header[9] & 0x7F);
+        tag_size += (header[5] & 0x10) ? 20 : 10;  // 头部，以及可选的尾部
+        if (info != nullptr) {
+            read_id3v2_tags(in, header, tag_size, &info->tags);
+        }
+        in.clear();
+        in.seekg((std::streamoff)tag_size);
+        in.read((char*)header, sizeof(header));
+        size = (size_t)in.gcount();
+    }
+
+    AudioFormat format = sniff_format(header, size);
+    if (info == nullptr) {
+        return format;
+    }
+
+    in.clear();
+    in.seekg(0, std::ios::end);
+    uint64_t file_size = (uint64_t)in.tellg();
+    if (format == AudioFormat::Wav) {
+        info->has_duration = wav_info(in, tag_size, info);
+    } else if (format == AudioFormat::Flac) {
+        info->has_duration = flac_info(in, tag_size, file_size, info);
+    } else if (format == AudioFormat::Mp3) {
+        // 音频数据到文件末尾为止，扣除末尾 128 字节的 ID3v1 标签
+        info->audio_bytes = file_size > tag_size ? file_size - tag_size : 0;
+        unsigned char trailer[128];
+        if (file_size >= 128 && in.seekg(-128, std::ios::end) && in.read((char*)trailer, sizeof(trailer)) &&
+            memcmp(trailer, "TAG", 3) == 0) {
+            info->audio_bytes = info->audio_bytes > 128 ? info->audio_bytes - 128 : 0;
+            read_id3v1_tags(trailer, &info->tags);
+        }
+        info->has_duration = mp3_info(header, size, info);
+    }
+    return format;
+}
+
+} // namespace
+
+AudioFormat probe_audio_format(const std::string& path) {
+    return probe_file(path, nullptr);
+}
+
+bool probe_duration(const std::string& path, DurationEstimate* duration) {
+    HeaderInfo info;
+    probe_file(path, &info);
+    *duration = info.duration;
+    return info.has_duration;
+}
+
+bool count_duration(const std::string& path, const std::atomic<bool>& abort, DurationEstimate* duration) {
+    AbortableVfs vfs(&abort);
+    ma_decoder_config config = ma_decoder_config_init_default();
+    ma_decoder decoder;
+    if (ma_decoder_init_vfs(vfs.vfs(), path.c_str(), &config, &decoder) != MA_SUCCESS) {
+        return false;
+    }
+
+    // 中止时读取返回错误，解码器把它当作文件结束，得到的是不完整的计数
+    ma_uint64 frames = 0;
+    ma_result result = ma_decoder_get_length_in_pcm_frames(&decoder, &frames);
+    ma_uint32 sample_rate = decoder.outputSampleRate;
+    ma_decoder_uninit(&decoder);
+    if (result != MA_SUCCESS || abort.load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    duration->frames = frames;
+    duration->sample_rate = sample_rate;
+    duration->exact = true;
+    return true;
+}
+
+bool file_signature(const std::string& path, uint64_t* size, int64_t* mtime) {
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data) ||
+        (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+        return false;
+    }
+    *size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    *mtime = filetime_to_ns(data.ftLastWriteTime);
+    return true;
+#else
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+        return false;
+    }
+    *size = (uint64_t)info.st_size;
+    *mtime = stat_mtime_ns(info);
+    return true;
+#endif
+}
+
+LibraryIndex::LibraryIndex(const std::string& root, bool recursive)
+    : root_(root), recursive_(recursive) {
+}
+
+std::string LibraryIndex::indexFileFor(const std::string& root) {
+    char name[64];
+    snprintf(name, sizeof(name), "caudio_index_%016llx.bin", (unsigned long long)fnv1a(root));
+    return name;
+}
+
+void LibraryIndex::removeIndexFile(const std::string& root) {
+    std::remove(indexFileFor(root).c_str());
+}
+
+bool LibraryIndex::load() {
+    directories_.clear();
+    entries_.clear();
+
+    std::ifstream in(indexFileFor(root_), std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+
+    uint32_t magic, version, dir_count, file_count;
+    uint8_t recursive;
+    std::string root;
+    if (!read_u32(in, &magic) || magic != INDEX_MAGIC ||
+        !read_u32(in, &version) || version != INDEX_VERSION ||
+        !read_string(in, &root) || root != root_ ||
+        !read_u8(in, &recursive) || (recursive != 0) != recursive_ ||
+        !read_u32(in, &dir_count) || dir_count > bytes_left(in) / INDEX_DIRECTORY_MIN_BYTES) {
+        return false;
+    }
+
+    std::vector<IndexedDirectory> directories(dir_count);
+    for (auto& dir : directories) {
+        uint64_t mtime;
+        if (!read_string(in, &dir.path) || !read_u64(in, &mtime)) {
+            return false;
+        }
+        dir.mtime = (int64_t)mtime;
+    }
+
+    if (!read_u32(in, &file_count) || file_count > bytes_left(in) / INDEX_ENTRY_MIN_BYTES) {
+        return false;
+    }
+
+    std::vector<LibraryEntry> entries(file_count);
+    for (auto& entry : entries) {
+        uint64_t mtime;
+        uint8_t exact, format, detected, probe;
+        if (!read_string(in, &entry.path) || !read_u64(in, &entry.size) ||
+            !read_u64(in, &mtime) || !read_u64(in, &entry.duration_ms) || !read_u8(in, &exact) ||
+            !read_u8(in, &format) || !read_u8(in, &detected) || !read_u8(in, &probe)) {
+            return false;
+        }
+        uint32_t channels;
+        if (!read_u32(in, &entry.sample_rate) || !read_u32(in, &channels) || !read_u64(in, &entry.audio_bytes) ||
+            !read_string(in, &entry.tags.title) || !read_string(in, &entry.tags.artist) ||
+            !read_string(in, &entry.tags.album)) {
+            return false;
+        }
+        uint8_t analyzed;
+        LoudnessInfo& loudness = entry.loudness;
+        if (!read_u8(in, &analyzed) || !read_f32(in, &loudness.track_lufs) || !read_f32(in, &loudness.track_peak) ||
+            !read_f32(in, &loudness.album_lufs) || !read_f32(in, &loudness.album_peak)) {
+            return false;
+        }
+        loudness.analyzed = analyzed != 0;
+        entry.channels = channels;
+        entry.mtime = (int64_t)mtime;
+        entry.duration_exact = exact == 1;
+        entry.duration_unmeasurable = exact == 2;
+        entry.format = (AudioFormat)format;
+        entry.detected = (AudioFormat)detected;
+        entry.probe = (ProbeStatus)probe;
+    }
+
+    directories_.swap(directories);
+    entries_.swap(entries);
+    return true;
+}
+
+bool LibraryIndex::save() const {
+    // 先写临时文件再改名，避免中途退出留下损坏的索引
+    std::string path = indexFileFor(root_);
+    std::string temp = path + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            return false;
+        }
+
+        write_u32(out, INDEX_MAGIC);
+        write_u32(out, INDEX_VERSION);
+        write_string(out, root_);
+        write_u8(out, recursive_ ? 1 : 0);
+
+        write_u32(out, (uint32_t)directories_.size());
+        for (const auto& dir : directories_) {
+            write_string(out, dir.path);
+            write_u64(out, (uint64_t)dir.mtime);
+        }
+
+        write_u32(out, (uint32_t)entries_.size());
+        for (const auto& entry : entries_) {
+            write_string(out, entry.path);
+            write_u64(out, entry.size);
+            write_u64(out, (uint64_t)entry.mtime);
+            write_u64(out, entry.duration_ms);
+            write_u8(out, entry.duration_exact ? 1 : entry.duration_unmeasurable ? 2 : 0);  // 2：完整扫描失败
+            write_u8(out, (uint8_t)entry.format);
+            write_u8(out, (uint8_t)entry.detected);
+            write_u8(out, (uint8_t)entry.probe);
+            write_u32(out, entry.sample_rate);
+            write_u32(out, entry.channels);
+            write_u64(out, entry.audio_bytes);
+            write_string(out, entry.tags.title);
+            write_string(out, entry.tags.artist);
+            write_string(out, entry.tags.album);
+            write_u8(out, entry.loudness.analyzed ? 1 : 0);
+            write_f32(out, entry.loudness.track_lufs);
+            write_f32(out, entry.loudness.track_peak);
+            write_f32(out, entry.loudness.album_lufs);
+            write_f32(out, entry.loudness.album_peak);
+        }
+
+        if (!out.good()) {
+            return false;
+        }
+    }
+
+#ifdef _WIN32
+    std::remove(path.c_str());  // Windows 下 rename 不会覆盖已有文件
+#endif
+    return std::rename(temp.c_str(), path.c_str()) == 0;
+}
+
+namespace {
+
+// 列出目录的直接子项：音频文件追加到 files，子目录追加到 subdirs
+bool list_directory(const std::string& dir, std::vector<LibraryEntry>* files,
+                    std::vector<std::string>* subdirs) {
+#ifdef _WIN32
+    std::string pattern = dir + "\\*";
+    WIN32_FIND_DATAA findData;
+    HANDLE hFind = FindFirstFileA(pattern.c_str(), &findData);
+    if (hFind == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    do {
+        std::string filename = findData.cFileName;
+        if (filename == "." || filename == "..") {
+            continue;
+        }
+
+        if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            // 不进入目录联接/符号链接，避免循环
+            if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)) {
+                subdirs->push_back(dir + "\\" + filename);
+            }
+            continue;
+        }
+
+        AudioFormat format = audio_format_from_name(filename);
+        if (format != AudioFormat::Unknown) {
+            LibraryEntry entry;
+            entry.path = dir + "\\" + filename;
+            entry.size = ((uint64_t)findData.nFileSizeHigh << 32) | findData.nFileSizeLow;
+            entry.mtime = filetime_to_ns(findData.ftLastWriteTime);
+            entry.format = format;
+            files->push_back(entry);
+        }
+    } while (FindNextFileA(hFind, &findData));
+    FindClose(hFind);
+#else
+    DIR* dp = opendir(dir.c_str());
+    if (dp == nullptr) {
+        return false;
+    }
+    int dir_fd = dirfd(dp);
+
+    struct dirent* item;
+    while ((item = readdir(dp)) != nullptr) {
+        const char* name = item->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+            continue;
+        }
+
+        // 文件系统提供 d_type 时，子目录和非音频文件都不需要 stat
+        unsigned char type = item->d_type;
+        if (type == DT_DIR) {
+            subdirs->push_back(dir + "/" + name);
+            continue;
+        }
+
+        AudioFormat format = audio_format_from_name(name);
+        if (format == AudioFormat::Unknown && type != DT_UNKNOWN) {
+            continue;
+        }
+
+        // 音频文件需要大小和修改时间；相对目录句柄 stat，省去完整路径解析
+        struct stat info;
+        if (fstatat(dir_fd, name, &info, 0) != 0) {
+            continue;
+        }
+        if (S_ISDIR(info.st_mode)) {
+            // d_type 未知时才会走到这里；符号链接指向的目录不进入，避免循环
+            struct stat link_info;
+            if (fstatat(dir_fd, name, &link_info, AT_SYMLINK_NOFOLLOW) == 0 && !S_ISLNK(link_info.st_mode)) {
+                subdirs->push_back(dir + "/" + name);
+            }
+            continue;
+        }
+        if (format == AudioFormat::Unknown || !S_ISREG(info.st_mode)) {
+            continue;
+        }
+
+        LibraryEntry entry;
+        entry.path = dir + "/" + name;
+        entry.size = (uint64_t)info.st_size;
+        entry.mtime = stat_mtime_ns(info);
+        entry.format = format;
+        files->push_back(entry);
+    }
+    closedir(dp);
+#endif
+    return true;
+}
+
+std::string parent_directory(const std::string& path) {
+    size_t pos = path.find_last_of(PATH_SEPARATOR);
+    return pos == std::string::npos ? std::string() : path.substr(0, pos);
+}
+
+// 扫描线程共享的结果：每扫完一个目录就汇入，进度随之更新
+struct ScanResults {
+    std::mutex mutex;
+    std::vector<LibraryEntry> entries;
+    std::vector<IndexedDirectory> directories;
+    std::atomic<size_t> rescanned{0};
+    const ScanProgress* progress = nullptr;
+};
+
+// 扫描一个目录；递归模式下为未被索引过的子目录提交新任务
+void scan_task(WorkStealingPool& pool, size_t worker, const std::string& dir, bool recursive,
+               const std::unordered_set<std::string>* known, ScanResults* results) {
+    // 先取 mtime 再列目录：列目录期间发生的变化会在下次刷新时被发现
+    int64_t mtime = 0;
+    if (!directory_mtime(dir, &mtime)) {
+        return;
+    }
+
+    std::vector<LibraryEntry> files;
+    std::vector<std::string> subdirs;
+    list_directory(dir, &files, &subdirs);
+    results->rescanned.fetch_add(1, std::memory_order_relaxed);
+
+    {
+        std::lock_guard<std::mutex> lock(results->mutex);
+        results->directories.push_back(IndexedDirectory{dir, mtime});
+        results->entries.insert(results->entries.end(),
+                                std::make_move_iterator(files.begin()), std::make_move_iterator(files.end()));
+        if (results->progress != nullptr && *results->progress) {
+            (*results->progress)(results->entries.size());
+        }
+    }
+
+    if (!recursive) {
+        return;
+    }
+    for (auto& subdir : subdirs) {
+        // 已索引的子目录由校验阶段单独处理
+        if (known->count(subdir) == 0) {
+            pool.spawn(worker, [subdir, recursive, known, results](WorkStealingPool& p, size_t w) {
+                scan_task(p, w, subdir, recursive, known, results);
+            });
+        }
+    }
+}
+
+} // namespace
+
+IndexRefreshStats LibraryIndex::refresh(const ScanProgress& progress) {
+    IndexRefreshStats stats;
+
+    int64_t root_mtime = 0;
+    if (!directory_mtime(root_, &root_mtime)) {
+        // 目录已不存在
+        stats.changed = !entries_.empty() || !directories_.empty();
+        entries_.clear();
+        directories_.clear();
+        return stats;
+    }
+
+    // 校验阶段：并行检查所有已索引目录的修改时间
+    std::vector<int> status(directories_.size(), 0);  // 0 未变化，1 已变化，2 已删除
+    std::unordered_set<std::string> known;
+    for (const auto& dir : directories_) {
+        known.insert(dir.path);
+    }
+
+    size_t threads = directories_.size() > 1 ? scan_threads() : 1;
+    if (!directories_.empty()) {
+        WorkStealingPool pool(threads);
+        const size_t chunk = 64;
+        for (size_t begin = 0; begin < directories_.size(); begin += chunk) {
+            pool.spawn(begin / chunk, [this, &status, begin, chunk](WorkStealingPool&, size_t) {
+                size_t end = std::min(directories_.size(), begin + chunk);
+                for (size_t i = begin; i < end; ++i) {
+                    int64_t mtime = 0;
+                    if (!directory_mtime(directories_[i].path, &mtime)) {
+                        status[i] = 2;
+                    } else if (mtime != directories_[i].mtime) {
+                        status[i] = 1;
+                    }
+                }
+            });
+        }
+        pool.run();
+    }
+    stats.directories_checked = directories_.size();
+
+    // 扫描阶段：重新扫描变化的目录，首次刷新时从根目录开始
+    std::vector<std::string> to_scan;
+    std::unordered_set<std::string> unchanged;
+    for (size_t i = 0; i < directories_.size(); ++i) {
+        if (status[i] == 0) {
+            unchanged.insert(directories_[i].path);
+        } else if (status[i] == 1) {
+            to_scan.push_back(directories_[i].path);
+        }
+    }
+    if (directories_.empty()) {
+        to_scan.push_back(root_);
+    }
+
+    // 文件校验：原地改写的文件（重新编码、改标签）不改变目录的修改时间，
+    // 未变化目录中的条目逐个按 (大小, 修改时间) 校验，变化的重新探测，消失的移除
+    std::vector<char> file_status(entries_.size(), 0);  // 0 未变化，1 已变化，2 已删除
+    {
+        std::vector<size_t> to_check;
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            if (unchanged.count(parent_directory(entries_[i].path)) > 0) {
+                to_check.push_back(i);
+            }
+        }
+        WorkStealingPool pool(to_check.size() > 1 ? scan_threads() : 1);
+        const size_t chunk = 64;
+        for (size_t begin = 0; begin < to_check.size(); begin += chunk) {
+            pool.spawn(begin / chunk, [this, &to_check, &file_status, begin, chunk](WorkStealingPool&, size_t) {
+                size_t end = std::min(to_check.size(), begin + chunk);
+                for (size_t i = begin; i < end; ++i) {
+                    LibraryEntry& entry = entries_[to_check[i]];
+                    uint64_t size = 0;
+                    int64_t mtime = 0;
+                    if (!file_signature(entry.path, &size, &mtime)) {
+                        file_status[to_check[i]] = 2;
+                    } else if (size != entry.size || mtime != entry.mtime) {
+                        LibraryEntry fresh;
+                        fresh.path = std::move(entry.path);
+                        fresh.size = size;
+                        fresh.mtime = mtime;
+                        fresh.format = entry.format;
+                        entry = std::move(fresh);
+                        file_status[to_check[i]] = 1;
+                    }
+                }
+            });
+        }
+        pool.run();
+    }
+    bool files_changed = std::any_of(file_status.begin(), file_status.end(), [](char s) { return s != 0; });
+    if (std::find(file_status.begin(), file_status.end(), 2) != file_status.end()) {
+        size_t kept = 0;
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            if (file_status[i] != 2) {
+                entries_[kept++] = std::move(entries_[i]);
+            }
+        }
+        entries_.resize(kept);
+    }
+
+    bool removed = std::find(status.begin(), status.end(), 2) != status.end();
+    if (to_scan.empty() && !removed) {
+        stats.files = entries_.size();
+        stats.changed = files_changed;
+        return stats;
+    }
+
+    ScanResults results;
+    results.progress = &progress;
+
+    // 未变化目录的条目直接沿用
+    for (auto& entry : entries_) {
+        if (unchanged.count(parent_directory(entry.path)) > 0) {
+            results.entries.push_back(entry);
+        }
+    }
+    for (size_t i = 0; i < directories_.size(); ++i) {
+        if (status[i] == 0) {
+            results.directories.push_back(directories_[i]);
+        }
+    }
+
+    threads = (recursive_ || to_scan.size() > 1) ? scan_threads() : 1;
+    {
+        WorkStealingPool pool(threads);
+        for (size_t i = 0; i < to_scan.size(); ++i) {
+            std::string dir = to_scan[i];
+            bool recursive = recursive_;
+            pool.spawn(i, [dir, recursive, &known, &results](WorkStealingPool& p, size_t w) {
+                scan_task(p, w, dir, recursive, &known, &results);
+            });
+        }
+        pool.run();
+    }
+
+    std::sort(results.entries.begin(), results.entries.end(), [](const LibraryEntry& a, const LibraryEntry& b) {
+        return a.path < b.path;
+    });
+    std::sort(results.directories.begin(), results.directories.end(),
+              [](const IndexedDirectory& a, const IndexedDirectory& b) { return a.path < b.path; });
+
+    // 重新扫描到的未变化文件沿用已探测到的信息（格式、时长、标签等）
+    std::unordered_map<std::string, const LibraryEntry*> previous;
+    for (const auto& entry : entries_) {
+        previous[entry.path] = &entry;
+    }
+    for (auto& entry : results.entries) {
+        auto it = previous.find(entry.path);
+        if (it != previous.end() && it->second->size == entry.size && it->second->mtime == entry.mtime) {
+            entry = *it->second;
+        }
+    }
+
+    directories_.swap(results.directories);
+    entries_.swap(results.entries);
+
+    stats.directories_rescanned = results.rescanned.load();
+    stats.files = entries_.size();
+    stats.threads = threads;
+    stats.changed = true;
+    return stats;
+}
+
+size_t LibraryIndex::probe() {
+    std::vector<size_t> pending;
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        if (entries_[i].probe == ProbeStatus::Unprobed) {
+            pending.push_back(i);
+        }
+    }
+    if (pending.empty()) {
+        return 0;
+    }
+
+    // 每个文件只读文件头，耗时主要在打开文件的延迟上，与目录扫描一样并行
+    WorkStealingPool pool(pending.size() > 1 ? scan_threads() : 1);
+    const size_t chunk = 32;
+    for (size_t begin = 0; begin < pending.size(); begin += chunk) {
+        pool.spawn(begin / chunk, [this, &pending, begin, chunk](WorkStealingPool&, size_t) {
+            size_t end = std::min(pending.size(), begin + chunk);
+            for (size_t i = begin; i < end; ++i) {
+                LibraryEntry& entry = entries_[pending[i]];
+                HeaderInfo info;
+                entry.detected = probe_file(entry.path, &info);
+                entry.probe = audio_format_decodable(entry.detected) ? ProbeStatus::Decodable
+                                                                     : ProbeStatus::Undecodable;
+                entry.duration_ms = info.has_duration ? info.duration.milliseconds() : 0;
+                entry.duration_exact = info.has_duration && info.duration.exact;
+                entry.duration_unmeasurable = false;
+                entry.sample_rate = info.duration.sample_rate;
+                entry.channels = info.channels;
+                entry.audio_bytes = info.audio_bytes;
+                entry.tags = std::move(info.tags);
+            }
+        });
+    }
+    pool.run();
+    return pending.size();
+}
+
+size_t LibraryIndex::measure(const std::atomic<bool>& abort) {
+    std::vector<size_t> pending;
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        if (entries_[i].decodable() && !entries_[i].duration_exact && !entries_[i].duration_unmeasurable) {
+            pending.push_back(i);
+        }
+    }
+    if (pending.empty()) {
+        return 0;
+    }
+
+    // 每个文件都要完整读一遍，以顺序读取和帧头解析为主，线程数不超过硬件线程数
+    std::atomic<size_t> measured{0};
+    WorkStealingPool pool(std::min(pending.size(), hardware_threads()));
+    for (size_t i = 0; i < pending.size(); ++i) {
+        pool.spawn(i, [this, &pending, &abort, &measured, i](WorkStealingPool&, size_t) {
+            LibraryEntry& entry = entries_[pending[i]];
+            DurationEstimate duration;
+            if (count_duration(entry.path, abort, &duration)) {
+                entry.duration_ms = duration.milliseconds();
+                entry.duration_exact = true;
+                measured.fetch_add(1, std::memory_order_relaxed);
+            } else if (!abort.load(std::memory_order_relaxed)) {
+                entry.duration_unmeasurable = true;  // 无法完整扫描（文件损坏），保留估算值，不再重试
+            }
+        });
+    }
+    pool.run();
+    return measured.load();
+}
+
+AnalyzeStats LibraryIndex::analyze(size_t threads, bool force, const AnalyzeProgress& progress) {
+    AnalyzeStats stats;
+
+    // 专辑：同一目录下专辑标签相同的曲目
+    std::map<std::string, size_t> album_ids;
+    std::vector<size_t> album_of(entries_.size(), SIZE_MAX);
+    std::vector<bool> album_pending;
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        const LibraryEntry& entry = entries_[i];
+        if (!entry.decodable()) {
+            continue;
+        }
+        std::string key = parent_directory(entry.path) + '\t' + entry.tags.album;
+        auto it = album_ids.emplace(key, album_ids.size()).first;
+        album_of[i] = it->second;
+        album_pending.resize(album_ids.size(), false);
+        if (force || !entry.loudness.analyzed) {
+            album_pending[it->second] = true;
+        }
+    }
+
+    std::vector<size_t> pending;
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        if (album_of[i] != SIZE_MAX && album_pending[album_of[i]]) {
+            pending.push_back(i);
+        }
+    }
+    if (pending.empty()) {
+        return stats;
+    }
+
+    // 每张专辑累计各曲目的门限块直方图和最大真峰值
+    struct AlbumTotals {
+        std::mutex mutex;
+        LoudnessHistogram histogram;
+        float peak = 0.0f;
+    };
+    std::vector<std::unique_ptr<AlbumTotals>> albums(album_ids.size());
+    for (auto& album : albums) {
+        album = std::make_unique<AlbumTotals>();
+    }
+
+    if (threads == 0) {
+        threads = hardware_threads();
+    }
+    threads = std::max<size_t>(1, std::min(threads, pending.size()));
+
+    // 解码和滤波都是纯计算，每个文件一个任务，线程数不超过硬件线程数
+    std::mutex progress_mutex;
+    size_t done = 0;
+    {
+        WorkStealingPool pool(threads);
+        for (size_t i = 0; i < pending.size(); ++i) {
+            pool.spawn(i, [&, i](WorkStealingPool&, size_t) {
+                LibraryEntry& entry = entries_[pending[i]];
+                AlbumTotals& album = *albums[album_of[pending[i]]];
+                std::unique_ptr<LoudnessResult> result(new LoudnessResult());
+                std::string error;
+                bool ok = analyze_loudness(entry.path, result.get(), &error);
+                if (ok) {
+                    entry.loudness.analyzed = true;
+                    entry.loudness.track_lufs = (float)result->integrated_lufs;
+                    entry.loudness.track_peak = result->true_peak;
+                }
+
+                if (ok) {
+                    std::lock_guard<std::mutex> lock(album.mutex);
+                    album.histogram.merge(result->histogram);
+                    album.peak = std::max(album.peak, result->true_peak);
+                }
+
+                std::lock_guard<std::mutex> lock(progress_mutex);
+                ++done;
+                if (ok) {
+                    stats.audio_seconds += result->frames / (double)result->sample_rate;
+                } else {
+                    stats.failed++;
+                    entry.loudness = LoudnessInfo();
+                }
+                if (progress) {
+                    progress(done, pending.size(), entry, error);
+                }
+            });
+        }
+        pool.run();
+    }
+
+    // 专辑值：有曲目无法解码时用其余曲目计算
+    for (size_t index : pending) {
+        LoudnessInfo& loudness = entries_[index].loudness;
+        if (loudness.analyzed) {
+            const AlbumTotals& album = *albums[album_of[index]];
+            loudness.album_lufs = (float)album.histogram.integrated();
+            loudness.album_peak = album.peak;
+        }
+    }
+
+    stats.files = pending.size();
+    stats.threads = threads;
+    return stats;
+}
+
+void LibraryIndex::update() {
+    bool changed = refresh().changed;
+    if (probe() > 0) {
+        changed = true;
+    }
+    if (changed) {
+        save();
+    }
+}
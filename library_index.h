@@ -0,0 +1,183 @@
+#ifndef LIBRARY_INDEX_H
+#define LIBRARY_INDEX_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// 音频格式（按扩展名识别）
+enum class AudioFormat : uint8_t {
+    Unknown = 0,
+    Wav,
+    Mp3,
+    Flac,
+    Ogg,
+    M4a,
+    Aac,
+};
+
+// 根据文件名扩展名判断格式，不是音频文件时返回 Unknown
+AudioFormat audio_format_from_name(const std::string& filename);
+const char* audio_format_name(AudioFormat format);
+
+// 内置的 miniaudio 能否解码该格式（只支持 WAV / MP3 / FLAC）
+bool audio_format_decodable(AudioFormat format);
+
+// 读取文件开头几 KB，按魔数识别实际格式（跳过 ID3v2 标签），无法识别时返回 Unknown
+AudioFormat probe_audio_format(const std::string& path);
+
+// 时长信息（原始采样率下的帧数）
+struct DurationEstimate {
+    uint64_t frames = 0;
+    uint32_t sample_rate = 0;
+    bool exact = false;   // false 表示按码率估算（没有 Xing/Info/VBRI 头的 MP3）
+
+    uint64_t milliseconds() const { return sample_rate > 0 ? frames * 1000 / sample_rate : 0; }
+};
+
+// 只读文件头得到时长：WAV 用 data 块大小，FLAC 用 STREAMINFO，MP3 用 Xing/Info/VBRI 头，
+// 都没有时按开头几帧的平均码率估算。无法识别时返回 false
+bool probe_duration(const std::string& path, DurationEstimate* duration);
+
+// 文件中的文本标签（UTF-8）：MP3 的 ID3v2 / ID3v1，FLAC 的 Vorbis comment，WAV 的 LIST/INFO 块
+struct AudioTags {
+    std::string title;
+    std::string artist;
+    std::string album;
+
+    bool empty() const { return title.empty() && artist.empty() && album.empty(); }
+};
+
+// 完整扫描文件得到精确时长（MP3 逐帧解析帧头，不解码），abort 置位时尽快放弃并返回 false
+bool count_duration(const std::string& path, const std::atomic<bool>& abort, DurationEstimate* duration);
+
+// 读取普通文件的大小和修改时间（纳秒），用于判断按文件缓存的数据是否过期
+bool file_signature(const std::string& path, uint64_t* size, int64_t* mtime);
+
+// 内容探测结果
+enum class ProbeStatus : uint8_t {
+    Unprobed = 0,   // 尚未探测
+    Decodable,      // 内容可以解码
+    Undecodable,    // 格式不受支持或文件损坏
+};
+
+// 响度分析结果（EBU R128）。专辑值按同一目录下专辑标签相同的曲目合并计算，
+// 没有专辑标签时整个目录视为一张专辑
+struct LoudnessInfo {
+    bool analyzed = false;
+    float track_lufs = 0.0f;   // 积分响度（LUFS），静音文件为 -inf
+    float track_peak = 0.0f;   // 真峰值（线性，1.0 = 0 dBTP）
+    float album_lufs = 0.0f;
+    float album_peak = 0.0f;
+};
+
+// 索引中的一个音频文件
+struct LibraryEntry {
+    std::string path;           // 完整路径
+    uint64_t size = 0;          // 文件大小（字节）
+    int64_t mtime = 0;          // 修改时间（纳秒）
+    uint64_t duration_ms = 0;   // 时长（毫秒），0 表示尚未探测
+    bool duration_exact = false;  // 时长是否为精确值（false 时为按码率估算或未知）
+    bool duration_unmeasurable = false;  // 完整扫描失败（文件损坏），时长仍为估算值，不再重试
+    uint32_t sample_rate = 0;   // 以下为文件头探测结果，0 / 空表示未知
+    uint32_t channels = 0;
+    uint64_t audio_bytes = 0;   // 音频数据大小（不含标签和元数据块）
+    AudioTags tags;
+    AudioFormat format = AudioFormat::Unknown;      // 按扩展名识别的格式
+    AudioFormat detected = AudioFormat::Unknown;    // 按文件内容识别的格式
+    ProbeStatus probe = ProbeStatus::Unprobed;
+    LoudnessInfo loudness;      // caudio analyze 的结果
+
+    bool decodable() const { return probe == ProbeStatus::Decodable; }
+
+    // 平均码率（kbps），时长未知时为 0
+    uint32_t bitrate_kbps() const { return duration_ms > 0 ? (uint32_t)(audio_bytes * 8 / duration_ms) : 0; }
+};
+
+// 已扫描的目录及其修改时间，用于增量校验
+struct IndexedDirectory {
+    std::string path;
+    int64_t mtime = 0;
+};
+
+// 一次刷新的统计
+struct IndexRefreshStats {
+    size_t directories_checked = 0;    // 校验过的目录数
+    size_t directories_rescanned = 0;  // 新发现或修改时间变化后重新扫描的目录数
+    size_t files = 0;                  // 刷新后的文件总数
+    size_t threads = 0;                // 扫描使用的线程数
+    bool changed = false;              // 索引内容是否有变化（需要写回磁盘）
+};
+
+// 响度分析的统计
+struct AnalyzeStats {
+    size_t files = 0;            // 分析的文件数（包含为重算专辑值而重新分析的曲目）
+    size_t failed = 0;           // 无法解码的文件数
+    size_t threads = 0;
+    double audio_seconds = 0.0;  // 分析的音频总时长
+};
+
+// 响度分析进度回调：每完成一个文件调用一次（从分析线程调用，调用时已加锁），
+// error 为空表示成功，结果已写入 entry.loudness（专辑值在全部完成后才填入）
+using AnalyzeProgress = std::function<void(size_t done, size_t total, const LibraryEntry& entry, const std::string& error)>;
+
+// 扫描进度回调：参数为目前已找到的文件数（可能从多个扫描线程调用，调用时已加锁）
+using ScanProgress = std::function<void(size_t files)>;
+
+// 每个已添加目录对应一个持久化的二进制索引文件
+// 刷新时只比较目录的修改时间：目录中增删、重命名文件会改变目录的 mtime，
+// 未变化的目录直接沿用索引内容，不再逐个 stat 文件。
+// 递归模式下索引记录每个子目录的 mtime，只重新扫描发生变化的子目录；
+// 目录的读取和校验由工作窃取线程池并行完成，适合延迟较高的网络存储
+class LibraryIndex {
+public:
+    explicit LibraryIndex(const std::string& root, bool recursive = false);
+
+    // 从磁盘加载索引，文件不存在或损坏时返回 false（索引保持为空）
+    bool load();
+
+    // 写回磁盘
+    bool save() const;
+
+    // 校验索引并重新扫描发生变化的目录
+    IndexRefreshStats refresh(const ScanProgress& progress = nullptr);
+
+    // 探测尚未探测过的文件（并行读取文件头，识别格式并读出时长、采样率、声道数和标签，
+    // 不初始化解码器），返回本次探测的文件数。
+    // 探测结果随 (路径, 大小, 修改时间) 一起保存，文件不变时不会再次读取
+    size_t probe();
+
+    // 对只有估算时长的文件做完整扫描，得到精确时长，返回本次统计的文件数。
+    // 耗时与文件大小成正比，不包含在 update() 中；abort 置位时尽快返回
+    size_t measure(const std::atomic<bool>& abort);
+
+    // 完整解码并测量尚未分析的文件的积分响度和真峰值（EBU R128），文件在线程间并行处理。
+    // 专辑中有曲目需要分析时，整张专辑的曲目都重新分析以得到专辑值；force 时全部重新分析。
+    // threads 为 0 时使用硬件线程数。结果只写入内存，由调用方 save()
+    AnalyzeStats analyze(size_t threads, bool force, const AnalyzeProgress& progress = nullptr);
+
+    // 刷新目录并探测新文件，有变化时写回磁盘（load() 之后调用）
+    void update();
+
+    // 按路径排序的音频文件
+    const std::vector<LibraryEntry>& entries() const { return entries_; }
+
+    const std::string& root() const { return root_; }
+    bool recursive() const { return recursive_; }
+
+    // 索引文件路径（与 caudio_config.txt 放在同一目录）
+    static std::string indexFileFor(const std::string& root);
+
+    // 删除某个目录的索引文件
+    static void removeIndexFile(const std::string& root);
+
+private:
+    std::string root_;
+    bool recursive_;
+    std::vector<IndexedDirectory> directories_;
+    std::vector<LibraryEntry> entries_;
+};
+
+#endif // LIBRARY_INDEX_H
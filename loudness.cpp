@@ -0,0 +1,297 @@
+#include "loudness.h"
+#include "mmap_vfs.h"
+
+#include <algorithm>
+#include <cmath>
+
+bool parse_replay_gain_mode(const std::string& name, ReplayGainMode* mode) {
+    if (name == "off") {
+        *mode = ReplayGainMode::Off;
+        return true;
+    }
+    if (name == "track") {
+        *mode = ReplayGainMode::Track;
+        return true;
+    }
+    if (name == "album") {
+        *mode = ReplayGainMode::Album;
+        return true;
+    }
+    return false;
+}
+
+const char* replay_gain_mode_name(ReplayGainMode mode) {
+    switch (mode) {
+    case ReplayGainMode::Track:
+        return "track";
+    case ReplayGainMode::Album:
+        return "album";
+    default:
+        return "off";
+    }
+}
+
+float replay_gain_linear(const LoudnessInfo& loudness, ReplayGainMode mode) {
+    if (mode == ReplayGainMode::Off || !loudness.analyzed) {
+        return 1.0f;
+    }
+    float lufs = mode == ReplayGainMode::Album ? loudness.album_lufs : loudness.track_lufs;
+    float peak = mode == ReplayGainMode::Album ? loudness.album_peak : loudness.track_peak;
+    if (!std::isfinite(lufs)) {
+        return 1.0f;
+    }
+    double gain = std::pow(10.0, (REPLAYGAIN_REFERENCE_LUFS - lufs) / 20.0);
+    if (peak > 0.0f && gain * peak > 1.0) {
+        gain = 1.0 / peak;  // 提升安静的曲目时不让峰值超过满幅
+    }
+    return (float)gain;
+}
+
+double amplitude_to_db(double amplitude) {
+    return amplitude > 0.0 ? 20.0 * std::log10(amplitude) : -HUGE_VAL;
+}
+
+namespace {
+
+// 直方图下限和每格宽度（LU）
+const double HISTOGRAM_MIN_LUFS = -70.0;
+const double HISTOGRAM_BIN_LU = 0.1;
+
+double energy_to_lufs(double energy) {
+    return energy > 0.0 ? -0.691 + 10.0 * std::log10(energy) : -HUGE_VAL;
+}
+
+// BS.1770-4 的 K 加权滤波器在任意采样率下的系数（双线性变换，参数取自 48 kHz 下的标准系数）
+void k_weight_coeffs(ma_uint32 sample_rate, BiquadCoeffs* pre, BiquadCoeffs* rlb) {
+    const double pi = 3.14159265358979323846;
+
+    // 一级：约 1.7 kHz 以上提升 4 dB 的高架滤波器，模拟头部的声学效应
+    double f0 = 1681.974450955533;
+    double gain_db = 3.999843853973347;
+    double q = 0.7071752369554196;
+    double k = std::tan(pi * f0 / sample_rate);
+    double vh = std::pow(10.0, gain_db / 20.0);
+    double vb = std::pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    pre->b0 = (float)((vh + vb * k / q + k * k) / a0);
+    pre->b1 = (float)(2.0 * (k * k - vh) / a0);
+    pre->b2 = (float)((vh - vb * k / q + k * k) / a0);
+    pre->a1 = (float)(2.0 * (k * k - 1.0) / a0);
+    pre->a2 = (float)((1.0 - k / q + k * k) / a0);
+
+    // 二级：约 38 Hz 的 RLB 高通
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = std::tan(pi * f0 / sample_rate);
+    a0 = 1.0 + k / q + k * k;
+    rlb->b0 = 1.0f;
+    rlb->b1 = -2.0f;
+    rlb->b2 = 1.0f;
+    rlb->a1 = (float)(2.0 * (k * k - 1.0) / a0);
+    rlb->a2 = (float)((1.0 - k / q + k * k) / a0);
+}
+
+double channel_weight(ma_channel channel) {
+    switch (channel) {
+    case MA_CHANNEL_LFE:
+        return 0.0;
+    case MA_CHANNEL_SIDE_LEFT:
+    case MA_CHANNEL_SIDE_RIGHT:
+    case MA_CHANNEL_BACK_LEFT:
+    case MA_CHANNEL_BACK_RIGHT:
+        return 1.41;
+    default:
+        return 1.0;
+    }
+}
+
+// 每次解码的帧数
+const ma_uint32 ANALYZE_CHUNK_FRAMES = 4096;
+
+} // namespace
+
+LoudnessHistogram::LoudnessHistogram() {
+    counts_.fill(0);
+    energy_.fill(0.0);
+}
+
+void LoudnessHistogram::add(double energy) {
+    double lufs = energy_to_lufs(energy);
+    if (!(lufs >= HISTOGRAM_MIN_LUFS)) {
+        return;  // 绝对门限
+    }
+    int bin = std::min((int)((lufs - HISTOGRAM_MIN_LUFS) / HISTOGRAM_BIN_LU), BINS - 1);
+    counts_[bin]++;
+    energy_[bin] += energy;
+}
+
+void LoudnessHistogram::merge(const LoudnessHistogram& other) {
+    for (int i = 0; i < BINS; ++i) {
+        counts_[i] += other.counts_[i];
+        energy_[i] += other.energy_[i];
+    }
+}
+
+double LoudnessHistogram::integrated() const {
+    uint64_t count = 0;
+    double energy = 0.0;
+    for (int i = 0; i < BINS; ++i) {
+        count += counts_[i];
+        energy += energy_[i];
+    }
+    if (count == 0) {
+        return -HUGE_VAL;
+    }
+
+    // 相对门限：绝对门限内平均响度减 10 LU
+    double gate = energy_to_lufs(energy / count) - 10.0;
+    count = 0;
+    energy = 0.0;
+    for (int i = 0; i < BINS; ++i) {
+        double center = HISTOGRAM_MIN_LUFS + (i + 0.5) * HISTOGRAM_BIN_LU;
+        if (center > gate) {
+            count += counts_[i];
+            energy += energy_[i];
+        }
+    }
+    return count > 0 ? energy_to_lufs(energy / count) : -HUGE_VAL;
+}
+
+LoudnessMeter::LoudnessMeter(ma_uint32 channels, ma_uint32 sample_rate, const ma_channel* channel_map)
+    : channels_(channels),
+      weights_(channels, 1.0),
+      filters_((channels + 1) / 2),
+      channel_energy_(channels, 0.0),
+      sub_block_frames_(std::max<ma_uint32>(1, (sample_rate + 5) / 10)),
+      sub_block_position_(0),
+      sub_blocks_{0.0, 0.0, 0.0, 0.0},
+      sub_block_count_(0),
+      // 96 kHz 以上的采样率本身已足够密，直接取样本峰值
+      oversample_(sample_rate < 96000),
+      peak_(0.0f) {
+    if (channel_map != nullptr && channels > 2) {
+        for (ma_uint32 c = 0; c < channels; ++c) {
+            weights_[c] = channel_weight(channel_map[c]);
+        }
+    }
+
+    BiquadCoeffs pre, rlb;
+    k_weight_coeffs(sample_rate, &pre, &rlb);
+    for (auto& filter : filters_) {
+        k_weight_init(&filter, pre, rlb);
+    }
+
+    if (oversample_) {
+        peak_filter_.resize(TRUE_PEAK_TAPS * TRUE_PEAK_PHASES);
+        make_true_peak_filter(peak_filter_.data());
+        history_.assign((size_t)channels * (TRUE_PEAK_TAPS - 1), 0.0f);
+    }
+}
+
+void LoudnessMeter::process(const float* samples, ma_uint32 frames) {
+    measurePeak(samples, frames);
+
+    while (frames > 0) {
+        ma_uint32 n = std::min(frames, sub_block_frames_ - sub_block_position_);
+        for (ma_uint32 c = 0; c < channels_; c += 2) {
+            k_weight_energy_f32(samples, n, channels_, c, std::min<ma_uint32>(2, channels_ - c), &filters_[c / 2],
+                                &channel_energy_[c]);
+        }
+        samples += (size_t)n * channels_;
+        frames -= n;
+        sub_block_position_ += n;
+        if (sub_block_position_ == sub_block_frames_) {
+            finishSubBlock();
+        }
+    }
+}
+
+void LoudnessMeter::finishSubBlock() {
+    double energy = 0.0;
+    for (ma_uint32 c = 0; c < channels_; ++c) {
+        energy += weights_[c] * channel_energy_[c];
+        channel_energy_[c] = 0.0;
+    }
+    sub_blocks_[sub_block_count_ % 4] = energy / sub_block_frames_;
+    sub_block_position_ = 0;
+    if (++sub_block_count_ >= 4) {
+        histogram_.add((sub_blocks_[0] + sub_blocks_[1] + sub_blocks_[2] + sub_blocks_[3]) / 4.0);
+    }
+}
+
+void LoudnessMeter::measurePeak(const float* samples, ma_uint32 frames) {
+    const ma_uint32 history = TRUE_PEAK_TAPS - 1;
+    if (oversample_) {
+        scratch_.resize(history + frames);
+    }
+
+    for (ma_uint32 c = 0; c < channels_; ++c) {
+        float peak = peak_;
+        if (!oversample_) {
+            for (ma_uint32 i = 0; i < frames; ++i) {
+                peak = std::max(peak, std::fabs(samples[(size_t)i * channels_ + c]));
+            }
+            peak_ = peak;
+            continue;
+        }
+
+        // 拆出单个声道，前面接上一批的最后几个样本
+        float* x = scratch_.data();
+        float* saved = &history_[(size_t)c * history];
+        std::copy(saved, saved + history, x);
+        for (ma_uint32 i = 0; i < frames; ++i) {
+            float v = samples[(size_t)i * channels_ + c];
+            x[history + i] = v;
+            peak = std::max(peak, std::fabs(v));
+        }
+        peak = std::max(peak, true_peak_f32(x + history, frames, peak_filter_.data()));
+        std::copy(x + frames, x + frames + history, saved);
+        peak_ = peak;
+    }
+}
+
+bool analyze_loudness(const std::string& path, LoudnessResult* result, std::string* error) {
+    // 原始采样率和声道数，统一解码为 f32
+    ma_decoder_config config = ma_decoder_config_init(ma_format_f32, 0, 0);
+    ma_decoder decoder;
+    ma_result r = init_decoder_file(IoMode::Mmap, path, &config, &decoder);
+    if (r != MA_SUCCESS) {
+        *error = std::string("open failed: ") + ma_result_description(r);
+        return false;
+    }
+
+    ma_uint32 channels = decoder.outputChannels;
+    ma_uint32 sample_rate = decoder.outputSampleRate;
+    ma_channel channel_map[MA_MAX_CHANNELS];
+    ma_data_source_get_data_format(&decoder, nullptr, nullptr, nullptr, channel_map, MA_MAX_CHANNELS);
+
+    LoudnessMeter meter(channels, sample_rate, channel_map);
+    std::vector<float> buffer((size_t)ANALYZE_CHUNK_FRAMES * channels);
+    ma_uint64 total = 0;
+    for (;;) {
+        ma_uint64 read = 0;
+        r = ma_decoder_read_pcm_frames(&decoder, buffer.data(), ANALYZE_CHUNK_FRAMES, &read);
+        meter.process(buffer.data(), (ma_uint32)read);
+        total += read;
+        if (r != MA_SUCCESS || read < ANALYZE_CHUNK_FRAMES) {
+            break;
+        }
+    }
+    ma_decoder_uninit(&decoder);
+
+    if (r != MA_SUCCESS && r != MA_AT_END) {
+        *error = std::string("decode error: ") + ma_result_description(r);
+        return false;
+    }
+    if (total == 0) {
+        *error = "no audio frames";
+        return false;
+    }
+
+    result->integrated_lufs = meter.integrated();
+    result->true_peak = meter.truePeak();
+    result->frames = total;
+    result->sample_rate = sample_rate;
+    result->histogram = meter.histogram();
+    return true;
+}
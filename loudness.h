@@ -0,0 +1,106 @@
+#ifndef LOUDNESS_H
+#define LOUDNESS_H
+
+#include "dsp_kernels.h"
+#include "library_index.h"
+#include "third-party/miniaudio.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ReplayGain 2.0 的参考响度：增益把积分响度拉到该值
+constexpr double REPLAYGAIN_REFERENCE_LUFS = -18.0;
+
+// 播放时按哪种分析结果应用增益
+enum class ReplayGainMode {
+    Off,
+    Track,  // 每首曲目单独归一化
+    Album,  // 整张专辑使用同一个增益，保留曲目间的响度差异
+};
+
+// 解析 --replaygain 参数（off / track / album），无法识别时返回 false
+bool parse_replay_gain_mode(const std::string& name, ReplayGainMode* mode);
+const char* replay_gain_mode_name(ReplayGainMode mode);
+
+// 按模式计算线性增益：把积分响度拉到参考响度，并限制在真峰值不超过 0 dBTP。
+// 关闭、文件没有分析结果或是静音时返回 1
+float replay_gain_linear(const LoudnessInfo& loudness, ReplayGainMode mode);
+
+// 线性幅度换算为 dB（0 时为 -inf）
+double amplitude_to_db(double amplitude);
+
+// 400 ms 门限块的响度直方图：-70 .. +10 LUFS 每 0.1 LU 一格（低于 -70 LUFS 的块即绝对门限，直接丢弃），
+// 同时累计每格的能量。门限内的平均能量是精确值，只有相对门限所在的一格按格中心取舍。
+// 多首曲目的直方图相加即得到整张专辑的积分响度
+class LoudnessHistogram {
+public:
+    LoudnessHistogram();
+
+    // 加入一个块的均方能量（已按声道权重求和）
+    void add(double energy);
+    void merge(const LoudnessHistogram& other);
+
+    // 积分响度（LUFS）：绝对门限 -70 LUFS、相对门限低于门限内平均响度 10 LU。
+    // 没有超过绝对门限的块时返回 -inf
+    double integrated() const;
+
+private:
+    static constexpr int BINS = 800;
+
+    std::array<uint32_t, BINS> counts_;
+    std::array<double, BINS> energy_;
+};
+
+// 流式 EBU R128 测量（ITU-R BS.1770-4）：交错 f32 样本经 K 加权后按 100 ms 子块累计能量，
+// 每 4 个子块组成一个 400 ms 门限块（75% 重叠）；同时按 4 倍过采样测量真峰值
+class LoudnessMeter {
+public:
+    // channel_map 为 nullptr 时所有声道权重为 1
+    LoudnessMeter(ma_uint32 channels, ma_uint32 sample_rate, const ma_channel* channel_map);
+
+    void process(const float* samples, ma_uint32 frames);
+
+    const LoudnessHistogram& histogram() const { return histogram_; }
+    double integrated() const { return histogram_.integrated(); }
+    float truePeak() const { return peak_; }
+
+private:
+    // 完成一个 100 ms 子块，凑满 4 个子块后把门限块加入直方图
+    void finishSubBlock();
+
+    void measurePeak(const float* samples, ma_uint32 frames);
+
+    ma_uint32 channels_;
+    std::vector<double> weights_;           // 声道权重（LFE 为 0，环绕声道为 1.41）
+    std::vector<KWeightState> filters_;     // 每对声道一个滤波器
+    std::vector<double> channel_energy_;    // 当前子块各声道的能量
+
+    ma_uint32 sub_block_frames_;
+    ma_uint32 sub_block_position_;
+    double sub_blocks_[4];                  // 最近 4 个子块的加权能量（环形）
+    ma_uint64 sub_block_count_;
+    LoudnessHistogram histogram_;
+
+    // 真峰值：每个声道保留最近 TRUE_PEAK_TAPS - 1 个样本作为插值的历史
+    bool oversample_;
+    float peak_;
+    std::vector<float> peak_filter_;
+    std::vector<float> history_;
+    std::vector<float> scratch_;
+};
+
+// 单个文件的测量结果
+struct LoudnessResult {
+    double integrated_lufs = 0.0;
+    float true_peak = 0.0f;
+    ma_uint64 frames = 0;
+    ma_uint32 sample_rate = 0;
+    LoudnessHistogram histogram;
+};
+
+// 完整解码文件（原始采样率和声道数）并测量，失败时返回 false 并写入 error
+bool analyze_loudness(const std::string& path, LoudnessResult* result, std::string* error);
+
+#endif // LOUDNESS_H
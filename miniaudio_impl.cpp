@@ -0,0 +1,79 @@
+// miniaudio_impl.cpp
+// miniaudio 的实现单独放在一个编译单元中，其他源文件只包含头文件
+#define MINIAUDIO_IMPLEMENTATION
+// 处理图节点的缓存容量（帧），默认 480。设备周期不超过该值时每个节点每个周期只处理一次，
+// 不会把一次回调拆成多次读取缓冲
+#define MA_DEFAULT_NODE_CACHE_CAP_IN_FRAMES_PER_BUS 4096
+#include "third-party/miniaudio.h"
+
+// 需要访问 miniaudio 内部类型（MP3 后端）的辅助函数只能放在实现所在的编译单元
+#include "seek_index.h"
+
+#include <cstddef>
+
+static_assert(sizeof(SeekPoint) == sizeof(ma_dr_mp3_seek_point) &&
+              offsetof(SeekPoint, byte_offset) == offsetof(ma_dr_mp3_seek_point, seekPosInBytes) &&
+              offsetof(SeekPoint, frame) == offsetof(ma_dr_mp3_seek_point, pcmFrameIndex) &&
+              offsetof(SeekPoint, mp3_frames_to_discard) == offsetof(ma_dr_mp3_seek_point, mp3FramesToDiscard) &&
+              offsetof(SeekPoint, pcm_frames_to_discard) == offsetof(ma_dr_mp3_seek_point, pcmFramesToDiscard),
+              "SeekPoint must match ma_dr_mp3_seek_point");
+
+bool decoder_is_mp3(const ma_decoder* decoder) {
+#ifdef MA_HAS_MP3
+    return decoder != nullptr && decoder->pBackendVTable == &g_ma_decoding_backend_vtable_mp3;
+#else
+    return false;
+#endif
+}
+
+bool decoder_length_known(const ma_decoder* decoder) {
+#ifdef MA_HAS_MP3
+    if (decoder_is_mp3(decoder)) {
+        return ((const ma_mp3*)decoder->pBackend)->dr.totalPCMFrameCount != MA_UINT64_MAX;
+    }
+#endif
+    (void)decoder;
+    return true;
+}
+
+bool decoder_build_seek_table(ma_decoder* decoder, ma_uint32 max_points, SeekTable* table) {
+#ifdef MA_HAS_MP3
+    if (!decoder_is_mp3(decoder) || max_points == 0) {
+        return false;
+    }
+
+    ma_mp3* mp3 = (ma_mp3*)decoder->pBackend;
+    ma_uint32 count = max_points;
+    table->resize(count);
+    if (!ma_dr_mp3_calculate_seek_points(&mp3->dr, &count, (ma_dr_mp3_seek_point*)table->data())) {
+        table->clear();
+        return false;
+    }
+    table->resize(count);
+    return true;
+#else
+    (void)decoder;
+    (void)max_points;
+    (void)table;
+    return false;
+#endif
+}
+
+bool decoder_bind_seek_table(ma_decoder* decoder, SeekTable* table) {
+#ifdef MA_HAS_MP3
+    if (!decoder_is_mp3(decoder)) {
+        return false;
+    }
+
+    ma_mp3* mp3 = (ma_mp3*)decoder->pBackend;
+    if (table == nullptr || table->empty()) {
+        return ma_dr_mp3_bind_seek_table(&mp3->dr, 0, nullptr) == MA_TRUE;
+    }
+    return ma_dr_mp3_bind_seek_table(&mp3->dr, (ma_uint32)table->size(), (ma_dr_mp3_seek_point*)table->data()) ==
+           MA_TRUE;
+#else
+    (void)decoder;
+    (void)table;
+    return false;
+#endif
+}
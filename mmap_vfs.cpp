@@ -0,0 +1,290 @@
+#include "mmap_vfs.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// 预读窗口：游标距已提示区域末尾不足一半时，再向前提示一个窗口
+static const size_t READAHEAD_WINDOW = 2 * 1024 * 1024;
+
+bool parse_io_mode(const std::string& text, IoMode* mode) {
+    if (text == "mmap") {
+        *mode = IoMode::Mmap;
+        return true;
+    }
+    if (text == "stdio") {
+        *mode = IoMode::Stdio;
+        return true;
+    }
+    return false;
+}
+
+const char* io_mode_name(IoMode mode) {
+    return mode == IoMode::Mmap ? "mmap" : "stdio";
+}
+
+#ifdef _WIN32
+
+MmapVfs::MmapVfs() {
+    memset(&callbacks_, 0, sizeof(callbacks_));
+}
+
+#else
+
+namespace {
+
+// 一个已映射的文件
+struct MappedFile {
+    const ma_uint8* data;
+    size_t size;
+    size_t cursor;
+    size_t advised_end;  // 已提示 MADV_WILLNEED 的区域末尾
+    size_t page_size;
+};
+
+ma_result result_from_errno(int error) {
+    switch (error) {
+    case ENOENT: return MA_DOES_NOT_EXIST;
+    case EACCES: return MA_ACCESS_DENIED;
+    case ENOMEM: return MA_OUT_OF_MEMORY;
+    case EISDIR: return MA_IS_DIRECTORY;
+    default:     return MA_ERROR;
+    }
+}
+
+void advise_ahead(MappedFile* file) {
+    if (file->size == 0 || file->advised_end >= file->size) {
+        return;
+    }
+    if (file->advised_end > file->cursor + READAHEAD_WINDOW / 2) {
+        return;
+    }
+
+    // madvise 要求起始地址按页对齐
+    size_t start = std::max(file->cursor, file->advised_end) / file->page_size * file->page_size;
+    size_t end = std::min(file->size, start + READAHEAD_WINDOW);
+    madvise((void*)(file->data + start), end - start, MADV_WILLNEED);
+    file->advised_end = end;
+}
+
+ma_result mmap_open(ma_vfs* vfs, const char* path, ma_uint32 open_mode, ma_vfs_file* out_file) {
+    (void)vfs;
+    if (path == nullptr || out_file == nullptr) {
+        return MA_INVALID_ARGS;
+    }
+    *out_file = nullptr;
+
+    // 只支持只读
+    if ((open_mode & MA_OPEN_MODE_WRITE) != 0) {
+        return MA_ACCESS_DENIED;
+    }
+
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return result_from_errno(errno);
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ma_result result = result_from_errno(errno);
+        ::close(fd);
+        return result;
+    }
+
+    MappedFile* file = new MappedFile();
+    file->data = nullptr;
+    file->size = (size_t)info.st_size;
+    file->cursor = 0;
+    file->advised_end = 0;
+    file->page_size = (size_t)sysconf(_SC_PAGESIZE);
+
+    if (file->size > 0) {
+        void* data = mmap(nullptr, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            ma_result result = result_from_errno(errno);
+            ::close(fd);
+            delete file;
+            return result;
+        }
+        file->data = (const ma_uint8*)data;
+        madvise(data, file->size, MADV_SEQUENTIAL);
+        advise_ahead(file);
+    }
+
+    // 映射建立后文件描述符即可关闭
+    ::close(fd);
+    *out_file = file;
+    return MA_SUCCESS;
+}
+
+ma_result mmap_close(ma_vfs* vfs, ma_vfs_file handle) {
+    (void)vfs;
+    MappedFile* file = (MappedFile*)handle;
+    if (file == nullptr) {
+        return MA_INVALID_ARGS;
+    }
+    if (file->data != nullptr) {
+        munmap((void*)file->data, file->size);
+    }
+    delete file;
+    return MA_SUCCESS;
+}
+
+ma_result mmap_read(ma_vfs* vfs, ma_vfs_file handle, void* dst, size_t size, size_t* bytes_read) {
+    (void)vfs;
+    MappedFile* file = (MappedFile*)handle;
+    if (file == nullptr || dst == nullptr) {
+        return MA_INVALID_ARGS;
+    }
+
+    size_t available = file->cursor < file->size ? file->size - file->cursor : 0;
+    size_t n = std::min(size, available);
+    if (n > 0) {
+        memcpy(dst, file->data + file->cursor, n);
+        file->cursor += n;
+        advise_ahead(file);
+    }
+
+    if (bytes_read != nullptr) {
+        *bytes_read = n;
+    }
+    return (n == 0 && size > 0) ? MA_AT_END : MA_SUCCESS;
+}
+
+ma_result mmap_write(ma_vfs* vfs, ma_vfs_file handle, const void* src, size_t size, size_t* bytes_written) {
+    (void)vfs; (void)handle; (void)src; (void)size;
+    if (bytes_written != nullptr) {
+        *bytes_written = 0;
+    }
+    return MA_ACCESS_DENIED;
+}
+
+ma_result mmap_seek(ma_vfs* vfs, ma_vfs_file handle, ma_int64 offset, ma_seek_origin origin) {
+    (void)vfs;
+    MappedFile* file = (MappedFile*)handle;
+    if (file == nullptr) {
+        return MA_INVALID_ARGS;
+    }
+
+    ma_int64 base = 0;
+    if (origin == ma_seek_origin_current) {
+        base = (ma_int64)file->cursor;
+    } else if (origin == ma_seek_origin_end) {
+        base = (ma_int64)file->size;
+    }
+
+    ma_int64 target = base + offset;
+    if (target < 0 || target > (ma_int64)file->size) {
+        return MA_BAD_SEEK;
+    }
+
+    // 向后跳转（或跳过已提示区域）时从新位置重新提示
+    size_t cursor = (size_t)target;
+    if (cursor < file->cursor || cursor > file->advised_end) {
+        file->advised_end = cursor;
+    }
+    file->cursor = cursor;
+    advise_ahead(file);
+    return MA_SUCCESS;
+}
+
+ma_result mmap_tell(ma_vfs* vfs, ma_vfs_file handle, ma_int64* cursor) {
+    (void)vfs;
+    MappedFile* file = (MappedFile*)handle;
+    if (file == nullptr || cursor == nullptr) {
+        return MA_INVALID_ARGS;
+    }
+    *cursor = (ma_int64)file->cursor;
+    return MA_SUCCESS;
+}
+
+ma_result mmap_info(ma_vfs* vfs, ma_vfs_file handle, ma_file_info* info) {
+    (void)vfs;
+    MappedFile* file = (MappedFile*)handle;
+    if (file == nullptr || info == nullptr) {
+        return MA_INVALID_ARGS;
+    }
+    info->sizeInBytes = file->size;
+    return MA_SUCCESS;
+}
+
+} // namespace
+
+MmapVfs::MmapVfs() {
+    memset(&callbacks_, 0, sizeof(callbacks_));
+    callbacks_.onOpen  = mmap_open;
+    callbacks_.onClose = mmap_close;
+    callbacks_.onRead  = mmap_read;
+    callbacks_.onWrite = mmap_write;
+    callbacks_.onSeek  = mmap_seek;
+    callbacks_.onTell  = mmap_tell;
+    callbacks_.onInfo  = mmap_info;
+}
+
+#endif
+
+namespace {
+
+AbortableVfs* abortable(ma_vfs* vfs) {
+    return (AbortableVfs*)vfs;
+}
+
+ma_result abortable_open(ma_vfs* vfs, const char* path, ma_uint32 open_mode, ma_vfs_file* file) {
+    return ma_vfs_open(abortable(vfs)->base(), path, open_mode, file);
+}
+
+ma_result abortable_close(ma_vfs* vfs, ma_vfs_file file) {
+    return ma_vfs_close(abortable(vfs)->base(), file);
+}
+
+ma_result abortable_read(ma_vfs* vfs, ma_vfs_file file, void* dst, size_t size, size_t* bytes_read) {
+    if (abortable(vfs)->aborted()) {
+        if (bytes_read != nullptr) {
+            *bytes_read = 0;
+        }
+        return MA_CANCELLED;
+    }
+    return ma_vfs_read(abortable(vfs)->base(), file, dst, size, bytes_read);
+}
+
+ma_result abortable_seek(ma_vfs* vfs, ma_vfs_file file, ma_int64 offset, ma_seek_origin origin) {
+    return ma_vfs_seek(abortable(vfs)->base(), file, offset, origin);
+}
+
+ma_result abortable_tell(ma_vfs* vfs, ma_vfs_file file, ma_int64* cursor) {
+    return ma_vfs_tell(abortable(vfs)->base(), file, cursor);
+}
+
+ma_result abortable_info(ma_vfs* vfs, ma_vfs_file file, ma_file_info* info) {
+    return ma_vfs_info(abortable(vfs)->base(), file, info);
+}
+
+} // namespace
+
+AbortableVfs::AbortableVfs(const std::atomic<bool>* abort) : abort_(abort) {
+    memset(&callbacks_, 0, sizeof(callbacks_));
+    callbacks_.onOpen  = abortable_open;
+    callbacks_.onClose = abortable_close;
+    callbacks_.onRead  = abortable_read;
+    callbacks_.onSeek  = abortable_seek;
+    callbacks_.onTell  = abortable_tell;
+    callbacks_.onInfo  = abortable_info;
+    ma_default_vfs_init(&base_, nullptr);
+}
+
+ma_result init_decoder_file(IoMode mode, const std::string& path, const ma_decoder_config* config,
+                            ma_decoder* decoder) {
+    // VFS 本身没有状态（每个文件的映射保存在文件句柄中），所有解码器共用一个实例
+    static MmapVfs mmap_vfs;
+    if (mode == IoMode::Mmap && MMAP_IO_SUPPORTED) {
+        return ma_decoder_init_vfs(mmap_vfs.vfs(), path.c_str(), config, decoder);
+    }
+    return ma_decoder_init_file(path.c_str(), config, decoder);
+}
@@ -0,0 +1,60 @@
+#ifndef MMAP_VFS_H
+#define MMAP_VFS_H
+
+#include "third-party/miniaudio.h"
+
+#include <atomic>
+#include <string>
+
+// 解码器的文件读取方式
+enum class IoMode {
+    Stdio,  // miniaudio 默认的 stdio 读取
+    Mmap,   // 内存映射，从页缓存直接拷贝，不再逐包调用 read()
+};
+
+#ifdef _WIN32
+constexpr bool MMAP_IO_SUPPORTED = false;
+#else
+constexpr bool MMAP_IO_SUPPORTED = true;
+#endif
+
+// 解析 --io 参数（"mmap" / "stdio"），无法识别时返回 false
+bool parse_io_mode(const std::string& text, IoMode* mode);
+const char* io_mode_name(IoMode mode);
+
+// 基于 mmap 的只读 VFS，供 ma_decoder_init_vfs 使用
+// 打开时整体映射文件并提示 MADV_SEQUENTIAL，读取游标前进时
+// 对前方窗口提示 MADV_WILLNEED，让内核提前把数据读入页缓存
+class MmapVfs {
+public:
+    MmapVfs();
+
+    ma_vfs* vfs() { return &callbacks_; }
+
+private:
+    // miniaudio 把 ma_vfs* 当作 ma_vfs_callbacks* 使用，必须是第一个成员
+    ma_vfs_callbacks callbacks_;
+};
+
+// 转发给 miniaudio 默认 stdio VFS 的 VFS，每次读取前检查中止标志。
+// 中止后读取返回 MA_CANCELLED，解码器把它当作文件结束，后台扫描随即结束
+class AbortableVfs {
+public:
+    explicit AbortableVfs(const std::atomic<bool>* abort);
+
+    ma_vfs* vfs() { return &callbacks_; }
+    ma_vfs* base() { return &base_; }
+    bool aborted() const { return abort_->load(std::memory_order_relaxed); }
+
+private:
+    ma_vfs_callbacks callbacks_;  // 必须是第一个成员
+    ma_default_vfs base_;
+    const std::atomic<bool>* abort_;
+};
+
+// 按读取方式初始化解码器（播放、转码等所有需要打开文件的地方共用）
+// mmap 不可用时退回 stdio
+ma_result init_decoder_file(IoMode mode, const std::string& path, const ma_decoder_config* config,
+                            ma_decoder* decoder);
+
+#endif // MMAP_VFS_H
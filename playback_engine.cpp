@@ -0,0 +1,989 @@
+#include "playback_engine.h"
+#include "dsp_kernels.h"
+#include "control_input.h"
+#include "library_index.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+PlaybackEngine::PlaybackEngine()
+    : track_count_(0),
+      current_slot_(0),
+      has_current_(false),
+      has_next_(false),
+      decode_index_(0),
+      next_index_(0),
+      scan_index_(0),
+      written_frames_(0),
+      format_(ma_format_unknown),
+      channels_(0),
+      sample_rate_(0),
+      volume_(1.0f),
+      crossfade_frames_(0),
+      crossfade_length_(0),
+      crossfade_position_(0),
+      in_crossfade_(false),
+      ring_initialized_(false),
+      bytes_per_frame_(0),
+      capacity_frames_(0),
+      volume_ramp_frames_(1),
+      output_(nullptr),
+      output_attached_(false),
+      opener_format_ready_(false),
+      opener_cancel_(false),
+      opener_result_(MA_SUCCESS),
+      trace_(nullptr),
+      seek_track_(0),
+      seek_frame_(0),
+      seek_served_(0),
+      seek_settling_(false),
+      events_(nullptr) {
+}
+
+PlaybackEngine::~PlaybackEngine() {
+    stop();
+    if (ring_initialized_) {
+        ma_pcm_rb_uninit(&ring_);
+    }
+}
+
+ma_result PlaybackEngine::open(const std::vector<std::string>& tracks, const PlaybackEngineConfig& config) {
+    if (tracks.empty() || track_count_ > 0) {
+        return MA_INVALID_ARGS;
+    }
+
+    config_ = config;
+    config_.crossfade_ms = std::min(config.crossfade_ms, MAX_CROSSFADE_MS);
+
+    track_count_ = tracks.size();
+    tracks_.reset(new TrackSlot[track_count_]);
+    for (size_t i = 0; i < track_count_; ++i) {
+        tracks_[i].path = tracks[i];
+    }
+
+    // 第一首曲目按原始格式打开（--output 指定的部分除外），设备也使用该格式；
+    // 交叉淡入淡出需要在 f32 下混音、均衡和限幅需要在 f32 下处理，此时采样格式固定为 f32
+    bool need_f32 = config_.crossfade_ms > 0 || config_.eq || config_.limiter;
+    AudioOutputFormat wanted = config_.output_format;
+    if (need_f32) {
+        wanted.format = ma_format_f32;
+    }
+    ma_decoder* decoder = &decoders_[current_slot_];
+    ma_decoder_config decoder_config = decoderConfig(wanted);
+    if (trace_ != nullptr) trace_->begin(StartupTrace::DecoderOpen);
+    ma_result result = initDecoder(tracks_[0].path, &decoder_config, decoder);
+    if (result == MA_SUCCESS) {
+        source_format_ = {decoder->converter.formatIn, decoder->converter.channelsIn, decoder->converter.sampleRateIn};
+        wanted = {decoder->outputFormat, decoder->outputChannels, decoder->outputSampleRate};
+
+        // 共享设备已按其他格式打开且不值得重新打开时，改为让解码器转换到设备格式
+        // （交叉淡入淡出、均衡和限幅仍需要 f32，此时采样格式不同只能重新打开设备）
+        AudioOutputFormat target = wanted;
+        if (output_ != nullptr) {
+            output_->setReusePolicy(config_.device_reuse);
+            target = output_->chooseFormat(wanted);
+            if (need_f32) {
+                target.format = ma_format_f32;
+            }
+        }
+        if (target != wanted) {
+            ma_decoder_uninit(decoder);
+            decoder_config = decoderConfig(target);
+            result = initDecoder(tracks_[0].path, &decoder_config, decoder);
+        }
+    }
+    if (trace_ != nullptr) trace_->end(StartupTrace::DecoderOpen);
+    if (result != MA_SUCCESS) {
+        tracks_[0].result = result;
+        return result;
+    }
+    attach_seek_table(decoder, tracks_[0].path, false, &seek_tables_[current_slot_]);
+
+    if (trace_ != nullptr) trace_->begin(StartupTrace::TrackLength);
+    result = trackLength(0, decoder);
+    if (trace_ != nullptr) trace_->end(StartupTrace::TrackLength);
+    if (result != MA_SUCCESS) {
+        tracks_[0].result = result;
+        ma_decoder_uninit(decoder);
+        return result;
+    }
+
+    has_current_ = true;
+    decode_index_ = 0;
+    scan_index_ = 1;
+    tracks_[0].start_frame = 0;
+
+    format_ = decoder->outputFormat;
+    channels_ = decoder->outputChannels;
+    sample_rate_ = decoder->outputSampleRate;
+    bytes_per_frame_ = ma_get_bytes_per_frame(format_, channels_);
+
+    // 淡变曲线和混音用的临时缓冲在这里一次性分配，解码线程中不再分配内存
+    if (config_.crossfade_ms > 0 && track_count_ > 1) {
+        crossfade_frames_ = (ma_uint32)((ma_uint64)sample_rate_ * config_.crossfade_ms / 1000);
+        fade_out_.resize(crossfade_frames_);
+        fade_in_.resize(crossfade_frames_);
+        crossfade_scratch_.resize((size_t)CROSSFADE_CHUNK_FRAMES * channels_);
+    }
+
+    // f32 输出时回调走处理图：各阶段是 ma_node_graph 中的节点，节点和缓存在这里一次性分配
+    if (format_ == ma_format_f32) {
+        ProcessingGraphConfig graph;
+        graph.channels = channels_;
+        graph.add(ProcessingStageType::Source, this, &PlaybackEngine::sourceNode);
+        graph.add(ProcessingStageType::Gain, this, &PlaybackEngine::gainNode);
+        if (config_.eq) {
+            eq_.configure(sample_rate_, channels_, config_.eq_settings, config_.eq_enabled);
+            graph.add(ProcessingStageType::Eq, &eq_, &PlaybackEngine::eqNode);
+        }
+        if (config_.limiter) {
+            limiter_.configure(sample_rate_, channels_);
+            graph.add(ProcessingStageType::Limiter, &limiter_, &PlaybackEngine::limiterNode);
+        }
+        result = graph_.init(graph, config_.allocation_callbacks);
+        if (result != MA_SUCCESS) {
+            return result;
+        }
+    }
+
+    // 音量渐变的斜率按输出采样率换算
+    volume_ramp_frames_ = std::max<ma_uint32>(sample_rate_ * VOLUME_RAMP_MS / 1000, 1);
+
+    // 至少保留 20ms，避免设备周期大于缓冲容量
+    ma_uint32 ms = std::max<ma_uint32>(config_.lookahead_ms, 20);
+    capacity_frames_ = (ma_uint32)((ma_uint64)sample_rate_ * ms / 1000);
+
+    result = ma_pcm_rb_init(format_, channels_, capacity_frames_, nullptr, config_.allocation_callbacks, &ring_);
+    if (result != MA_SUCCESS) {
+        return result;
+    }
+    ma_pcm_rb_set_sample_rate(&ring_, sample_rate_);
+    ring_initialized_ = true;
+    callback_.min_fill_frames.store(capacity_frames_, std::memory_order_relaxed);
+    publishDeviceFormat();
+    return MA_SUCCESS;
+}
+
+void PlaybackEngine::prepareDevice() {
+    if (device_opener_.joinable() || output_attached_) {
+        return;
+    }
+    ensureOutput();
+    opener_format_ready_ = ring_initialized_;  // 已经 open() 过时格式已确定
+    opener_cancel_ = false;
+    device_opener_ = std::thread(&PlaybackEngine::deviceOpenerLoop, this);
+}
+
+void PlaybackEngine::deviceOpenerLoop() {
+    // 后端初始化（连接音频服务、枚举设备）不依赖输出格式，与打开解码器同时进行
+    // 共享设备的上下文已经初始化过时这里没有开销
+    if (trace_ != nullptr) trace_->begin(StartupTrace::ContextInit);
+    output_->initContext();
+    if (trace_ != nullptr) trace_->end(StartupTrace::ContextInit);
+
+    {
+        std::unique_lock<std::mutex> lock(opener_mutex_);
+        opener_cv_.wait(lock, [this] { return opener_format_ready_ || opener_cancel_; });
+        if (opener_cancel_) {
+            opener_result_ = MA_CANCELLED;
+            return;
+        }
+    }
+
+    // 格式由 open() 在发布前写入，之后到 start() 等待本线程结束之前不再修改
+    if (trace_ != nullptr) trace_->begin(StartupTrace::DeviceInit);
+    opener_result_ = attachOutput();
+    if (trace_ != nullptr) trace_->end(StartupTrace::DeviceInit);
+}
+
+void PlaybackEngine::publishDeviceFormat() {
+    {
+        std::lock_guard<std::mutex> lock(opener_mutex_);
+        opener_format_ready_ = true;
+    }
+    opener_cv_.notify_one();
+}
+
+ma_result PlaybackEngine::seekFirstTrack(ma_uint64 frame) {
+    if (!has_current_ || decode_index_ != 0 || worker_.joinable()) {
+        return MA_INVALID_OPERATION;
+    }
+
+    if (trace_ != nullptr) trace_->begin(StartupTrace::Seek);
+    ma_decoder* decoder = &decoders_[current_slot_];
+    attach_seek_table(decoder, tracks_[0].path, true, &seek_tables_[current_slot_]);
+    ma_result result = ma_decoder_seek_to_pcm_frame(decoder, frame);
+    if (result == MA_SUCCESS) {
+        tracks_[0].start_offset.store(frame, std::memory_order_relaxed);
+    }
+    if (trace_ != nullptr) trace_->end(StartupTrace::Seek);
+    return result;
+}
+
+ma_decoder_config PlaybackEngine::decoderConfig(const AudioOutputFormat& format) const {
+    ma_decoder_config config = ma_decoder_config_init(format.format, format.channels, format.sample_rate);
+    config.resampling.linear.lpfOrder = resampler_lpf_order(config_.resampler);
+    if (config_.allocation_callbacks != nullptr) {
+        config.allocationCallbacks = *config_.allocation_callbacks;
+    }
+    return config;
+}
+
+ma_result PlaybackEngine::initDecoder(const std::string& path, const ma_decoder_config* config, ma_decoder* decoder) {
+    return init_decoder_file(config_.io_mode, path, config, decoder);
+}
+
+ma_result PlaybackEngine::trackLength(size_t index, ma_decoder* decoder) {
+    TrackSlot& track = tracks_[index];
+    DurationEstimate duration;
+    if (decoder_length_known(decoder) || !probe_duration(track.path, &duration) || duration.sample_rate == 0) {
+        ma_uint64 length = 0;
+        ma_result result = ma_decoder_get_length_in_pcm_frames(decoder, &length);
+        if (result == MA_SUCCESS) {
+            track.length_frames.store(length, std::memory_order_relaxed);
+        }
+        return result;
+    }
+
+    // 后台线程先写 counted_frames 再写 length_frames，这里先写估算值再检查 counted_frames
+    // （都是顺序一致的原子操作），两边交错时精确值也不会被估算值覆盖
+    track.length_frames.store(duration.frames * decoder->outputSampleRate / duration.sample_rate);
+    ma_uint64 counted = track.counted_frames.load();
+    if (counted > 0) {
+        track.length_frames.store(counted);
+    }
+    return MA_SUCCESS;
+}
+
+bool PlaybackEngine::openTrack(size_t index, ma_decoder* decoder) {
+    // 后续曲目统一转换到设备格式，保证缓冲中的 PCM 可以直接拼接
+    ma_decoder_config config = decoderConfig({format_, channels_, sample_rate_});
+    ma_result result = initDecoder(tracks_[index].path, &config, decoder);
+    if (result != MA_SUCCESS) {
+        tracks_[index].result = result;
+        return false;
+    }
+    attach_seek_table(decoder, tracks_[index].path, false, &seek_tables_[decoder - decoders_]);
+
+    result = trackLength(index, decoder);
+    if (result != MA_SUCCESS) {
+        tracks_[index].result = result;
+        ma_decoder_uninit(decoder);
+        return false;
+    }
+    return true;
+}
+
+void PlaybackEngine::preopenNext() {
+    while (!has_next_ && scan_index_ < track_count_) {
+        size_t index = scan_index_++;
+        if (openTrack(index, &decoders_[1 - current_slot_])) {
+            has_next_ = true;
+            next_index_ = index;
+        }
+    }
+}
+
+void PlaybackEngine::publishNextStart() {
+    // 中间打开失败的曲目长度为 0，起止位置都落在当前边界上
+    size_t end = has_next_ ? next_index_ : track_count_;
+    for (size_t i = decode_index_ + 1; i < end; ++i) {
+        tracks_[i].start_frame.store(written_frames_, std::memory_order_release);
+        tracks_[i].end_frame.store(written_frames_, std::memory_order_release);
+    }
+
+    // 起始位置必须在该曲目的第一帧提交到缓冲之前发布
+    if (has_next_) {
+        tracks_[next_index_].start_frame.store(written_frames_, std::memory_order_release);
+    }
+}
+
+bool PlaybackEngine::advanceTrack() {
+    preopenNext();
+    publishNextStart();
+
+    if (!has_next_) {
+        return false;
+    }
+
+    current_slot_ = 1 - current_slot_;
+    has_next_ = false;
+    has_current_ = true;
+    decode_index_ = next_index_;
+    return true;
+}
+
+ma_uint64 PlaybackEngine::remainingFrames() {
+    ma_uint64 cursor = 0;
+    ma_decoder_get_cursor_in_pcm_frames(&decoders_[current_slot_], &cursor);
+    ma_uint64 length = tracks_[decode_index_].length_frames.load(std::memory_order_relaxed);
+    return length > cursor ? length - cursor : 0;
+}
+
+ma_uint32 PlaybackEngine::fillCrossfade(float* buffer, ma_uint32 frames) {
+    ma_uint32 n = std::min(frames, crossfade_length_ - crossfade_position_);
+    n = std::min(n, CROSSFADE_CHUNK_FRAMES);
+
+    // 当前曲目实际长度可能比估算的短，不足部分按静音处理
+    ma_uint64 frames_a = 0;
+    ma_decoder_read_pcm_frames(&decoders_[current_slot_], buffer, n, &frames_a);
+    if (frames_a < n) {
+        memset(buffer + frames_a * channels_, 0, (size_t)(n - frames_a) * bytes_per_frame_);
+    }
+
+    float* scratch = crossfade_scratch_.data();
+    ma_uint64 frames_b = 0;
+    ma_decoder_read_pcm_frames(&decoders_[1 - current_slot_], scratch, n, &frames_b);
+    if (frames_b < n) {
+        memset(scratch + frames_b * channels_, 0, (size_t)(n - frames_b) * bytes_per_frame_);
+    }
+
+    mix_crossfade_f32(buffer, buffer, scratch,
+                      fade_out_.data() + crossfade_position_, fade_in_.data() + crossfade_position_,
+                      n, channels_);
+    crossfade_position_ += n;
+    return n;
+}
+
+ma_uint32 PlaybackEngine::fillOnce() {
+    ma_uint32 written = 0;
+
+    // 有新的跳转请求时立即停止写入旧位置的数据
+    while (!control_.worker_stop.load(std::memory_order_relaxed) &&
+           control_.seek_request.load(std::memory_order_acquire) == seek_served_) {
+        if (!has_current_ && !advanceTrack()) {
+            decoder_state_.queue_eof.store(true, std::memory_order_release);
+            break;
+        }
+
+        // 缓冲写指针回绕时可写区域分为两段，循环处理
+        ma_uint32 frames = ma_pcm_rb_available_write(&ring_);
+        if (frames == 0) {
+            break;
+        }
+
+        // 交叉淡入淡出：当前曲目读到距结尾 crossfade_frames_ 处时开始与下一首重叠
+        if (crossfade_frames_ > 0 && !in_crossfade_ && (has_next_ || scan_index_ < track_count_)) {
+            ma_uint64 remaining = remainingFrames();
+            if (remaining > crossfade_frames_) {
+                frames = (ma_uint32)std::min<ma_uint64>(frames, remaining - crossfade_frames_);
+            } else {
+                preopenNext();
+                if (has_next_) {
+                    ma_uint64 next_length = tracks_[next_index_].length_frames.load(std::memory_order_relaxed);
+                    crossfade_length_ = (ma_uint32)std::min<ma_uint64>(std::min(remaining, next_length), crossfade_frames_);
+                    if (crossfade_length_ > 0) {
+                        make_equal_power_curve(fade_out_.data(), fade_in_.data(), crossfade_length_);
+                        crossfade_position_ = 0;
+                        in_crossfade_ = true;
+
+                        // 下一首从重叠开始处计入输出流
+                        publishNextStart();
+                    }
+                }
+            }
+        }
+
+        void* buffer;
+        if (ma_pcm_rb_acquire_write(&ring_, &frames, &buffer) != MA_SUCCESS || frames == 0) {
+            break;
+        }
+
+        if (in_crossfade_) {
+            ma_uint32 mixed = fillCrossfade((float*)buffer, frames);
+            ma_pcm_rb_commit_write(&ring_, mixed);
+            written_frames_ += mixed;
+            written += mixed;
+
+            if (crossfade_position_ >= crossfade_length_) {
+                // 淡变结束：当前曲目结束，下一首成为当前曲目继续解码
+                tracks_[decode_index_].end_frame.store(written_frames_, std::memory_order_release);
+                ma_decoder_uninit(&decoders_[current_slot_]);
+                current_slot_ = 1 - current_slot_;
+                has_next_ = false;
+                decode_index_ = next_index_;
+                in_crossfade_ = false;
+            }
+            continue;
+        }
+
+        // 直接解码到缓冲中，不经过中间拷贝
+        ma_uint64 frames_read = 0;
+        ma_result result = ma_decoder_read_pcm_frames(&decoders_[current_slot_], buffer, frames, &frames_read);
+        ma_pcm_rb_commit_write(&ring_, (ma_uint32)frames_read);
+        written_frames_ += frames_read;
+        written += (ma_uint32)frames_read;
+
+        if (result != MA_SUCCESS || frames_read < frames) {
+            // 当前曲目解码结束，下一轮循环直接接上下一首
+            tracks_[decode_index_].end_frame.store(written_frames_, std::memory_order_release);
+            ma_decoder_uninit(&decoders_[current_slot_]);
+            has_current_ = false;
+        }
+    }
+
+    return written;
+}
+
+void PlaybackEngine::ensureOutput() {
+    if (output_ == nullptr) {
+        owned_output_.reset(new AudioOutput());
+        output_ = owned_output_.get();
+    }
+}
+
+ma_result PlaybackEngine::attachOutput() {
+    AudioOutputClient client;
+    client.user_data = this;
+    client.render = &PlaybackEngine::outputRender;
+    client.stopped = &PlaybackEngine::outputStopped;
+
+    ma_result result = output_->attach({format_, channels_, sample_rate_}, source_format_, client);
+    if (result != MA_SUCCESS) {
+        return result;
+    }
+    output_attached_ = true;
+    return MA_SUCCESS;
+}
+
+ma_result PlaybackEngine::start() {
+    if (!ring_initialized_ || worker_.joinable()) {
+        return MA_INVALID_OPERATION;
+    }
+
+    // 设备已在 prepareDevice() 的线程中打开（与解码器打开、跳转并行）时只需等待它完成
+    ma_result result = MA_SUCCESS;
+    if (device_opener_.joinable()) {
+        device_opener_.join();
+        result = opener_result_;
+    } else if (!output_attached_) {
+        ensureOutput();
+        if (trace_ != nullptr) trace_->begin(StartupTrace::DeviceInit);
+        result = attachOutput();
+        if (trace_ != nullptr) trace_->end(StartupTrace::DeviceInit);
+    } else {
+        return MA_INVALID_OPERATION;
+    }
+    if (result != MA_SUCCESS) {
+        return result;
+    }
+
+    control_.worker_stop.store(false, std::memory_order_relaxed);
+    decoder_state_.queue_eof.store(false, std::memory_order_relaxed);
+    // 第一首曲目直接以其增益开始，不从 1 渐变过去
+    callback_.gain = targetGain(callback_.current_track.load(std::memory_order_relaxed));
+
+    // 启动前先填满缓冲，避免第一次回调就欠载
+    if (trace_ != nullptr) trace_->begin(StartupTrace::Prefill);
+    fillOnce();
+    if (trace_ != nullptr) trace_->end(StartupTrace::Prefill);
+    worker_ = std::thread(&PlaybackEngine::workerLoop, this);
+    control_.indexer_stop.store(false, std::memory_order_relaxed);
+    indexer_ = std::thread(&PlaybackEngine::indexerLoop, this);
+
+    if (trace_ != nullptr) trace_->begin(StartupTrace::DeviceStart);
+    result = output_->start();
+    if (trace_ != nullptr) trace_->end(StartupTrace::DeviceStart);
+    return result;
+}
+
+ma_result PlaybackEngine::startHeadless() {
+    if (!ring_initialized_ || output_attached_ || worker_.joinable()) {
+        return MA_INVALID_OPERATION;
+    }
+
+    control_.worker_stop.store(false, std::memory_order_relaxed);
+    decoder_state_.queue_eof.store(false, std::memory_order_relaxed);
+    callback_.gain = targetGain(callback_.current_track.load(std::memory_order_relaxed));
+
+    fillOnce();
+    worker_ = std::thread(&PlaybackEngine::workerLoop, this);
+    control_.indexer_stop.store(false, std::memory_order_relaxed);
+    indexer_ = std::thread(&PlaybackEngine::indexerLoop, this);
+    return MA_SUCCESS;
+}
+
+ma_uint32 PlaybackEngine::render(void* output, ma_uint32 frame_count) {
+    if (control_.paused.load(std::memory_order_acquire)) {
+        // 暂停时填充静音
+        memset(output, 0, (size_t)frame_count * bytes_per_frame_);
+        return 0;
+    }
+    if (graph_.initialized()) {
+        callback_.rendered = 0;
+        graph_.read((float*)output, frame_count);
+        return callback_.rendered;
+    }
+    ma_uint32 frames = readStage(output, frame_count);
+    gainStage(output, frame_count);
+    return frames;
+}
+
+ma_uint32 PlaybackEngine::readStage(void* output, ma_uint32 frame_count) {
+    size_t previous = callback_.current_track.load(std::memory_order_relaxed);
+    ma_uint32 frames = read(output, frame_count);
+    size_t current = callback_.current_track.load(std::memory_order_relaxed);
+
+    // 本段内切到了下一首：记下边界之前属于上一首的帧数
+    callback_.gain_previous = previous;
+    callback_.gain_current = current;
+    callback_.gain_split = 0;
+    if (current != previous) {
+        ma_uint64 end = callback_.delivered_frames.load(std::memory_order_relaxed);
+        ma_uint64 start = tracks_[current].start_frame.load(std::memory_order_acquire);
+        if (start <= end && end - start < frames) {
+            callback_.gain_split = frames - (ma_uint32)(end - start);
+        }
+    }
+    return frames;
+}
+
+void PlaybackEngine::gainStage(void* output, ma_uint32 frame_count) {
+    // 边界之前的部分仍按上一首的增益处理，新增益从边界开始渐变；补零部分乘增益后仍是静音
+    ma_uint32 split = std::min(callback_.gain_split, frame_count);
+    if (split > 0) {
+        applyVolume(output, split, targetGain(callback_.gain_previous));
+    }
+    applyVolume((ma_uint8*)output + (size_t)split * bytes_per_frame_, frame_count - split,
+                targetGain(callback_.gain_current));
+}
+
+void PlaybackEngine::sourceNode(void* user_data, float* samples, ma_uint32 frames) {
+    PlaybackEngine* self = (PlaybackEngine*)user_data;
+    self->callback_.rendered += self->readStage(samples, frames);
+}
+
+void PlaybackEngine::gainNode(void* user_data, float* samples, ma_uint32 frames) {
+    ((PlaybackEngine*)user_data)->gainStage(samples, frames);
+}
+
+void PlaybackEngine::eqNode(void* user_data, float* samples, ma_uint32 frames) {
+    ((Equalizer*)user_data)->process(samples, frames);
+}
+
+void PlaybackEngine::limiterNode(void* user_data, float* samples, ma_uint32 frames) {
+    ((Limiter*)user_data)->process(samples, frames);
+}
+
+float PlaybackEngine::targetGain(size_t track) const {
+    float gain = control_.volume.load(std::memory_order_relaxed);
+    if (track < track_count_) {
+        gain *= tracks_[track].replay_gain.load(std::memory_order_relaxed);
+    }
+    return gain;
+}
+
+void PlaybackEngine::applyVolume(void* output, ma_uint32 frame_count, float target) {
+    float gain = callback_.gain;
+    if (gain != target) {
+        // 固定斜率：每帧变化 1 / volume_ramp_frames_，一次调节 5% 约 1 毫秒完成
+        float step = 1.0f / (float)volume_ramp_frames_;
+        ma_uint32 needed = (ma_uint32)std::ceil(std::fabs(target - gain) / step);
+        ma_uint32 ramp = std::min(needed, frame_count);
+        float end = ramp == needed ? target : gain + (target > gain ? step : -step) * (float)ramp;
+        apply_gain_ramp(output, format_, ramp, channels_, gain, end);
+        callback_.gain = gain = end;
+        output = (ma_uint8*)output + (size_t)ramp * bytes_per_frame_;
+        frame_count -= ramp;
+    }
+    apply_gain_ramp(output, format_, frame_count, channels_, gain, gain);
+}
+
+bool PlaybackEngine::waitForData(ma_uint32 frames) {
+    frames = std::min(frames, capacity_frames_);
+    for (;;) {
+        bool queue_eof = decoder_state_.queue_eof.load(std::memory_order_acquire);
+        ma_uint32 available = ma_pcm_rb_available_read(&ring_);
+        if (available >= frames || (queue_eof && available > 0)) {
+            return true;
+        }
+        if (queue_eof) {
+            return false;
+        }
+
+        // 解码线程在缓冲满时会休眠，这里主动唤醒，使其不受实时节奏限制
+        {
+            std::lock_guard<std::mutex> lock(worker_mutex_);
+            control_.worker_wake.store(true, std::memory_order_release);
+        }
+        worker_cv_.notify_one();
+        std::this_thread::yield();
+    }
+}
+
+void PlaybackEngine::stop() {
+    // 还在等待格式的设备线程（open() 失败或没有调用 start()）直接取消
+    if (device_opener_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(opener_mutex_);
+            opener_cancel_ = true;
+        }
+        opener_cv_.notify_one();
+        device_opener_.join();
+    }
+
+    // 共享设备只停止并断开，留给下一个引擎；自己创建的设备随播放结束关闭
+    if (output_attached_) {
+        output_->detach(this);
+        output_attached_ = false;
+    }
+    if (owned_output_ != nullptr) {
+        owned_output_->close();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex_);
+        control_.worker_stop.store(true, std::memory_order_release);
+    }
+    worker_cv_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+    control_.indexer_stop.store(true, std::memory_order_relaxed);
+    if (indexer_.joinable()) {
+        indexer_.join();
+    }
+
+    if (has_current_) {
+        ma_decoder_uninit(&decoders_[current_slot_]);
+        has_current_ = false;
+    }
+    if (has_next_) {
+        ma_decoder_uninit(&decoders_[1 - current_slot_]);
+        has_next_ = false;
+    }
+}
+
+bool PlaybackEngine::deviceStarted() const {
+    return output_attached_ && output_->attachedTo(this) && output_->started();
+}
+
+void PlaybackEngine::indexerLoop() {
+    for (size_t i = 0; i < track_count_; ++i) {
+        if (control_.indexer_stop.load(std::memory_order_relaxed)) {
+            break;
+        }
+
+        // 估算的时长只影响显示、跳转范围和交叉淡入淡出的起点，曲目实际在解码到结尾时才结束
+        DurationEstimate duration;
+        if (probe_duration(tracks_[i].path, &duration) && !duration.exact &&
+            count_duration(tracks_[i].path, control_.indexer_stop, &duration) && duration.sample_rate > 0) {
+            ma_uint64 frames = duration.frames * sample_rate_ / duration.sample_rate;
+            tracks_[i].counted_frames.store(frames);
+            tracks_[i].length_frames.store(frames);
+        }
+        index_seek_table(tracks_[i].path, control_.indexer_stop);
+    }
+}
+
+void PlaybackEngine::workerLoop() {
+    // 缓冲满时休眠约 1/4 预读时长，保证在数据耗尽前及时补充
+    auto idle = std::chrono::milliseconds(std::clamp<ma_uint32>(config_.lookahead_ms / 4, 2, 20));
+
+    while (!control_.worker_stop.load(std::memory_order_acquire)) {
+        ma_uint32 request = control_.seek_request.load(std::memory_order_acquire);
+        if (request != seek_served_) {
+            serveSeek(request);
+            continue;
+        }
+
+        // 队列解码完毕后不退出：缓冲中的尾部播放期间仍可能收到跳转请求
+        bool queue_eof = decoder_state_.queue_eof.load(std::memory_order_acquire);
+        if (!queue_eof) {
+            if (fillOnce() > 0) {
+                seek_settling_ = false;
+                continue;
+            }
+
+            // 跳转后缓冲里还是等待回调丢弃的旧数据，回调每个周期都会腾出空间，短间隔重试
+            if (seek_settling_) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+
+            // 缓冲已满：利用空闲时间预先打开下一首，切换时无需等待文件解析
+            if (has_current_ && !has_next_ && scan_index_ < track_count_) {
+                preopenNext();
+                continue;
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(worker_mutex_);
+        auto wake = [this] {
+            return control_.worker_stop.load(std::memory_order_acquire) ||
+                   control_.seek_request.load(std::memory_order_acquire) != seek_served_ ||
+                   control_.worker_wake.exchange(false, std::memory_order_acq_rel);
+        };
+        if (queue_eof) {
+            worker_cv_.wait(lock, wake);
+        } else {
+            worker_cv_.wait_for(lock, idle, wake);
+        }
+    }
+}
+
+void PlaybackEngine::seek(size_t track, ma_uint64 frame) {
+    if (track >= track_count_) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex_);
+        seek_track_ = track;
+        seek_frame_ = frame;
+        control_.seek_request.fetch_add(1, std::memory_order_acq_rel);
+    }
+    worker_cv_.notify_one();
+}
+
+void PlaybackEngine::serveSeek(ma_uint32 request) {
+    size_t track;
+    ma_uint64 frame;
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex_);
+        track = seek_track_;
+        frame = seek_frame_;
+        request = control_.seek_request.load(std::memory_order_acquire);  // 连续请求只处理最后一次
+    }
+    seek_served_ = request;
+
+    // 放弃当前进度：关闭两个解码器，取消进行中的淡变
+    if (has_current_) {
+        ma_decoder_uninit(&decoders_[current_slot_]);
+        has_current_ = false;
+    }
+    if (has_next_) {
+        ma_decoder_uninit(&decoders_[1 - current_slot_]);
+        has_next_ = false;
+    }
+    in_crossfade_ = false;
+
+    // 从目标曲目开始打开，打不开的曲目跳过
+    size_t index = track;
+    while (index < track_count_ && !openTrack(index, &decoders_[current_slot_])) {
+        ++index;
+    }
+
+    // 新数据从当前写入位置开始；目标之后的曲目重新等待发布起始位置
+    ma_uint64 stream_frame = written_frames_;
+    for (size_t i = track; i < track_count_; ++i) {
+        ma_uint64 boundary = i < index ? stream_frame : UINT64_MAX;
+        tracks_[i].start_frame.store(boundary, std::memory_order_release);
+        tracks_[i].end_frame.store(boundary, std::memory_order_release);
+        tracks_[i].start_offset.store(0, std::memory_order_relaxed);
+    }
+
+    if (index < track_count_) {
+        ma_decoder* decoder = &decoders_[current_slot_];
+        ma_uint64 length = tracks_[index].length_frames.load(std::memory_order_relaxed);
+        frame = index == track ? std::min(frame, length > 0 ? length - 1 : 0) : 0;
+        if (frame > 0) {
+            attach_seek_table(decoder, tracks_[index].path, true, &seek_tables_[current_slot_]);
+            if (ma_decoder_seek_to_pcm_frame(decoder, frame) != MA_SUCCESS) {
+                frame = 0;
+                ma_decoder_seek_to_pcm_frame(decoder, 0);
+            }
+        }
+        has_current_ = true;
+        decode_index_ = index;
+        scan_index_ = index + 1;
+        tracks_[index].start_offset.store(frame, std::memory_order_relaxed);
+        tracks_[index].start_frame.store(stream_frame, std::memory_order_release);
+    } else {
+        // 目标之后没有可用的曲目：队列到此结束
+        decode_index_ = track_count_ - 1;
+        scan_index_ = track_count_;
+        index = track_count_ - 1;
+    }
+    decoder_state_.queue_eof.store(false, std::memory_order_release);
+
+    decoder_state_.seek_stream_frame.store(stream_frame, std::memory_order_relaxed);
+    decoder_state_.seek_track.store(index, std::memory_order_relaxed);
+    decoder_state_.seek_done.store(request, std::memory_order_release);
+    seek_settling_ = true;
+}
+
+void PlaybackEngine::setVolume(float volume) {
+    volume_ = std::clamp(volume, 0.0f, 1.0f);
+    control_.volume.store(volume_, std::memory_order_relaxed);
+}
+
+void PlaybackEngine::setTrackLoudness(size_t index, const LoudnessInfo& loudness) {
+    if (index < track_count_) {
+        tracks_[index].replay_gain.store(replay_gain_linear(loudness, config_.replay_gain), std::memory_order_relaxed);
+    }
+}
+
+ma_uint32 PlaybackEngine::outputRender(void* user_data, void* output, ma_uint32 frame_count) {
+    PlaybackEngine* engine = (PlaybackEngine*)user_data;
+    ma_uint32 frames = engine->render(output, frame_count);
+    if (frames > 0 && engine->trace_ != nullptr) {
+        engine->trace_->markFirstSample();
+    }
+    return frames;
+}
+
+void PlaybackEngine::outputStopped(void* user_data) {
+    PlaybackEngine* engine = (PlaybackEngine*)user_data;
+    if (engine->events_ != nullptr) {
+        engine->events_->notify(EVENT_DEVICE_STOPPED);
+    }
+}
+
+ma_uint32 PlaybackEngine::read(void* output, ma_uint32 frame_count) {
+    ma_uint8* out = (ma_uint8*)output;
+    ma_uint32 total = 0;
+
+    // 跳转交接：缓冲中新位置起点之前的数据都已过时，直接丢弃（只移动读指针）
+    ma_uint64 position = callback_.delivered_frames.load(std::memory_order_relaxed);
+    size_t previous = callback_.current_track.load(std::memory_order_relaxed);
+    size_t index = previous;
+    ma_uint32 request = control_.seek_request.load(std::memory_order_acquire);
+    if (request != callback_.seek_applied) {
+        // 先读可读量再读完成序号：序号未更新时，读到的数据一定都写于跳转之前
+        ma_uint32 available = ma_pcm_rb_available_read(&ring_);
+        if (decoder_state_.seek_done.load(std::memory_order_acquire) != request) {
+            // 解码线程还在重新定位：丢弃全部旧数据腾出空间，本周期输出静音
+            ma_pcm_rb_seek_read(&ring_, available);
+            ma_uint32 sequence = callback_.sequence.load(std::memory_order_relaxed);
+            callback_.sequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            callback_.delivered_frames.store(position + available, std::memory_order_relaxed);
+            callback_.sequence.store(sequence + 2, std::memory_order_release);
+            memset(out, 0, (size_t)frame_count * bytes_per_frame_);
+            return 0;
+        }
+
+        ma_uint64 target = decoder_state_.seek_stream_frame.load(std::memory_order_relaxed);
+        available = ma_pcm_rb_available_read(&ring_);
+        ma_uint32 stale = (ma_uint32)std::min<ma_uint64>(target - position, available);
+        ma_pcm_rb_seek_read(&ring_, stale);
+        position += stale;
+        index = decoder_state_.seek_track.load(std::memory_order_relaxed);
+        callback_.seek_applied = request;
+        callback_.seek_position = target;
+        callback_.end_notified = false;
+    }
+
+    bool queue_eof = decoder_state_.queue_eof.load(std::memory_order_acquire);
+
+    // 最低水位只在解码未结束时统计，收尾阶段和刚跳转后缓冲自然是空的
+    ma_uint32 available = ma_pcm_rb_available_read(&ring_);
+    if (!queue_eof && position != callback_.seek_position &&
+        available < callback_.min_fill_frames.load(std::memory_order_relaxed)) {
+        callback_.min_fill_frames.store(available, std::memory_order_relaxed);
+    }
+
+    for (int i = 0; i < 2 && total < frame_count; ++i) {
+        ma_uint32 frames = frame_count - total;
+        void* buffer;
+        if (ma_pcm_rb_acquire_read(&ring_, &frames, &buffer) != MA_SUCCESS || frames == 0) {
+            break;
+        }
+        memcpy(out + (size_t)total * bytes_per_frame_, buffer, (size_t)frames * bytes_per_frame_);
+        ma_pcm_rb_commit_read(&ring_, frames);
+        total += frames;
+    }
+
+    // 播放位置按实际交付的帧数推进，补零的部分不计入
+    position += total;
+
+    // 越过曲目边界时推进当前曲目
+    while (index + 1 < track_count_) {
+        ma_uint64 start = tracks_[index + 1].start_frame.load(std::memory_order_acquire);
+        if (start == UINT64_MAX || start > position) {
+            break;
+        }
+        ++index;
+    }
+
+    ma_uint64 start = tracks_[index].start_frame.load(std::memory_order_acquire);
+    ma_uint64 track_frame = (position > start ? position - start : 0) +
+                            tracks_[index].start_offset.load(std::memory_order_relaxed);
+
+    // 序列锁写端：序号为奇数期间 UI 端读到的数据会被丢弃重试
+    ma_uint32 sequence = callback_.sequence.load(std::memory_order_relaxed);
+    callback_.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    callback_.delivered_frames.store(position, std::memory_order_relaxed);
+    callback_.current_track.store(index, std::memory_order_relaxed);
+    callback_.track_frame.store(track_frame, std::memory_order_relaxed);
+    callback_.sequence.store(sequence + 2, std::memory_order_release);
+
+    if (index != previous && events_ != nullptr) {
+        events_->notify(EVENT_TRACK_CHANGED);
+    }
+
+    if (total < frame_count) {
+        ma_uint32 missing = frame_count - total;
+        memset(out + (size_t)total * bytes_per_frame_, 0, (size_t)missing * bytes_per_frame_);
+
+        // 队列解码结束后的补零是正常收尾，不计为欠载
+        if (queue_eof) {
+            if (!callback_.end_notified && events_ != nullptr) {
+                events_->notify(EVENT_QUEUE_END);
+            }
+            callback_.end_notified = true;
+        } else if (position != callback_.seek_position) {
+            // 跳转后新数据尚未到达的补零不计为欠载
+            callback_.underruns.fetch_add(1, std::memory_order_relaxed);
+            callback_.underrun_frames.fetch_add(missing, std::memory_order_relaxed);
+
+            // 恰好停在曲目边界上的补零就是曲间间隙
+            if (index + 1 < track_count_ &&
+                tracks_[index].end_frame.load(std::memory_order_acquire) == position) {
+                tracks_[index + 1].gap_frames.fetch_add(missing, std::memory_order_relaxed);
+            } else if (index > 0 && start == position) {
+                tracks_[index].gap_frames.fetch_add(missing, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    return total;
+}
+
+PlaybackPosition PlaybackEngine::position() const {
+    PlaybackPosition result;
+    for (;;) {
+        ma_uint32 before = callback_.sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            continue;  // 回调正在写入
+        }
+        result.delivered_frames = callback_.delivered_frames.load(std::memory_order_relaxed);
+        result.track = callback_.current_track.load(std::memory_order_relaxed);
+        result.track_frame = callback_.track_frame.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (callback_.sequence.load(std::memory_order_relaxed) == before) {
+            return result;
+        }
+    }
+}
+
+bool PlaybackEngine::finished() const {
+    // 跳转请求尚未处理完时 queue_eof 还是旧的（回调已丢弃缓冲，解码线程还没重新定位），不算结束
+    if (decoder_state_.seek_done.load(std::memory_order_acquire) !=
+        control_.seek_request.load(std::memory_order_acquire)) {
+        return false;
+    }
+    return decoder_state_.queue_eof.load(std::memory_order_acquire) &&
+           ma_pcm_rb_available_read(const_cast<ma_pcm_rb*>(&ring_)) == 0;
+}
+
+PlaybackBufferStats PlaybackEngine::stats() const {
+    PlaybackBufferStats s;
+    s.capacity_frames = capacity_frames_;
+    s.fill_frames = ring_initialized_ ? ma_pcm_rb_available_read(const_cast<ma_pcm_rb*>(&ring_)) : 0;
+    s.min_fill_frames = callback_.min_fill_frames.load(std::memory_order_relaxed);
+    s.underruns = callback_.underruns.load(std::memory_order_relaxed);
+    s.underrun_frames = callback_.underrun_frames.load(std::memory_order_relaxed);
+    s.transitions = (ma_uint32)position().track;
+    s.gap_frames = 0;
+    s.max_gap_frames = 0;
+    for (size_t i = 1; i < track_count_; ++i) {
+        ma_uint64 gap = tracks_[i].gap_frames.load(std::memory_order_relaxed);
+        s.gap_frames += gap;
+        s.max_gap_frames = std::max(s.max_gap_frames, gap);
+    }
+    return s;
+}
@@ -0,0 +1,391 @@
+#ifndef PLAYBACK_ENGINE_H
+#define PLAYBACK_ENGINE_H
+
+#include "third-party/miniaudio.h"
+#include "audio_output.h"
+#include "eq.h"
+#include "processing_graph.h"
+#include "loudness.h"
+#include "mmap_vfs.h"
+#include "seek_index.h"
+#include "startup_trace.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class EventPipe;
+
+// 默认预读时长（毫秒）
+constexpr ma_uint32 DEFAULT_LOOKAHEAD_MS = 250;
+
+// 缓存行大小：按写入线程拆分共享状态，避免伪共享
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+// 交叉淡入淡出的最大时长（毫秒）
+constexpr ma_uint32 MAX_CROSSFADE_MS = 10000;
+
+// 交叉淡入淡出每次混音的最大帧数
+constexpr ma_uint32 CROSSFADE_CHUNK_FRAMES = 1024;
+
+// 音量从 0 变到 1 所需的渐变时长（毫秒），避免调节音量时产生爆音
+constexpr ma_uint32 VOLUME_RAMP_MS = 20;
+
+// 引擎配置
+struct PlaybackEngineConfig {
+    ma_uint32 lookahead_ms = DEFAULT_LOOKAHEAD_MS;  // 解码预读时长
+    ma_uint32 crossfade_ms = 0;                     // 曲目间交叉淡入淡出时长，0 表示无缝直接衔接
+    IoMode io_mode = IoMode::Stdio;                 // 解码器读取文件的方式
+    DeviceReuse device_reuse = DeviceReuse::Auto;   // 共享设备格式不同时重新打开还是转换
+    AudioOutputFormat output_format;                // 固定的设备格式，未指定的部分跟随第一首曲目
+    ResamplerQuality resampler = ResamplerQuality::Medium;  // 解码线程中采样率转换的质量
+    ReplayGainMode replay_gain = ReplayGainMode::Off;        // 按 setTrackLoudness() 提供的分析结果应用增益
+    bool eq = false;                                // 在回调中加入参数均衡（采样格式固定为 f32）
+    bool eq_enabled = true;                         // 均衡的初始开关，关闭时仍可随时打开
+    EqSettings eq_settings;
+    bool limiter = false;                           // 在处理图末尾加入峰值限幅（采样格式固定为 f32）
+    const ma_allocation_callbacks* allocation_callbacks = nullptr;  // 解码器和缓冲的内存分配（nullptr 使用默认）
+};
+
+// 预读缓冲的统计信息，用于按主机调整缓冲大小
+struct PlaybackBufferStats {
+    ma_uint32 capacity_frames;   // 环形缓冲容量
+    ma_uint32 fill_frames;       // 当前填充量
+    ma_uint32 min_fill_frames;   // 播放期间的最低水位
+    ma_uint64 underruns;         // 回调中数据不足的次数
+    ma_uint64 underrun_frames;   // 因数据不足补零的帧数
+    ma_uint32 transitions;       // 已完成的曲目切换次数
+    ma_uint64 gap_frames;        // 曲目切换处补零的总帧数（无缝播放时应为 0）
+    ma_uint64 max_gap_frames;    // 单次切换的最大间隙
+};
+
+// 播放位置快照（回调线程发布，UI 线程读取）
+struct PlaybackPosition {
+    size_t track;                // 当前正在输出的曲目
+    ma_uint64 track_frame;       // 曲目内位置（帧）
+    ma_uint64 delivered_frames;  // 已从缓冲取出的总帧数（不含补零，含跳转时丢弃的旧数据）
+};
+
+// 回调线程写入的状态：播放位置用序列锁 (seqlock) 发布，回调端无等待，
+// UI 端读到不一致的中间状态时重试，保证曲目索引与位置总是成对的
+struct alignas(CACHE_LINE_SIZE) CallbackState {
+    std::atomic<ma_uint32> sequence{0};
+    std::atomic<ma_uint64> delivered_frames{0};
+    std::atomic<size_t> current_track{0};
+    std::atomic<ma_uint64> track_frame{0};
+
+    // 统计计数
+    std::atomic<ma_uint32> min_fill_frames{0};
+    std::atomic<ma_uint64> underruns{0};
+    std::atomic<ma_uint64> underrun_frames{0};
+
+    bool end_notified = false;  // 队列结束事件只发送一次（回调线程独占）
+    float gain = 1.0f;          // 当前音量增益（回调线程独占），按固定斜率逼近 ControlState::volume
+    size_t gain_previous = 0;   // 最近一段数据开头所属的曲目（回调线程独占，readStage 写、gainStage 读）
+    size_t gain_current = 0;    // 最近一段数据结尾所属的曲目
+    ma_uint32 gain_split = 0;   // 最近一段数据中属于 gain_previous 的帧数
+    ma_uint32 rendered = 0;     // 本次 render() 从缓冲取出的帧数（处理图中分块累计）
+    ma_uint32 seek_applied = 0;           // 已生效的跳转请求序号（回调线程独占）
+    ma_uint64 seek_position = UINT64_MAX; // 最近一次跳转在输出流中的位置（回调线程独占）
+};
+
+// UI 线程写入的控制状态
+struct alignas(CACHE_LINE_SIZE) ControlState {
+    std::atomic<bool> paused{false};
+    std::atomic<float> volume{1.0f};        // 目标音量，回调中渐变过去
+    std::atomic<bool> worker_stop{false};
+    std::atomic<bool> worker_wake{false};  // 无设备驱动时请求解码线程立即补充缓冲
+    std::atomic<bool> indexer_stop{false}; // 中止后台跳转索引扫描
+    std::atomic<ma_uint32> seek_request{0}; // 跳转请求序号，每次请求加一
+};
+
+// 解码线程写入的状态
+struct alignas(CACHE_LINE_SIZE) DecoderState {
+    std::atomic<bool> queue_eof{false};
+
+    // 跳转交接：解码线程重新定位后发布新数据在输出流中的起点，最后写入序号
+    std::atomic<ma_uint64> seek_stream_frame{0};
+    std::atomic<size_t> seek_track{0};
+    std::atomic<ma_uint32> seek_done{0};
+};
+
+// 曲目状态（解码线程写，回调和 UI 线程读）
+struct TrackSlot {
+    std::string path;
+    std::atomic<ma_uint64> start_frame{UINT64_MAX};  // 在输出流中的起始位置
+    std::atomic<ma_uint64> start_offset{0};          // 从曲目内第几帧开始输出（跳转位置）
+    std::atomic<ma_uint64> end_frame{UINT64_MAX};    // 在输出流中的结束位置
+    std::atomic<ma_uint64> length_frames{0};         // 时长（输出采样率下的帧数）
+    std::atomic<ma_uint64> counted_frames{0};        // 后台线程统计出的精确时长，0 表示没有统计
+    std::atomic<int> result{MA_SUCCESS};             // 打开失败时的错误码
+    std::atomic<ma_uint64> gap_frames{0};            // 切入本曲目前补零的帧数
+    std::atomic<float> replay_gain{1.0f};            // ReplayGain 增益（线性），与音量相乘
+};
+
+// 持久播放引擎：
+//   解码线程 -> 无锁 SPSC 环形缓冲 (ma_pcm_rb) -> 设备回调
+// 整个播放队列只打开一次设备。解码线程在当前曲目播放期间预先打开下一首，
+// 并把两首曲目的 PCM 首尾相接写入同一个缓冲，因此切换发生在精确的帧边界上。
+// 开启交叉淡入淡出时，两个解码器的重叠部分在解码线程中混音后再写入缓冲。
+// 设备回调只做内存拷贝和增益、均衡等处理，不在实时线程上解析文件或读磁盘；
+// f32 输出时这些处理作为 ma_node_graph 的节点串联（见 ProcessingGraph）。
+class PlaybackEngine {
+public:
+    PlaybackEngine();
+    ~PlaybackEngine();
+
+    PlaybackEngine(const PlaybackEngine&) = delete;
+    PlaybackEngine& operator=(const PlaybackEngine&) = delete;
+
+    // 在 open() 之前调用：后台线程立即初始化音频后端，与打开解码器并行；
+    // open() 确定输出格式后该线程紧接着打开设备，start() 只需等它完成再启动设备。
+    // 不调用时 start() 按原来的顺序同步打开设备
+    void prepareDevice();
+
+    // 使用调用方持有的播放设备（在 prepareDevice() / open() 之前调用）。多个引擎先后共用同一个
+    // AudioOutput 时，格式相同的设备直接沿用，stop() 只停止设备不关闭。不设置时引擎自己打开设备
+    void setOutput(AudioOutput* output) { output_ = output; }
+
+    // 设置启动耗时跟踪（在 prepareDevice() / open() 之前调用，trace 需在引擎停止前保持有效）
+    void setStartupTrace(StartupTrace* trace) { trace_ = trace; }
+
+    // 设置播放队列并打开第一首曲目；设备格式取第一首曲目的原始格式
+    // （交叉淡入淡出、参数均衡或限幅时固定为 f32，config.output_format 指定的部分按指定值），
+    // 后续曲目由解码器在解码线程中转换到该格式，设备回调不做转换。
+    // 共享设备已按其他格式打开时按 device_reuse 策略决定沿用设备格式还是重新打开
+    ma_result open(const std::vector<std::string>& tracks, const PlaybackEngineConfig& config);
+
+    // 第一首曲目的跳转（帧），需在 start() 之前调用。
+    // MP3 没有跳转索引时先扫描帧头建立索引（只在第一次跳转时发生），之后的跳转从最近的跳转点开始
+    ma_result seekFirstTrack(ma_uint64 frame);
+
+    // 预填充缓冲、启动解码线程并打开播放设备（已由 prepareDevice() 打开时等待其完成）
+    ma_result start();
+
+    // 不打开播放设备，只预填充缓冲并启动解码线程，由调用方通过 render() 驱动（基准测试用）
+    ma_result startHeadless();
+
+    // 与设备回调完全相同的输出路径：从缓冲取出 frame_count 帧，不足部分补零
+    ma_uint32 render(void* output, ma_uint32 frame_count);
+
+    // 无设备驱动时等待缓冲中至少有 frames 帧（队列解码完毕时有多少算多少），
+    // 队列已全部输出时返回 false
+    bool waitForData(ma_uint32 frames);
+
+    // 停止设备和解码线程（可重复调用）
+    void stop();
+
+    // 跳转到队列中任意曲目的任意位置（start() 之后由 UI 线程调用，连续请求时以最后一次为准）。
+    // 解码线程被立即唤醒并重新定位，回调发现请求后丢弃缓冲中的旧数据并输出静音，
+    // 新位置的数据就绪后即开始输出，通常在一个设备周期内完成。frame 超出曲目长度时停在曲目末尾
+    void seek(size_t track, ma_uint64 frame);
+
+    // 音量（0 ~ 1）：在 render() 中用软件增益实现，变化时按 VOLUME_RAMP_MS 的斜率渐变
+    void setVolume(float volume);
+    float volume() const { return volume_; }
+
+    // 设置第 index 首曲目的响度分析结果（open() 之后调用，可在播放中更新）：
+    // 按 config.replay_gain 的模式换算为增益，在回调中与音量一起应用。
+    // 增益从曲目边界开始按音量的斜率渐变到新值
+    void setTrackLoudness(size_t index, const LoudnessInfo& loudness);
+
+    // 参数均衡（config.eq 启用时可用）：控制线程调用，新参数和开关在回调中交叉淡变生效，不会爆音
+    void setEqSettings(const EqSettings& settings) { eq_.setSettings(settings); }
+    void setEqEnabled(bool enabled) { eq_.setEnabled(enabled); }
+    bool eqEnabled() const { return eq_.enabled(); }
+    bool eqAvailable() const { return eq_.configured(); }
+
+    // f32 输出时回调经过的处理图（source → gain → eq → limiter）及各节点耗时
+    bool processingGraphActive() const { return graph_.initialized(); }
+    ProcessingStats processingStats() const { return graph_.stats(); }
+    ma_uint64 limitedFrames() const { return limiter_.limitedFrames(); }
+
+    // 设置事件管道：曲目切换、队列结束、设备停止时写入事件唤醒控制循环
+    void setEventPipe(EventPipe* events) { events_ = events; }
+
+    void setPaused(bool paused) { control_.paused.store(paused, std::memory_order_release); }
+    bool paused() const { return control_.paused.load(std::memory_order_acquire); }
+
+    // 队列全部解码完毕且缓冲已被取空（有尚未处理完的跳转请求时为 false）
+    bool finished() const;
+
+    // 当前播放位置的一致快照：曲目索引、曲目内位置和已交付帧数
+    PlaybackPosition position() const;
+
+    size_t trackCount() const { return track_count_; }
+    const TrackSlot& track(size_t index) const { return tracks_[index]; }
+
+    // 第一首曲目的原始格式（与 format() 等不同时由解码线程转换）
+    AudioOutputFormat sourceFormat() const { return source_format_; }
+
+    ma_format format() const { return format_; }
+    ma_uint32 channels() const { return channels_; }
+    ma_uint32 sampleRate() const { return sample_rate_; }
+    ma_uint32 lookaheadMs() const { return config_.lookahead_ms; }
+    ma_uint32 crossfadeMs() const { return config_.crossfade_ms; }
+    IoMode ioMode() const { return config_.io_mode; }
+
+    bool deviceStarted() const;
+
+    PlaybackBufferStats stats() const;
+
+    // 设备打开/沿用次数（共享设备时是整个会话的累计值）
+    AudioOutputStats deviceStats() const { return output_ != nullptr ? output_->stats() : AudioOutputStats(); }
+
+private:
+    // AudioOutput 转发的设备回调和停止通知
+    static ma_uint32 outputRender(void* user_data, void* output, ma_uint32 frame_count);
+    static void outputStopped(void* user_data);
+
+    void workerLoop();
+
+    // 解码线程执行跳转请求：关闭当前解码器，从目标曲目重新打开并定位，然后发布新数据的起点
+    void serveSeek(ma_uint32 request);
+
+    // 后台索引线程：按队列顺序为只有估算时长的曲目统计精确时长，
+    // 为还没有跳转索引的 MP3 扫描帧头，结果写入持久化索引
+    void indexerLoop();
+
+    // 按输出格式和配置的重采样质量生成解码器配置
+    ma_decoder_config decoderConfig(const AudioOutputFormat& format) const;
+
+    // 按配置的读取方式初始化解码器
+    ma_result initDecoder(const std::string& path, const ma_decoder_config* config, ma_decoder* decoder);
+
+    // 为刚打开的曲目写入时长。需要扫描整个文件才能得到时先用文件头估算，
+    // 不在打开曲目时阻塞，精确值由后台索引线程补上
+    ma_result trackLength(size_t index, ma_decoder* decoder);
+
+    // 按引擎输出格式打开指定曲目，失败时记录错误码
+    bool openTrack(size_t index, ma_decoder* decoder);
+
+    // 没有设置共享设备时创建引擎自己的设备
+    void ensureOutput();
+
+    // 按输出格式打开（或沿用）设备并把回调接到本引擎
+    ma_result attachOutput();
+
+    // prepareDevice() 的线程：初始化后端上下文，等 open() 发布格式后打开设备
+    void deviceOpenerLoop();
+
+    // open() 成功后通知设备线程输出格式已确定
+    void publishDeviceFormat();
+
+    // 预先打开下一首曲目（放在缓冲已满的空闲时间里做）
+    void preopenNext();
+
+    // 发布下一首曲目在输出流中的起始位置（中间打开失败的曲目一并标记）
+    void publishNextStart();
+
+    // 切换到下一首可用曲目（优先使用预先打开的解码器），没有则返回 false
+    bool advanceTrack();
+
+    // 当前曲目剩余的帧数（按时长估算）
+    ma_uint64 remainingFrames();
+
+    // 交叉淡入淡出：当前曲目尾部与下一首头部混音后写入缓冲
+    ma_uint32 fillCrossfade(float* buffer, ma_uint32 frames);
+
+    // 解码一批数据写入缓冲，返回写入的帧数
+    ma_uint32 fillOnce();
+
+    // 设备回调调用：从缓冲中取出最多 frame_count 帧，不足部分补零
+    ma_uint32 read(void* output, ma_uint32 frame_count);
+
+    // 设备回调调用：按目标增益处理输出，目标变化时从当前增益线性渐变过去
+    void applyVolume(void* output, ma_uint32 frame_count, float target);
+
+    // 回调的两个基本阶段：取出数据并记录本段内的曲目边界，然后按边界两侧曲目的增益处理。
+    // 整数格式直接依次调用，f32 时作为处理图的 source 和 gain 节点
+    ma_uint32 readStage(void* output, ma_uint32 frame_count);
+    void gainStage(void* output, ma_uint32 frame_count);
+
+    // 处理图节点的回调
+    static void sourceNode(void* user_data, float* samples, ma_uint32 frames);
+    static void gainNode(void* user_data, float* samples, ma_uint32 frames);
+    static void eqNode(void* user_data, float* samples, ma_uint32 frames);
+    static void limiterNode(void* user_data, float* samples, ma_uint32 frames);
+
+    // 目标增益：音量乘以指定曲目的 ReplayGain 增益
+    float targetGain(size_t track) const;
+
+    std::unique_ptr<TrackSlot[]> tracks_;
+    size_t track_count_;
+
+    // 解码线程独占的状态；两个解码器槽位轮流作为当前曲目和下一首
+    // （ma_decoder 内部持有指向自身的指针，不能按值交换）
+    ma_decoder decoders_[2];
+    SeekTable seek_tables_[2];  // 绑定到对应解码器的 MP3 跳转表
+    int current_slot_;
+    bool has_current_;
+    bool has_next_;
+    size_t decode_index_;       // 正在解码的曲目
+    size_t next_index_;         // 预先打开的曲目
+    size_t scan_index_;         // 下一个尝试打开的曲目
+    ma_uint64 written_frames_;  // 已写入缓冲的总帧数
+
+    ma_format format_;
+    ma_uint32 channels_;
+    ma_uint32 sample_rate_;
+    float volume_;
+
+    PlaybackEngineConfig config_;
+
+    // 交叉淡入淡出状态（解码线程独占，缓冲在 open() 中预先分配）
+    ma_uint32 crossfade_frames_;     // 配置的淡变长度
+    ma_uint32 crossfade_length_;     // 本次淡变的实际长度
+    ma_uint32 crossfade_position_;   // 本次淡变已处理的帧数
+    bool in_crossfade_;
+    std::vector<float> fade_out_;
+    std::vector<float> fade_in_;
+    std::vector<float> crossfade_scratch_;
+
+    ma_pcm_rb ring_;
+    bool ring_initialized_;
+    ma_uint32 bytes_per_frame_;
+    ma_uint32 capacity_frames_;
+    ma_uint32 volume_ramp_frames_;  // 音量完整渐变一次（0 → 1）的帧数
+    Equalizer eq_;
+    Limiter limiter_;
+    ProcessingGraph graph_;         // f32 输出时的回调处理图（open() 中构建）
+
+    // 播放设备：共享的或引擎自己创建的（owned_output_）
+    AudioOutput* output_;
+    std::unique_ptr<AudioOutput> owned_output_;
+    bool output_attached_;
+    AudioOutputFormat source_format_;  // 第一首曲目的原始格式
+
+    // 启动加速：后端上下文与设备在单独的线程中初始化（状态受 opener_mutex_ 保护）
+    std::thread device_opener_;
+    std::mutex opener_mutex_;
+    std::condition_variable opener_cv_;
+    bool opener_format_ready_;
+    bool opener_cancel_;
+    ma_result opener_result_;
+
+    StartupTrace* trace_;
+
+    // 跳转目标（受 worker_mutex_ 保护）以及解码线程已处理的请求序号
+    size_t seek_track_;
+    ma_uint64 seek_frame_;
+    ma_uint32 seek_served_;
+    bool seek_settling_;  // 跳转后缓冲还没腾出空间，解码线程短间隔重试
+
+    std::thread worker_;
+    std::thread indexer_;
+    std::mutex worker_mutex_;
+    std::condition_variable worker_cv_;
+
+    EventPipe* events_;
+
+    // 跨线程共享的状态，按写入线程分到不同缓存行
+    CallbackState callback_;
+    ControlState control_;
+    DecoderState decoder_state_;
+};
+
+#endif // PLAYBACK_ENGINE_H
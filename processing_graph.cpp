@@ -0,0 +1,226 @@
+#include "processing_graph.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+const char* processing_stage_name(ProcessingStageType type) {
+    switch (type) {
+    case ProcessingStageType::Gain:
+        return "gain";
+    case ProcessingStageType::Eq:
+        return "eq";
+    case ProcessingStageType::Limiter:
+        return "limiter";
+    default:
+        return "source";
+    }
+}
+
+bool ProcessingGraphConfig::add(ProcessingStageType type, void* user_data, void (*process)(void*, float*, ma_uint32)) {
+    if (stage_count >= MAX_PROCESSING_STAGES) {
+        return false;
+    }
+    ProcessingStage& stage = stages[stage_count++];
+    stage.type = type;
+    stage.user_data = user_data;
+    stage.process = process;
+    return true;
+}
+
+// Source 没有输入，其余阶段一进一出；输入输出帧数相同，由 miniaudio 按节点缓存分块调用
+const ma_node_vtable ProcessingGraph::source_vtable_ = {&ProcessingGraph::onProcess, nullptr, 0, 1, 0};
+const ma_node_vtable ProcessingGraph::filter_vtable_ = {&ProcessingGraph::onProcess, nullptr, 1, 1, 0};
+
+std::string format_processing_stats(const ProcessingStats& stats) {
+    if (stats.graph.calls == 0) {
+        return "Processing: no callbacks yet";
+    }
+    // 节点按块调用，按设备周期（read() 次数）平均更直观
+    double callbacks = (double)stats.graph.calls;
+    std::string text = "Processing:";
+    double stages_us = 0.0;
+    char buf[96];
+    for (ma_uint32 i = 0; i < stats.stage_count; ++i) {
+        const ProcessingTiming& timing = stats.stages[i];
+        stages_us += timing.total_us;
+        snprintf(buf, sizeof(buf), "%s %s %.2f us (max %.1f)", i > 0 ? "," : "", processing_stage_name(stats.types[i]),
+                 timing.total_us / callbacks, timing.max_us);
+        text += buf;
+    }
+    snprintf(buf, sizeof(buf), " per callback, graph total %.2f us (overhead %.2f us, max %.1f us), %llu callbacks",
+             stats.graph.total_us / callbacks, std::max(0.0, stats.graph.total_us - stages_us) / callbacks,
+             stats.graph.max_us, (unsigned long long)stats.graph.calls);
+    return text + buf;
+}
+
+void ProcessingGraph::Timing::record(ma_uint64 ns, ma_uint32 frame_count) {
+    // 只有回调线程写入，不需要读-改-写原子操作
+    calls.store(calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    frames.store(frames.load(std::memory_order_relaxed) + frame_count, std::memory_order_relaxed);
+    total_ns.store(total_ns.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+    if (ns > max_ns.load(std::memory_order_relaxed)) {
+        max_ns.store(ns, std::memory_order_relaxed);
+    }
+}
+
+ProcessingTiming ProcessingGraph::Timing::snapshot() const {
+    ProcessingTiming timing;
+    timing.calls = calls.load(std::memory_order_relaxed);
+    timing.frames = frames.load(std::memory_order_relaxed);
+    timing.total_us = total_ns.load(std::memory_order_relaxed) / 1000.0;
+    timing.max_us = max_ns.load(std::memory_order_relaxed) / 1000.0;
+    return timing;
+}
+
+ProcessingGraph::ProcessingGraph()
+    : allocation_callbacks_(),
+      has_allocation_callbacks_(false),
+      node_count_(0),
+      initialized_(false) {
+}
+
+ProcessingGraph::~ProcessingGraph() {
+    uninit();
+}
+
+ma_result ProcessingGraph::init(const ProcessingGraphConfig& config,
+                                const ma_allocation_callbacks* allocation_callbacks) {
+    if (initialized_ || config.channels == 0 || config.stage_count == 0 ||
+        config.stages[0].type != ProcessingStageType::Source) {
+        return MA_INVALID_ARGS;
+    }
+    config_ = config;
+    has_allocation_callbacks_ = allocation_callbacks != nullptr;
+    if (has_allocation_callbacks_) {
+        allocation_callbacks_ = *allocation_callbacks;
+    }
+    const ma_allocation_callbacks* callbacks = has_allocation_callbacks_ ? &allocation_callbacks_ : nullptr;
+
+    ma_node_graph_config graph_config = ma_node_graph_config_init(config.channels);
+    ma_result result = ma_node_graph_init(&graph_config, callbacks, &graph_);
+    if (result != MA_SUCCESS) {
+        return result;
+    }
+    initialized_ = true;
+
+    ma_uint32 channels[1] = {config.channels};
+    for (ma_uint32 i = 0; i < config.stage_count; ++i) {
+        ma_node_config node_config = ma_node_config_init();
+        node_config.vtable = i == 0 ? &source_vtable_ : &filter_vtable_;
+        node_config.pInputChannels = channels;
+        node_config.pOutputChannels = channels;
+        nodes_[i].graph = this;
+        nodes_[i].index = i;
+        result = ma_node_init(&graph_, &node_config, callbacks, &nodes_[i]);
+        if (result != MA_SUCCESS) {
+            uninit();
+            return result;
+        }
+        node_count_ = i + 1;
+        if (i > 0) {
+            ma_node_attach_output_bus(&nodes_[i - 1], 0, &nodes_[i], 0);
+        }
+    }
+    ma_node_attach_output_bus(&nodes_[config.stage_count - 1], 0, ma_node_graph_get_endpoint(&graph_), 0);
+    return MA_SUCCESS;
+}
+
+void ProcessingGraph::uninit() {
+    if (!initialized_) {
+        return;
+    }
+    const ma_allocation_callbacks* callbacks = has_allocation_callbacks_ ? &allocation_callbacks_ : nullptr;
+    // 从终点一侧开始拆，避免拆除过程中还有节点连在已释放的节点上
+    while (node_count_ > 0) {
+        ma_node_uninit(&nodes_[--node_count_], callbacks);
+    }
+    ma_node_graph_uninit(&graph_, callbacks);
+    initialized_ = false;
+}
+
+void ProcessingGraph::read(float* output, ma_uint32 frames) {
+    auto begin = std::chrono::steady_clock::now();
+    ma_node_graph_read_pcm_frames(&graph_, output, frames, nullptr);
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+    graph_timing_.record((ma_uint64)ns, frames);
+}
+
+ProcessingStats ProcessingGraph::stats() const {
+    ProcessingStats stats;
+    stats.graph = graph_timing_.snapshot();
+    stats.stage_count = initialized_ ? config_.stage_count : 0;
+    for (ma_uint32 i = 0; i < stats.stage_count; ++i) {
+        stats.types[i] = config_.stages[i].type;
+        stats.stages[i] = stage_timing_[i].snapshot();
+    }
+    return stats;
+}
+
+void ProcessingGraph::onProcess(ma_node* node, const float** frames_in, ma_uint32* frame_count_in, float** frames_out,
+                                ma_uint32* frame_count_out) {
+    StageNode* stage_node = (StageNode*)node;
+    ProcessingGraph* self = stage_node->graph;
+    const ProcessingStage& stage = self->config_.stages[stage_node->index];
+
+    auto begin = std::chrono::steady_clock::now();
+    ma_uint32 frames = *frame_count_out;
+    if (frames_in != nullptr) {
+        // 输入在节点缓存中，输出直接写到下游的缓冲：先拷过去再原地处理
+        frames = std::min(*frame_count_in, *frame_count_out);
+        if (frames_out[0] != frames_in[0]) {
+            ma_copy_pcm_frames(frames_out[0], frames_in[0], frames, ma_format_f32, self->config_.channels);
+        }
+        *frame_count_in = frames;
+    }
+    stage.process(stage.user_data, frames_out[0], frames);
+    *frame_count_out = frames;
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+    self->stage_timing_[stage_node->index].record((ma_uint64)ns, frames);
+}
+
+Limiter::Limiter()
+    : channels_(0),
+      ceiling_(1.0f),
+      release_(0.0f),
+      gain_(1.0f),
+      limited_frames_(0) {
+}
+
+void Limiter::configure(ma_uint32 sample_rate, ma_uint32 channels) {
+    channels_ = channels;
+    ceiling_ = std::pow(10.0f, LIMITER_CEILING_DB / 20.0f);
+    release_ = (float)std::exp(-1.0 / (sample_rate * LIMITER_RELEASE_MS / 1000.0));
+    gain_ = 1.0f;
+}
+
+void Limiter::process(float* samples, ma_uint32 frames) {
+    float gain = gain_;
+    ma_uint64 limited = 0;
+    for (ma_uint32 i = 0; i < frames; ++i, samples += channels_) {
+        float peak = 0.0f;
+        for (ma_uint32 c = 0; c < channels_; ++c) {
+            peak = std::max(peak, std::fabs(samples[c]));
+        }
+        float target = 1.0f;
+        if (peak > ceiling_) {
+            target = ceiling_ / peak;
+            ++limited;
+        }
+        // 立即压低，按释放时间恢复，接近 1 时直接回到 1
+        gain = target < gain ? target : target - (target - gain) * release_;
+        if (gain > 0.99999f) {
+            gain = 1.0f;
+        }
+        if (gain < 1.0f) {
+            for (ma_uint32 c = 0; c < channels_; ++c) {
+                samples[c] *= gain;
+            }
+        }
+    }
+    gain_ = gain;
+    if (limited > 0) {
+        limited_frames_.store(limited_frames_.load(std::memory_order_relaxed) + limited, std::memory_order_relaxed);
+    }
+}
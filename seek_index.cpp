@@ -0,0 +1,242 @@
+#include "seek_index.h"
+#include "library_index.h"
+#include "mmap_vfs.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+
+// 跳转索引文件与目录索引放在同一目录，所有目录共用一个文件
+const char* SEEK_INDEX_FILE = "caudio_seek_index.bin";
+const uint32_t SEEK_INDEX_MAGIC = 0x4B534143;  // "CASK"
+const uint32_t SEEK_INDEX_VERSION = 1;
+
+// 单个文件的跳转点数量上限（读取时校验，防止损坏的文件导致巨量分配）
+const uint32_t MAX_STORED_POINTS = MAX_SEEK_POINTS;
+
+struct SeekIndexEntry {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    SeekTable table;
+};
+
+using SeekIndexMap = std::unordered_map<std::string, SeekIndexEntry>;
+
+void write_u16(std::ostream& out, uint16_t v) { out.write((const char*)&v, sizeof(v)); }
+void write_u32(std::ostream& out, uint32_t v) { out.write((const char*)&v, sizeof(v)); }
+void write_u64(std::ostream& out, uint64_t v) { out.write((const char*)&v, sizeof(v)); }
+
+bool read_u16(std::istream& in, uint16_t* v) { return (bool)in.read((char*)v, sizeof(*v)); }
+bool read_u32(std::istream& in, uint32_t* v) { return (bool)in.read((char*)v, sizeof(*v)); }
+bool read_u64(std::istream& in, uint64_t* v) { return (bool)in.read((char*)v, sizeof(*v)); }
+
+bool load_seek_index(SeekIndexMap* entries) {
+    std::ifstream in(SEEK_INDEX_FILE, std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+
+    uint32_t magic, version, count;
+    if (!read_u32(in, &magic) || magic != SEEK_INDEX_MAGIC ||
+        !read_u32(in, &version) || version != SEEK_INDEX_VERSION ||
+        !read_u32(in, &count)) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        std::string path;
+        uint32_t path_size, point_count;
+        uint64_t mtime;
+        SeekIndexEntry entry;
+        if (!read_u32(in, &path_size) || path_size > 65536) {
+            return false;
+        }
+        path.resize(path_size);
+        if ((path_size > 0 && !in.read(&path[0], path_size)) ||
+            !read_u64(in, &entry.size) || !read_u64(in, &mtime) ||
+            !read_u32(in, &point_count) || point_count > MAX_STORED_POINTS) {
+            return false;
+        }
+        entry.mtime = (int64_t)mtime;
+        entry.table.resize(point_count);
+        for (auto& point : entry.table) {
+            uint64_t byte_offset, frame;
+            if (!read_u64(in, &byte_offset) || !read_u64(in, &frame) ||
+                !read_u16(in, &point.mp3_frames_to_discard) || !read_u16(in, &point.pcm_frames_to_discard)) {
+                return false;
+            }
+            point.byte_offset = byte_offset;
+            point.frame = frame;
+        }
+        (*entries)[path] = std::move(entry);
+    }
+    return true;
+}
+
+bool save_seek_index(const SeekIndexMap& entries) {
+    // 先写临时文件再改名，避免中途退出留下损坏的索引
+    std::string temp = std::string(SEEK_INDEX_FILE) + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            return false;
+        }
+
+        write_u32(out, SEEK_INDEX_MAGIC);
+        write_u32(out, SEEK_INDEX_VERSION);
+        write_u32(out, (uint32_t)entries.size());
+        for (const auto& item : entries) {
+            const SeekIndexEntry& entry = item.second;
+            write_u32(out, (uint32_t)item.first.size());
+            out.write(item.first.data(), (std::streamsize)item.first.size());
+            write_u64(out, entry.size);
+            write_u64(out, (uint64_t)entry.mtime);
+            write_u32(out, (uint32_t)entry.table.size());
+            for (const auto& point : entry.table) {
+                write_u64(out, point.byte_offset);
+                write_u64(out, point.frame);
+                write_u16(out, point.mp3_frames_to_discard);
+                write_u16(out, point.pcm_frames_to_discard);
+            }
+        }
+
+        if (!out.good()) {
+            return false;
+        }
+    }
+
+#ifdef _WIN32
+    std::remove(SEEK_INDEX_FILE);  // Windows 下 rename 不会覆盖已有文件
+#endif
+    return std::rename(temp.c_str(), SEEK_INDEX_FILE) == 0;
+}
+
+// 进程内的跳转索引缓存：第一次使用时从磁盘加载，
+// 播放线程、后台索引线程和控制线程都可能访问，由互斥锁保护
+class SeekIndexCache {
+public:
+    bool lookup(const std::string& path, uint64_t size, int64_t mtime, SeekTable* table) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ensureLoaded();
+        auto it = entries_.find(path);
+        if (it == entries_.end() || it->second.size != size || it->second.mtime != mtime ||
+            it->second.table.empty()) {
+            return false;
+        }
+        *table = it->second.table;
+        return true;
+    }
+
+    void store(const std::string& path, uint64_t size, int64_t mtime, const SeekTable& table) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ensureLoaded();
+
+        // 其他进程（守护进程、另一个播放进程）可能在此期间写过索引，先合并磁盘上的内容
+        SeekIndexMap merged;
+        load_seek_index(&merged);
+        for (auto& item : entries_) {
+            merged[item.first] = std::move(item.second);
+        }
+        SeekIndexEntry& entry = merged[path];
+        entry.size = size;
+        entry.mtime = mtime;
+        entry.table = table;
+
+        // 顺带清理已经删除或修改过的文件
+        for (auto it = merged.begin(); it != merged.end();) {
+            uint64_t current_size;
+            int64_t current_mtime;
+            if (!file_signature(it->first, &current_size, &current_mtime) || current_size != it->second.size ||
+                current_mtime != it->second.mtime) {
+                it = merged.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        entries_.swap(merged);
+        save_seek_index(entries_);
+    }
+
+private:
+    void ensureLoaded() {
+        if (!loaded_) {
+            load_seek_index(&entries_);
+            loaded_ = true;
+        }
+    }
+
+    std::mutex mutex_;
+    bool loaded_ = false;
+    SeekIndexMap entries_;
+};
+
+SeekIndexCache& seek_index_cache() {
+    static SeekIndexCache cache;
+    return cache;
+}
+
+ma_uint32 seek_point_count(uint64_t file_size) {
+    return (ma_uint32)std::min<uint64_t>(std::max<uint64_t>(file_size / SEEK_POINT_INTERVAL_BYTES, 1),
+                                         MAX_SEEK_POINTS);
+}
+
+} // namespace
+
+bool attach_seek_table(ma_decoder* decoder, const std::string& path, bool build, SeekTable* storage) {
+    if (!decoder_is_mp3(decoder)) {
+        return false;
+    }
+
+    uint64_t size;
+    int64_t mtime;
+    if (!file_signature(path, &size, &mtime) || size < SEEK_INDEX_MIN_BYTES) {
+        return false;
+    }
+
+    SeekIndexCache& cache = seek_index_cache();
+    if (!cache.lookup(path, size, mtime, storage)) {
+        if (!build || !decoder_build_seek_table(decoder, seek_point_count(size), storage)) {
+            return false;
+        }
+        cache.store(path, size, mtime, *storage);
+    }
+    return decoder_bind_seek_table(decoder, storage);
+}
+
+bool index_seek_table(const std::string& path, const std::atomic<bool>& abort) {
+    uint64_t size;
+    int64_t mtime;
+    if (!file_signature(path, &size, &mtime) || size < SEEK_INDEX_MIN_BYTES ||
+        probe_audio_format(path) != AudioFormat::Mp3) {
+        return false;
+    }
+
+    SeekTable table;
+    SeekIndexCache& cache = seek_index_cache();
+    if (cache.lookup(path, size, mtime, &table)) {
+        return false;
+    }
+
+    // 读取时检查中止标志，返回错误后 dr_mp3 把它当作文件结束，扫描随即结束
+    AbortableVfs scan(&abort);
+    ma_decoder_config config = ma_decoder_config_init_default();
+    config.encodingFormat = ma_encoding_format_mp3;
+    ma_decoder decoder;
+    if (ma_decoder_init_vfs(scan.vfs(), path.c_str(), &config, &decoder) != MA_SUCCESS) {
+        return false;
+    }
+    bool built = decoder_build_seek_table(&decoder, seek_point_count(size), &table);
+    ma_decoder_uninit(&decoder);
+
+    // 中止时扫描结果不完整，不能写入索引
+    if (!built || abort.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    cache.store(path, size, mtime, table);
+    return true;
+}
@@ -0,0 +1,54 @@
+#ifndef SEEK_INDEX_H
+#define SEEK_INDEX_H
+
+#include "third-party/miniaudio.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+// MP3 跳转表中的一个点：从 byte_offset 处开始解码，丢弃若干帧后到达 frame
+// （与 dr_mp3 的跳转点布局一致，可以直接绑定到解码器）
+struct SeekPoint {
+    ma_uint64 byte_offset;
+    ma_uint64 frame;
+    ma_uint16 mp3_frames_to_discard;
+    ma_uint16 pcm_frames_to_discard;
+};
+
+using SeekTable = std::vector<SeekPoint>;
+
+// 小于该大小的 MP3 从头顺序跳转的代价可以忽略，不建跳转表
+constexpr ma_uint64 SEEK_INDEX_MIN_BYTES = 1 << 20;
+
+// 每 64 KiB 数据一个跳转点（128 kbps 约 4 秒），每个文件最多 4096 个点
+constexpr ma_uint64 SEEK_POINT_INTERVAL_BYTES = 64 << 10;
+constexpr ma_uint32 MAX_SEEK_POINTS = 4096;
+
+// 以下四个函数需要访问 miniaudio 的内部类型，实现在 miniaudio_impl.cpp 中
+
+// 解码器是否使用 MP3 后端。只有 MP3 需要跳转表：WAV 可以直接按偏移定位，
+// FLAC 由 dr_flac 使用文件自带的 SEEKTABLE 或按帧二分查找
+bool decoder_is_mp3(const ma_decoder* decoder);
+
+// 解码器能否不扫描文件直接给出时长。WAV / FLAC 的时长记录在文件头中；
+// MP3 只有第一帧带 Xing/Info 头时才有总帧数，否则 ma_decoder_get_length_in_pcm_frames 要读完整个文件
+bool decoder_length_known(const ma_decoder* decoder);
+
+// 扫描 MP3 帧头生成跳转表（只解析帧头、不解码），完成后恢复原来的读取位置
+bool decoder_build_seek_table(ma_decoder* decoder, ma_uint32 max_points, SeekTable* table);
+
+// 把跳转表绑定到解码器，之后的跳转从最近的跳转点开始解码。
+// table 必须在解码器关闭或重新绑定之前保持有效，nullptr 表示解除绑定
+bool decoder_bind_seek_table(ma_decoder* decoder, SeekTable* table);
+
+// 为已打开的解码器准备跳转表：先查持久化的跳转索引（caudio_seek_index.bin），
+// 没有且 build 为 true 时扫描生成并写回。跳转表保存在 storage 中，
+// storage 必须与解码器同生命周期。返回是否绑定了跳转表
+bool attach_seek_table(ma_decoder* decoder, const std::string& path, bool build, SeekTable* storage);
+
+// 后台建立跳转索引：单独打开文件扫描，abort 置位时尽快放弃。
+// 不是 MP3、文件太小或已有有效的跳转表时直接返回 false
+bool index_seek_table(const std::string& path, const std::atomic<bool>& abort);
+
+#endif // SEEK_INDEX_H
@@ -0,0 +1,83 @@
+#include "startup_trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+namespace {
+
+struct PhaseInfo {
+    const char* name;
+    const char* thread;
+};
+
+const PhaseInfo PHASES[StartupTrace::PhaseCount] = {
+    {"context init", "device"},
+    {"decoder open", "main"},
+    {"track length", "main"},
+    {"seek", "main"},
+    {"device init", "device"},
+    {"prefill", "main"},
+    {"device start", "main"},
+};
+
+} // namespace
+
+void StartupTrace::markFirstSample() {
+    if (first_sample_ns_.load(std::memory_order_relaxed) != 0) {
+        return;
+    }
+    int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - origin_).count();
+    first_sample_ns_.store(std::max<int64_t>(ns, 1), std::memory_order_release);
+}
+
+bool StartupTrace::waitFirstSample(std::chrono::milliseconds timeout) const {
+    auto deadline = Clock::now() + timeout;
+    while (!firstSampleSeen()) {
+        if (Clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    return true;
+}
+
+double StartupTrace::ms(Clock::time_point t) const {
+    return std::chrono::duration<double, std::milli>(t - origin_).count();
+}
+
+void StartupTrace::print(std::ostream& out) const {
+    // 按开始时间插入排序（最多 PhaseCount 项）
+    int order[PhaseCount];
+    int count = 0;
+    for (int i = 0; i < PhaseCount; ++i) {
+        if (!done_[i]) {
+            continue;
+        }
+        int k = count++;
+        while (k > 0 && begin_[order[k - 1]] > begin_[i]) {
+            order[k] = order[k - 1];
+            --k;
+        }
+        order[k] = i;
+    }
+
+    char line[128];
+    out << "Startup trace (ms since process start):\n";
+    snprintf(line, sizeof(line), "  %-14s %-8s %9s %9s %9s\n", "phase", "thread", "begin", "end", "elapsed");
+    out << line;
+    for (int k = 0; k < count; ++k) {
+        int i = order[k];
+        snprintf(line, sizeof(line), "  %-14s %-8s %9.2f %9.2f %9.2f\n", PHASES[i].name, PHASES[i].thread,
+                 ms(begin_[i]), ms(end_[i]), ms(end_[i]) - ms(begin_[i]));
+        out << line;
+    }
+
+    int64_t first = first_sample_ns_.load(std::memory_order_acquire);
+    if (first != 0) {
+        snprintf(line, sizeof(line), "Time to first sample: %.2f ms\n", first / 1e6);
+    } else {
+        snprintf(line, sizeof(line), "Time to first sample: not reached\n");
+    }
+    out << line;
+}
@@ -0,0 +1,55 @@
+#ifndef STARTUP_TRACE_H
+#define STARTUP_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+// 启动耗时跟踪（--trace-startup）：用单调时钟记录从进程启动到第一个采样交给设备的各个阶段。
+// 每个阶段只由一个线程写入，读取（print）在这些线程结束或同步之后进行，
+// 第一个采样的时间点由设备回调写入，使用原子变量
+class StartupTrace {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum Phase {
+        ContextInit,   // 音频后端初始化（设备线程）
+        DecoderOpen,   // 打开第一首曲目的解码器
+        TrackLength,   // 取得曲目时长
+        Seek,          // 起始位置跳转
+        DeviceInit,    // 按解码格式打开播放设备
+        Prefill,       // 启动前填充缓冲
+        DeviceStart,   // 启动设备
+        PhaseCount,
+    };
+
+    explicit StartupTrace(Clock::time_point origin) : origin_(origin) {}
+
+    void begin(Phase phase) { begin_[phase] = Clock::now(); }
+    void end(Phase phase) {
+        end_[phase] = Clock::now();
+        done_[phase] = true;
+    }
+
+    // 设备回调第一次交出数据时调用（只有第一次生效，不分配内存）
+    void markFirstSample();
+    bool firstSampleSeen() const { return first_sample_ns_.load(std::memory_order_acquire) != 0; }
+
+    // 等待第一个采样交给设备，最多等待 timeout
+    bool waitFirstSample(std::chrono::milliseconds timeout) const;
+
+    // 按开始时间输出各阶段的起止时间和耗时（毫秒，相对进程启动）
+    void print(std::ostream& out) const;
+
+private:
+    double ms(Clock::time_point t) const;
+
+    Clock::time_point origin_;
+    Clock::time_point begin_[PhaseCount];
+    Clock::time_point end_[PhaseCount];
+    bool done_[PhaseCount] = {};
+    std::atomic<int64_t> first_sample_ns_{0};  // 相对 origin_ 的纳秒数，0 表示还没有
+};
+
+#endif // STARTUP_TRACE_H
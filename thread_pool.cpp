@@ -0,0 +1,84 @@
+#include "thread_pool.h"
+
+#include <chrono>
+#include <thread>
+
+size_t hardware_threads() {
+    unsigned int n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+WorkStealingPool::WorkStealingPool(size_t thread_count) : pending_(0), steals_(0) {
+    if (thread_count == 0) {
+        thread_count = hardware_threads();
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+}
+
+void WorkStealingPool::spawn(size_t worker, Task task) {
+    pending_.fetch_add(1, std::memory_order_acq_rel);
+    {
+        Queue& queue = *queues_[worker % queues_.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    idle_cv_.notify_one();
+}
+
+bool WorkStealingPool::pop(size_t worker, Task* task) {
+    Queue& queue = *queues_[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    *task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::steal(size_t worker, Task* task) {
+    for (size_t i = 1; i < queues_.size(); ++i) {
+        Queue& queue = *queues_[(worker + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            *task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            steals_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(size_t worker) {
+    Task task;
+    while (pending_.load(std::memory_order_acquire) > 0) {
+        if (pop(worker, &task) || steal(worker, &task)) {
+            task(*this, worker);
+            task = nullptr;
+            if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                idle_cv_.notify_all();  // 最后一个任务完成，唤醒所有等待的线程退出
+            }
+            continue;
+        }
+
+        // 暂时没有可执行的任务：等待新任务提交或全部完成
+        std::unique_lock<std::mutex> lock(idle_mutex_);
+        idle_cv_.wait_for(lock, std::chrono::milliseconds(1), [this] {
+            return pending_.load(std::memory_order_acquire) == 0;
+        });
+    }
+}
+
+void WorkStealingPool::run() {
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < queues_.size(); ++i) {
+        threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+    workerLoop(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// 工作窃取线程池：每个线程有自己的任务队列，从队尾取自己提交的任务（深度优先，
+// 局部性好），自己的队列为空时从其他线程的队头窃取（拿走较早提交、通常更大的任务）。
+// 任务可以在执行过程中继续提交子任务，run() 在所有任务完成后返回。
+class WorkStealingPool {
+public:
+    using Task = std::function<void(WorkStealingPool& pool, size_t worker)>;
+
+    // thread_count 为 0 时使用硬件线程数
+    explicit WorkStealingPool(size_t thread_count = 0);
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // 提交任务到 worker 号线程的队列（任务内部提交时传入自己的 worker 编号）
+    void spawn(size_t worker, Task task);
+
+    // 启动线程执行任务，全部完成后返回；调用线程本身作为 0 号线程参与执行
+    void run();
+
+    size_t threadCount() const { return queues_.size(); }
+
+    // 被其他线程窃取执行的任务数
+    size_t steals() const { return steals_.load(std::memory_order_relaxed); }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(size_t worker);
+    bool pop(size_t worker, Task* task);
+    bool steal(size_t worker, Task* task);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::atomic<size_t> pending_;   // 已提交但尚未执行完的任务数
+    std::atomic<size_t> steals_;
+    std::mutex idle_mutex_;
+    std::condition_variable idle_cv_;
+};
+
+// 有界阻塞队列：队列满时生产者等待，限制在途任务的数量和内存占用
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity_(capacity > 0 ? capacity : 1) {}
+
+    void push(T item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] { return items_.size() < capacity_; });
+        items_.push_back(std::move(item));
+        not_empty_.notify_one();
+    }
+
+    T pop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] { return !items_.empty(); });
+        T item = std::move(items_.front());
+        items_.pop_front();
+        not_full_.notify_one();
+        return item;
+    }
+
+private:
+    size_t capacity_;
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+    std::deque<T> items_;
+};
+
+// 硬件线程数（至少为 1）
+size_t hardware_threads();
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,320 @@
+#include "transcode.h"
+#include "library_index.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <cerrno>
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+// 每个数据块的帧数，以及两级之间循环使用的数据块个数
+const ma_uint32 BLOCK_FRAMES = 16384;
+const size_t BLOCKS_PER_PIPELINE = 4;
+
+// 两级之间传递的数据块
+struct Block {
+    std::vector<ma_uint8> data;
+    ma_uint64 frames = 0;
+    bool last = false;           // 解码结束（或出错）后的最后一块
+    ma_result result = MA_SUCCESS;
+};
+
+// 每个转码线程一条流水线，数据块在整个转码过程中反复使用
+struct Pipeline {
+    Block blocks[BLOCKS_PER_PIPELINE];
+    BoundedQueue<Block*> free_blocks{BLOCKS_PER_PIPELINE};
+    BoundedQueue<Block*> filled_blocks{BLOCKS_PER_PIPELINE};
+};
+
+struct TranscodeResult {
+    bool ok = false;
+    std::string error;
+    ma_uint64 frames = 0;
+    ma_uint32 sample_rate = 0;
+    double seconds = 0.0;
+};
+
+bool make_directories(const std::string& path) {
+    for (size_t pos = 1; pos <= path.size(); ++pos) {
+        if (pos != path.size() && path[pos] != '/' && path[pos] != '\\') {
+            continue;
+        }
+        std::string dir = path.substr(0, pos);
+#ifdef _WIN32
+        if (_mkdir(dir.c_str()) != 0 && errno != EEXIST) {
+#else
+        if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+#endif
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string result_text(ma_result result) {
+    const char* desc = ma_result_description(result);
+    return desc != nullptr ? desc : "Unknown error";
+}
+
+// 转码一个文件：调用线程负责编码，另起一个线程负责解码和格式转换
+TranscodeResult transcode_file(const std::string& src, const std::string& dst, const TranscodeOptions& options,
+                               Pipeline* pipeline) {
+    TranscodeResult r;
+    auto begin = std::chrono::steady_clock::now();
+
+    // 采样率和声道转换由解码器内置的数据转换器完成
+    ma_decoder_config decoder_config =
+        ma_decoder_config_init(options.sample_format, options.channels, options.sample_rate);
+    ma_decoder decoder;
+    ma_result result = init_decoder_file(options.io_mode, src, &decoder_config, &decoder);
+    if (result != MA_SUCCESS) {
+        r.error = "open failed: " + result_text(result);
+        return r;
+    }
+
+    // 先写临时文件，完成后再改名，中途失败不会留下不完整的目标文件
+    std::string temp = dst + ".part";
+    ma_encoder_config encoder_config = ma_encoder_config_init(ma_encoding_format_wav, decoder.outputFormat,
+                                                              decoder.outputChannels, decoder.outputSampleRate);
+    ma_encoder encoder;
+    result = ma_encoder_init_file(temp.c_str(), &encoder_config, &encoder);
+    if (result != MA_SUCCESS) {
+        ma_decoder_uninit(&decoder);
+        r.error = "cannot create output: " + result_text(result);
+        return r;
+    }
+
+    size_t block_bytes = (size_t)BLOCK_FRAMES * ma_get_bytes_per_frame(decoder.outputFormat, decoder.outputChannels);
+    for (auto& block : pipeline->blocks) {
+        if (block.data.size() < block_bytes) {
+            block.data.resize(block_bytes);
+        }
+        pipeline->free_blocks.push(&block);
+    }
+
+    // 第一级：解码并转换格式，写满一块就交给编码级
+    std::atomic<bool> abort(false);
+    std::thread decode_stage([&] {
+        for (;;) {
+            Block* block = pipeline->free_blocks.pop();
+            block->frames = 0;
+            block->result = MA_SUCCESS;
+            block->last = abort.load(std::memory_order_relaxed);
+            if (!block->last) {
+                ma_uint64 read = 0;
+                block->result = ma_decoder_read_pcm_frames(&decoder, block->data.data(), BLOCK_FRAMES, &read);
+                block->frames = read;
+                block->last = block->result != MA_SUCCESS || read < BLOCK_FRAMES;
+            }
+            bool last = block->last;
+            pipeline->filled_blocks.push(block);
+            if (last) {
+                break;
+            }
+        }
+    });
+
+    // 第二级：按顺序写入编码器，写完的块还给解码级
+    ma_result decode_result = MA_SUCCESS;
+    ma_result encode_result = MA_SUCCESS;
+    for (;;) {
+        Block* block = pipeline->filled_blocks.pop();
+        if (block->frames > 0 && encode_result == MA_SUCCESS) {
+            ma_uint64 written = 0;
+            encode_result = ma_encoder_write_pcm_frames(&encoder, block->data.data(), block->frames, &written);
+            if (encode_result == MA_SUCCESS && written < block->frames) {
+                encode_result = MA_IO_ERROR;
+            }
+            if (encode_result != MA_SUCCESS) {
+                abort.store(true, std::memory_order_relaxed);
+            }
+            r.frames += written;
+        }
+        bool last = block->last;
+        if (last) {
+            decode_result = block->result;
+        }
+        pipeline->free_blocks.push(block);
+        if (last) {
+            break;
+        }
+    }
+    decode_stage.join();
+
+    // 回收数据块，留给下一个文件使用
+    for (size_t i = 0; i < BLOCKS_PER_PIPELINE; ++i) {
+        pipeline->free_blocks.pop();
+    }
+
+    r.sample_rate = decoder.outputSampleRate;
+    ma_encoder_uninit(&encoder);
+    ma_decoder_uninit(&decoder);
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    if (encode_result != MA_SUCCESS) {
+        r.error = "write failed: " + result_text(encode_result);
+    } else if (decode_result != MA_SUCCESS && decode_result != MA_AT_END) {
+        r.error = "decode error: " + result_text(decode_result);
+    } else if (r.frames == 0) {
+        r.error = "no audio frames";
+    }
+
+    if (!r.error.empty()) {
+        std::remove(temp.c_str());
+        return r;
+    }
+
+#ifdef _WIN32
+    std::remove(dst.c_str());  // Windows 下 rename 不会覆盖已有文件
+#endif
+    if (std::rename(temp.c_str(), dst.c_str()) != 0) {
+        std::remove(temp.c_str());
+        r.error = "cannot rename output";
+        return r;
+    }
+    r.ok = true;
+    return r;
+}
+
+// 目标路径：保持相对目录结构，扩展名换成 .wav；keep_extension 时保留源扩展名（song.flac.wav）
+std::string output_path(const std::string& src_dir, const std::string& dst_dir, const std::string& path,
+                        bool keep_extension) {
+    std::string relative = path.substr(src_dir.size());
+    while (!relative.empty() && (relative[0] == '/' || relative[0] == '\\')) {
+        relative.erase(0, 1);
+    }
+    size_t dot = relative.find_last_of('.');
+    size_t sep = relative.find_last_of("/\\");
+    if (!keep_extension && dot != std::string::npos && (sep == std::string::npos || dot > sep)) {
+        relative.erase(dot);
+    }
+#ifdef _WIN32
+    return dst_dir + "\\" + relative + ".wav";
+#else
+    return dst_dir + "/" + relative + ".wav";
+#endif
+}
+
+} // namespace
+
+int run_transcode(const std::string& src_dir, const std::string& dst_dir, const TranscodeOptions& options) {
+    if (options.format != "wav") {
+        std::cerr << "Error: Unsupported output format '" << options.format << "' (only wav can be encoded).\n";
+        return 1;
+    }
+
+    LibraryIndex index(src_dir, options.recursive);
+    index.load();
+    index.update();
+
+    std::vector<LibraryEntry> entries;
+    size_t skipped = 0;
+    for (const auto& entry : index.entries()) {
+        if (entry.decodable()) {
+            entries.push_back(entry);
+        } else {
+            ++skipped;
+        }
+    }
+
+    // 先确定全部目标路径：同一目录下只有扩展名不同的文件（song.mp3 / song.flac）会得到同一个 song.wav，
+    // 并行写入时互相覆盖，这些文件改为保留源扩展名；仍然重名的文件不转码，报告失败
+    std::vector<std::string> outputs(entries.size());
+    std::map<std::string, size_t> plain_count;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        outputs[i] = output_path(src_dir, dst_dir, entries[i].path, false);
+        ++plain_count[outputs[i]];
+    }
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (plain_count[outputs[i]] > 1) {
+            outputs[i] = output_path(src_dir, dst_dir, entries[i].path, true);
+        }
+    }
+    std::map<std::string, size_t> first_owner;
+    std::vector<std::string> collisions(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        auto it = first_owner.emplace(outputs[i], i).first;
+        if (it->second != i) {
+            collisions[i] = "output " + outputs[i] + " collides with " + entries[it->second].path;
+        }
+    }
+    if (entries.empty()) {
+        std::cout << "No decodable audio files found in: " << src_dir << "\n";
+        return 0;
+    }
+    if (!make_directories(dst_dir)) {
+        std::cerr << "Error: Cannot create output directory: " << dst_dir << "\n";
+        return 1;
+    }
+
+    size_t threads = options.threads > 0 ? options.threads : hardware_threads();
+    threads = std::min(threads, entries.size());
+    std::cout << "Transcoding " << entries.size() << " file(s) from " << src_dir << " to " << dst_dir << " with "
+              << threads << " thread(s)";
+    if (skipped > 0) {
+        std::cout << ", skipping " << skipped << " undecodable file(s)";
+    }
+    std::cout << "\n";
+
+    std::vector<std::unique_ptr<Pipeline>> pipelines;
+    for (size_t i = 0; i < threads; ++i) {
+        pipelines.push_back(std::make_unique<Pipeline>());
+    }
+
+    std::mutex print_mutex;
+    size_t done = 0;
+    size_t failed = 0;
+    double audio_seconds = 0.0;
+    auto begin = std::chrono::steady_clock::now();
+
+    WorkStealingPool pool(threads);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        pool.spawn(i, [&, i](WorkStealingPool&, size_t worker) {
+            const std::string& src = entries[i].path;
+            const std::string& dst = outputs[i];
+            size_t sep = dst.find_last_of("/\\");
+            TranscodeResult r;
+            if (!collisions[i].empty()) {
+                r.error = collisions[i];
+            } else if (sep != std::string::npos && !make_directories(dst.substr(0, sep))) {
+                r.error = "cannot create directory";
+            } else {
+                r = transcode_file(src, dst, options, pipelines[worker].get());
+            }
+
+            std::lock_guard<std::mutex> lock(print_mutex);
+            ++done;
+            if (r.ok) {
+                double audio = r.frames / (double)r.sample_rate;
+                audio_seconds += audio;
+                printf("[%zu/%zu] OK    %s (%.0fx realtime)\n", done, entries.size(), dst.c_str(),
+                       r.seconds > 0 ? audio / r.seconds : 0.0);
+            } else {
+                ++failed;
+                printf("[%zu/%zu] FAIL  %s: %s\n", done, entries.size(), src.c_str(), r.error.c_str());
+            }
+            fflush(stdout);
+        });
+    }
+    pool.run();
+
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    printf("\nTranscoded %zu file(s) in %.2f s: %zu OK, %zu failed, %.0fx realtime\n", entries.size(), wall,
+           entries.size() - failed, failed, wall > 0 ? audio_seconds / wall : 0.0);
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,25 @@
+#ifndef TRANSCODE_H
+#define TRANSCODE_H
+
+#include "mmap_vfs.h"
+
+#include <cstddef>
+#include <string>
+
+// 转码参数：0 / ma_format_unknown 表示保持源文件的格式
+struct TranscodeOptions {
+    std::string format = "wav";                 // 输出容器（ma_encoder 只支持 WAV）
+    ma_uint32 sample_rate = 0;
+    ma_uint32 channels = 0;
+    ma_format sample_format = ma_format_unknown;
+    bool recursive = false;
+    size_t threads = 0;                         // 同时转码的文件数，0 表示硬件线程数
+    IoMode io_mode = IoMode::Stdio;
+};
+
+// 把 src_dir 中所有可解码的文件转码到 dst_dir，保持相对目录结构。
+// 每个文件是一个两级流水线：解码线程（含采样率/声道转换）→ 编码线程，
+// 两级之间通过固定数量、循环复用的定长数据块传递，内存占用与文件长度无关
+int run_transcode(const std::string& src_dir, const std::string& dst_dir, const TranscodeOptions& options);
+
+#endif // TRANSCODE_H
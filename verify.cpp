@@ -0,0 +1,199 @@
+#include "verify.h"
+#include "thread_pool.h"
+#include "third-party/miniaudio.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace {
+
+// 每次读取的帧数：足够大以摊薄调用开销
+const ma_uint32 VERIFY_CHUNK_FRAMES = 4096;
+
+// 工作队列容量（每个线程）
+const size_t VERIFY_QUEUE_PER_THREAD = 4;
+
+struct VerifyResult {
+    bool ok = false;
+    std::string error;
+    ma_uint64 frames = 0;
+    ma_uint32 sample_rate = 0;
+    double seconds = 0.0;
+};
+
+std::string format_duration(double seconds) {
+    int total = (int)seconds;
+    char buf[32];
+    if (total >= 3600) {
+        snprintf(buf, sizeof(buf), "%d:%02d:%02d", total / 3600, (total % 3600) / 60, total % 60);
+    } else {
+        snprintf(buf, sizeof(buf), "%d:%02d", total / 60, total % 60);
+    }
+    return buf;
+}
+
+std::string result_text(ma_result result) {
+    const char* desc = ma_result_description(result);
+    return desc != nullptr ? desc : "Unknown error";
+}
+
+// RIFF 头中声明的文件大小（字节），不是 RIFF 文件时返回 0。
+// dr_wav 会把数据块长度截到实际文件大小，被截断的 WAV 只能通过文件头发现
+ma_uint64 riff_declared_size(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    unsigned char header[12];
+    if (!in.read((char*)header, sizeof(header)) || memcmp(header, "RIFF", 4) != 0) {
+        return 0;
+    }
+    ma_uint32 size = header[4] | (header[5] << 8) | (header[6] << 16) | ((ma_uint32)header[7] << 24);
+    return (ma_uint64)size + 8;
+}
+
+// 完整解码一个文件，buffer 由调用线程复用
+VerifyResult verify_file(const LibraryEntry& entry, std::vector<ma_uint8>* buffer) {
+    VerifyResult r;
+    if (!entry.decodable()) {
+        r.error = entry.detected == AudioFormat::Unknown
+                      ? "unrecognized content"
+                      : std::string(audio_format_name(entry.detected)) + " is not supported";
+        return r;
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+
+    // 原始输出格式，不做格式转换，只验证解码本身
+    ma_decoder_config config = ma_decoder_config_init_default();
+    ma_decoder decoder;
+    ma_result result = ma_decoder_init_file(entry.path.c_str(), &config, &decoder);
+    if (result != MA_SUCCESS) {
+        r.error = "open failed: " + result_text(result);
+        return r;
+    }
+
+    ma_uint64 expected = 0;
+    bool has_length = ma_decoder_get_length_in_pcm_frames(&decoder, &expected) == MA_SUCCESS && expected > 0;
+
+    size_t bytes = (size_t)VERIFY_CHUNK_FRAMES * ma_get_bytes_per_frame(decoder.outputFormat, decoder.outputChannels);
+    if (buffer->size() < bytes) {
+        buffer->resize(bytes);
+    }
+
+    for (;;) {
+        ma_uint64 read = 0;
+        result = ma_decoder_read_pcm_frames(&decoder, buffer->data(), VERIFY_CHUNK_FRAMES, &read);
+        r.frames += read;
+        if (result != MA_SUCCESS || read < VERIFY_CHUNK_FRAMES) {
+            break;
+        }
+    }
+    r.sample_rate = decoder.outputSampleRate;
+    ma_decoder_uninit(&decoder);
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    if (result != MA_SUCCESS && result != MA_AT_END) {
+        r.error = "decode error at " + format_duration(r.frames / (double)r.sample_rate) + ": " + result_text(result);
+    } else if (r.frames == 0) {
+        r.error = "no audio frames";
+    } else if (entry.detected == AudioFormat::Wav && riff_declared_size(entry.path) > entry.size) {
+        r.error = "truncated: file is " + std::to_string(entry.size) + " bytes, header declares " +
+                  std::to_string(riff_declared_size(entry.path));
+    } else if (has_length && r.frames < expected) {
+        r.error = "truncated: decoded " + std::to_string(r.frames) + " of " + std::to_string(expected) + " frames (" +
+                  format_duration(r.frames / (double)r.sample_rate) + " of " +
+                  format_duration(expected / (double)r.sample_rate) + ")";
+    } else {
+        r.ok = true;
+    }
+    return r;
+}
+
+} // namespace
+
+int run_verify(const std::vector<LibraryEntry>& entries, size_t threads) {
+    if (threads == 0) {
+        threads = hardware_threads();
+    }
+    threads = std::max<size_t>(1, std::min(threads, entries.size()));
+
+    std::vector<VerifyResult> results(entries.size());
+    BoundedQueue<size_t> queue(threads * VERIFY_QUEUE_PER_THREAD);
+    std::mutex print_mutex;
+    size_t done = 0;
+
+    auto begin = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            std::vector<ma_uint8> buffer;
+            for (;;) {
+                size_t index = queue.pop();
+                if (index == SIZE_MAX) {
+                    break;
+                }
+
+                VerifyResult r = verify_file(entries[index], &buffer);
+
+                // 结果按完成顺序输出
+                std::lock_guard<std::mutex> lock(print_mutex);
+                ++done;
+                const std::string& path = entries[index].path;
+                if (r.ok) {
+                    double audio = r.frames / (double)r.sample_rate;
+                    printf("[%zu/%zu] OK    %s (%s, %.0fx realtime)\n", done, entries.size(), path.c_str(),
+                           format_duration(audio).c_str(), r.seconds > 0 ? audio / r.seconds : 0.0);
+                } else {
+                    printf("[%zu/%zu] FAIL  %s: %s\n", done, entries.size(), path.c_str(), r.error.c_str());
+                }
+                fflush(stdout);
+                results[index] = std::move(r);
+            }
+        });
+    }
+
+    // 队列满时在这里等待，任意时刻只有少量任务在途
+    for (size_t i = 0; i < entries.size(); ++i) {
+        queue.push(i);
+    }
+    for (size_t t = 0; t < threads; ++t) {
+        queue.push(SIZE_MAX);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    size_t failed = 0;
+    double audio_seconds = 0.0;
+    for (const auto& r : results) {
+        if (!r.ok) {
+            ++failed;
+        }
+        if (r.sample_rate > 0) {
+            audio_seconds += r.frames / (double)r.sample_rate;
+        }
+    }
+
+    if (failed > 0) {
+        printf("\nFailed files:\n");
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (!results[i].ok) {
+                printf("  %s: %s\n", entries[i].path.c_str(), results[i].error.c_str());
+            }
+        }
+    }
+
+    printf("\nVerified %zu file(s) with %zu thread(s) in %.2f s: %zu OK, %zu failed\n", entries.size(), threads, wall,
+           entries.size() - failed, failed);
+    printf("Decoded %s of audio at %.0fx realtime\n", format_duration(audio_seconds).c_str(),
+           wall > 0 ? audio_seconds / wall : 0.0);
+    return failed > 0 ? 1 : 0;
+}
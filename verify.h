@@ -0,0 +1,14 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include "library_index.h"
+
+#include <cstddef>
+#include <vector>
+
+// 批量校验：多个线程从有界队列中取文件，以最快速度完整解码，
+// 报告无法打开、解码出错和被截断（解码帧数少于文件头声明）的文件及每个文件的解码速度。
+// threads 为 0 时使用硬件线程数；有文件校验失败时返回 1
+int run_verify(const std::vector<LibraryEntry>& entries, size_t threads);
+
+#endif // VERIFY_H